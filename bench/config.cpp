@@ -0,0 +1,192 @@
+/*
+    Config self-check.
+    Checks that copies of a Config keep value semantics while they share
+    children, and that handles follow the nodes of the config they were
+    made for.
+
+        ------------------------------------------------------------------------
+        make check
+        ../check_config handle   # only what has "handle" in its name
+        ------------------------------------------------------------------------
+
+    Results are one line each, as in bench/math.cpp:
+
+        check <name> <pass|FAIL> <cases>
+
+    Exits with EXIT_FAILURE if any check fails.
+*/
+
+#include "../core/util/config.h"
+
+#include <cstdio>
+#include <cstdlib> // EXIT_SUCCESS
+#include <cstring> // strstr
+
+using namespace core;
+
+typedef
+    struct
+    {
+        int cases, failures;
+    }
+    _Check;
+
+typedef
+    struct
+    {
+        const char *name;
+        void      (*run)(_Check &check);
+    }
+    _Property;
+
+static const char *_filter = NULL;
+
+static bool
+_selected(const char *name)
+{
+    return (_filter == NULL || strstr(name, _filter) != NULL);
+}
+
+static void
+_expect(_Check &check, bool ok)
+{
+    check.cases++;
+    check.failures += !ok;
+}
+
+static void
+_copy_old_references(_Check &check)
+// Writing through references taken before a copy leaves the copy alone
+{
+    Config a;
+    a["x"]        = 1;
+    a["sub"]["y"] = 2;
+
+    Config &x = a["x"];
+    Config &y = a["sub"]["y"];
+    Config  b = a;
+    x = 100;
+    y = 200;
+
+    _expect(check, b["x"].integer() == 1);
+    _expect(check, b["sub"]["y"].integer() == 2);
+    _expect(check, a["x"].integer() == 100);
+    _expect(check, a["sub"]["y"].integer() == 200);
+    _expect(check, &a["x"] == &x && &a["sub"]["y"] == &y);
+}
+
+static void
+_copy_const_iteration(_Check &check)
+// Reading a shared level doesn't unshare it
+{
+    Config a;
+    a["x"] = 1;
+    a["y"] = 2;
+
+    const Config &source = a;
+    const Config  b      = a;
+    const Config *first  = source.begin()->second;
+    int sum = 0;
+    for (Config::Value::const_iterator i = b.begin(); i != b.end(); ++i)
+    {
+        sum += i->second->integer();
+    }
+
+    _expect(check, sum == 3);
+    _expect(check, b.begin()->second == first);
+    _expect(check, source.begin()->second == first);
+}
+
+static void
+_handle_assigned(_Check &check)
+// A handle on a config that was assigned another one keeps reading its own
+{
+    Config root, other;
+    root["video"]["detail"]["view_range"]  = 7;
+    other["video"]["detail"]["view_range"] = 7;
+
+    Config::Handle view_range(root, "video/detail/view_range");
+    _expect(check, view_range.integer() == 7);
+
+    root = other;
+    _expect(check, view_range.integer() == 7);
+
+    other["video"]["detail"]["view_range"] = 8;
+    _expect(check, view_range.integer() == 7);
+    _expect(check, root["video"]["detail"]["view_range"].integer() == 7);
+
+    *view_range = 9;
+    _expect(check, view_range.integer() == 9);
+    _expect(check, root["video"]["detail"]["view_range"].integer() == 9);
+    _expect(check, other["video"]["detail"]["view_range"].integer() == 8);
+}
+
+static void
+_handle_source(_Check &check)
+// A handle on the config that was copied follows its writes
+{
+    Config root, copy;
+    root["sound"]["volume"] = 50;
+
+    Config::Handle volume(root, "sound/volume");
+    _expect(check, volume.integer() == 50);
+
+    copy = root;
+    copy["sound"]["volume"] = 10;
+    _expect(check, volume.integer() == 50);
+
+    root["sound"]["volume"] = 80;
+    _expect(check, volume.integer() == 80);
+    _expect(check, copy["sound"]["volume"].integer() == 10);
+}
+
+static void
+_handle_missing(_Check &check)
+// Reading a missing setting returns the default without creating it
+{
+    Config root;
+    Config::Handle missing(root, "video/missing");
+
+    _expect(check, missing.integer(42) == 42);
+    _expect(check, root.lookup("video") == NULL);
+
+    root["video"]["missing"] = 3;
+    _expect(check, missing.integer(42) == 3);
+}
+
+static const _Property _properties[] =
+{
+    { "copy_old_references",  _copy_old_references  },
+    { "copy_const_iteration", _copy_const_iteration },
+    { "handle_assigned",      _handle_assigned      },
+    { "handle_source",        _handle_source        },
+    { "handle_missing",       _handle_missing       },
+};
+
+int
+main(int argc, char **argv)
+{
+    if (argc > 1)
+    {
+        _filter = argv[1];
+    }
+
+    printf("# check <name> <pass|FAIL> <cases>\n");
+
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(_properties) / sizeof(_properties[0]); ++i)
+    {
+        const _Property &property = _properties[i];
+        if (_selected(property.name))
+        {
+            _Check check = { 0, 0 };
+            property.run(check);
+
+            printf("check %-36s %-4s %10i\n", property.name,
+                (check.failures) ? "FAIL" : "pass", check.cases);
+            passed &= (check.failures == 0);
+        }
+    }
+
+    return (passed) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1016 @@
+/*
+    Math benchmark and self-check.
+    Checks properties of the math classes on random inputs, checks that
+    the compiled-in SIMD kernels agree bit for bit with the scalar ones,
+    then times the hot operations.
+
+        ------------------------------------------------------------------------
+        make bench
+        ../bench_math inverse   # only what has "inverse" in its name
+        ------------------------------------------------------------------------
+
+    Results are one line each, in whitespace separated fields, and
+    everything else starts with '#', so that runs can be parsed and diffed:
+
+        check <name> <pass|FAIL> <cases> <largest error>
+        time  <name> <ns per op> <million ops per second>
+
+    Exits with EXIT_FAILURE if any check fails.
+*/
+
+#include "../math/kernels.h"
+#include "../math/util.h"
+#include "../math/vec2.h"
+#include "../math/vec3.h"
+#include "../math/vec4.h"
+#include "../math/mat4.h"
+#include "../math/quat.h"
+#include "../math/tri2.h"
+#include "../math/tri3.h"
+#include "../math/poly2.h"
+#include "../math/poly3.h"
+
+#include <cstdio>
+#include <cstdlib> // EXIT_SUCCESS
+#include <cstring> // memcmp, strstr
+#include <cmath>   // abs
+#include <algorithm> // max
+#include <ctime>   // clock
+
+using namespace math;
+
+#define SAMPLES    256     // distinct inputs, cycled through
+#define CHECKS     100000  // random inputs per check
+#define MIN_TIME   0.25    // seconds per measurement
+#define BATCH      1024    // points or matrices per batched call
+#define STRIDE     12      // floats per point, as in gfx::Mesh::Vertex
+
+typedef
+    struct
+    {
+        int    cases, failures;
+        double tolerance, max_error;
+    }
+    _Check;
+
+typedef
+    struct
+    {
+        const char *name;
+        void      (*run)(_Check &check);
+        double      tolerance;
+    }
+    _Property;
+
+typedef
+    struct
+    {
+        const char *name;
+        void      (*run)(void); // One op on each of the SAMPLES inputs
+    }
+    _Benchmark;
+
+typedef void (*_Binary)(float *dst, const float *A, const float *B);
+typedef void (*_Unary)(float *dst, const float *M);
+typedef void (*_Points)(float *dst, const float *src, size_t count, size_t stride, const float *M);
+typedef void (*_Matrices)(float *dst, const float *A, size_t count, const float *M);
+
+static Random _random(1);
+
+static const char *_filter = NULL;
+
+static volatile float _sink;
+
+/*
+    Inputs
+*/
+
+static float
+    _input[SAMPLES][16],
+    _output[SAMPLES][16],
+    _batch_input [BATCH * 16],
+    _batch_output[BATCH * 16];
+
+static float  _f[SAMPLES], _f_out[SAMPLES];
+static Vec2   _v2[SAMPLES], _v2_out[SAMPLES];
+static Vec3   _v3[SAMPLES], _v3_out[SAMPLES];
+static Vec4   _v4[SAMPLES], _v4_out[SAMPLES];
+static Mat4   _m[SAMPLES], _m_out[SAMPLES];
+static Quat   _q[SAMPLES], _q_out[SAMPLES];
+static Tri2   _t2[SAMPLES];
+static Tri3   _t3[SAMPLES];
+static Poly2  _p2[SAMPLES];
+static Poly3  _p3[SAMPLES];
+
+static float
+_real(float min, float max)
+{
+    return rnd(_random, min, max);
+}
+
+static Vec2
+_vec2(float r)
+{
+    return Vec2(_real(-r, r), _real(-r, r));
+}
+
+static Vec3
+_vec3(float r)
+{
+    return Vec3(_real(-r, r), _real(-r, r), _real(-r, r));
+}
+
+static Quat
+_quat(void)
+{
+    Quat q(_real(-1.0f, 1.0f), _real(-1.0f, 1.0f), _real(-1.0f, 1.0f), _real(-1.0f, 1.0f));
+    return q.normalize();
+}
+
+static Mat4
+_affine(void)
+// Rotation, scale and translation, as the engine builds them
+{
+    Mat4 M = Mat4::identity();
+    M.rotX(_real(-PI, PI)).rotY(_real(-PI, PI)).rotZ(_real(-PI, PI))
+        .scale(_real(.5f, 2.0f), _real(.5f, 2.0f), _real(.5f, 2.0f))
+        .translate(_vec3(100.0f));
+
+    return M;
+}
+
+static Tri3
+_tri3(void)
+// Not too thin
+{
+    Tri3 t;
+    do
+    {
+        t = Tri3(_vec3(10.0f), _vec3(10.0f), _vec3(10.0f));
+    }
+    while (t.normal().length() < 10.0f);
+
+    return t;
+}
+
+static Poly2
+_polygon(const Vec2 &center, float radius, int sides)
+// Regular
+{
+    Poly2 p;
+    for (int i = 0; i < sides; ++i)
+    {
+        float a = DOUBLE_PI * i / sides;
+        p.v.push_back(center + Vec2(cos(a), sin(a)) * radius);
+    }
+
+    return p;
+}
+
+static void
+_randomize(void)
+{
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        for (int j = 0; j < 16; ++j)
+        {
+            _input[i][j] = _real(-10.0f, 10.0f);
+        }
+
+        _f[i]  = _real(0.0f, 1.0f);
+        _v2[i] = _vec2(10.0f);
+        _v3[i] = _vec3(10.0f);
+        _v4[i] = Vec4(_vec3(10.0f), 1.0f);
+        _m[i]  = _affine();
+        _q[i]  = _quat();
+        _t3[i] = _tri3();
+        _t2[i] = Tri2(_vec2(10.0f), _vec2(10.0f), _vec2(10.0f));
+        _p2[i] = _polygon(_vec2(10.0f), _real(1.0f, 10.0f), 3 + i % 6);
+        _p3[i] = Poly3(_vec3(10.0f), _vec3(10.0f), _vec3(10.0f), _vec3(10.0f));
+    }
+
+    for (int i = 0; i < BATCH * 16; ++i)
+    {
+        _batch_input[i] = _real(-10.0f, 10.0f);
+    }
+}
+
+/*
+    Checks
+*/
+
+static void
+_expect(_Check &check, double error, bool ok)
+{
+    check.cases++;
+    check.failures += !ok;
+    if (error > check.max_error)
+    {
+        check.max_error = error;
+    }
+}
+
+static void
+_expect(_Check &check, double error)
+// NaN fails too
+{
+    _expect(check, error, error <= check.tolerance);
+}
+
+static double
+_difference(const Mat4 &A, const Mat4 &B)
+{
+    double max = 0.0;
+    for (int i = 0; i < 16; ++i)
+    {
+        max = std::max(max, (double)std::abs(A[i] - B[i]));
+    }
+
+    return max;
+}
+
+static double
+_relative(const Mat4 &A, const Mat4 &B)
+{
+    double scale = 0.0;
+    for (int i = 0; i < 16; ++i)
+    {
+        scale = std::max(scale, (double)std::abs(B[i]));
+    }
+
+    return _difference(A, B) / (1.0 + scale);
+}
+
+static double
+_difference(const Quat &q0, const Quat &q1)
+// Both signs give the same rotation
+{
+    return 1.0 - std::abs(q0.dot(q1));
+}
+
+static double
+_difference(float a, float b)
+{
+    return std::abs(a - b) / (1.0 + std::abs(b));
+}
+
+static void
+_mat4_inverse(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Mat4 M = _affine();
+        _expect(check, _difference(M * M.inverse(), Mat4::identity()));
+    }
+}
+
+static void
+_mat4_inverse_transpose(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Mat4 M = _affine();
+        _expect(check, _relative(M.inverse_transpose(), M.transpose().inverse()));
+    }
+}
+
+static void
+_mat4_transpose(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Mat4 M = _affine();
+        _expect(check, _difference(M.transpose().transpose(), M));
+    }
+}
+
+static void
+_mat4_associative(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Mat4 A = _affine(), B = _affine(), C = _affine();
+        _expect(check, _relative((A * B) * C, A * (B * C)));
+    }
+}
+
+static void
+_vec3_mat4(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Mat4 M = _affine();
+        Vec3 v = _vec3(100.0f);
+        _expect(check, (v * M * M.inverse() - v).length() / (1.0 + v.length()));
+    }
+}
+
+static void
+_vec3_normalize(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Vec3 v = _vec3(100.0f);
+        _expect(check, _difference(v.normalize().length(), 1.0f));
+    }
+}
+
+static void
+_vec3_cross(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Vec3 a = _vec3(10.0f), b = _vec3(10.0f), c = a.cross(b);
+        double scale = a.length() * b.length() * (a.length() + b.length()) + 1.0;
+        _expect(check, std::max(std::abs(c.dot(a)), std::abs(c.dot(b))) / scale);
+    }
+}
+
+static void
+_vec3_rotate(_Check &check)
+// Keeps the length, and the conjugate turns it back
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Quat q = _quat();
+        Vec3 v = _vec3(10.0f), r = v.rotate(q);
+        _expect(check, std::max(
+            _difference(r.length(), v.length()),
+            (double)(r.rotate(q.conjugate()) - v).length() / (1.0 + v.length())));
+    }
+}
+
+static void
+_quat_mat4(_Check &check)
+// Orthonormal
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Mat4 R = _quat().mat4();
+        _expect(check, _difference(R * R.transpose(), Mat4::identity()));
+    }
+}
+
+static void
+_quat_from_mat4(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Quat q = _quat();
+        _expect(check, _difference(Quat(q.mat4()), q));
+    }
+}
+
+static void
+_quat_multiply(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Quat q0 = _quat(), q1 = _quat();
+        _expect(check, _difference((q0 * q1).mat4(), q0.mat4() * q1.mat4()));
+    }
+}
+
+static void
+_quat_slerp_endpoints(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Quat q0 = _quat(), q1 = _quat();
+        _expect(check, std::max(
+            _difference(Quat::slerp(q0, q1, 0.0f), q0),
+            _difference(Quat::slerp(q0, q1, 1.0f), q1)));
+    }
+}
+
+static void
+_quat_slerp_unit(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Quat q = Quat::slerp(_quat(), _quat(), _real(0.0f, 1.0f));
+        _expect(check, _difference(q.length(), 1.0f));
+    }
+}
+
+static void
+_tri3_barycentric(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Tri3 t = _tri3();
+        float u = _real(0.0f, 1.0f), v = _real(0.0f, 1.0f - u), w = 1.0f - u - v;
+
+        // Weights of b, c and a, in that order
+        Vec3 p = t.barycentric(t.a * w + t.b * u + t.c * v);
+        _expect(check, (p - Vec3(u, v, w)).length());
+    }
+}
+
+static void
+_tri3_area(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Tri3 t = _tri3();
+        Vec3 offset = _vec3(100.0f);
+
+        // Half the parallelogram, wherever the triangle is
+        _expect(check, std::max(
+            _difference(t.area(), t.normal().length() / 2.0f),
+            _difference((t + offset).area(), t.area())));
+    }
+}
+
+static void
+_tri2_area(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Tri3 t = _tri3();
+        t.a.z = t.b.z = t.c.z = _real(-10.0f, 10.0f);
+
+        Tri2 flat(Vec2(t.a.x, t.a.y), Vec2(t.b.x, t.b.y), Vec2(t.c.x, t.c.y));
+        _expect(check, _difference(flat.area(), t.area()));
+    }
+}
+
+static void
+_poly2_center(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Vec2 center = _vec2(100.0f);
+        Poly2 p = _polygon(center, _real(1.0f, 10.0f), 3 + i % 10);
+        _expect(check, (p.center() - center).length() / (1.0 + center.length()));
+    }
+}
+
+static void
+_poly3_center(_Check &check)
+// Regular polygon tilted by a rotation
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        Poly2 p = _polygon(Vec2(0.0f), _real(1.0f, 10.0f), 3 + i % 10);
+        Quat q = _quat();
+        Vec3 center = _vec3(100.0f);
+
+        Poly3 tilted;
+        for (Poly2::Vertices::const_iterator v = p.v.begin(); v != p.v.end(); ++v)
+        {
+            tilted.v.push_back(Vec3(v->x, v->y, 0.0f).rotate(q) + center);
+        }
+
+        _expect(check, (tilted.center() - center).length() / (1.0 + center.length()));
+    }
+}
+
+static void
+_poly3_xy(_Check &check)
+// Flat polygons keep their size when projected on their plane
+{
+    for (int i = 0; i < CHECKS / 10; ++i)
+    {
+        Poly2 p = _polygon(_vec2(100.0f), _real(1.0f, 10.0f), 3 + i % 10);
+        Poly3 flat;
+        float z = _real(-10.0f, 10.0f);
+        for (Poly2::Vertices::const_iterator v = p.v.begin(); v != p.v.end(); ++v)
+        {
+            flat.v.push_back(Vec3(v->x, v->y, z));
+        }
+
+        _expect(check, _difference(flat.xy().circumference(), flat.circumference()));
+    }
+}
+
+static void
+_interpolate_endpoints(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        float
+            p0 = _real(-10.0f, 10.0f), p1 = _real(-10.0f, 10.0f),
+            p2 = _real(-10.0f, 10.0f), p3 = _real(-10.0f, 10.0f);
+
+        double error = 0.0;
+        error = std::max(error, _difference(lerp(p1, p2, 0.0f), p1));
+        error = std::max(error, _difference(lerp(p1, p2, 1.0f), p2));
+        error = std::max(error, _difference(interpolate::cosine(p1, p2, 0.0f), p1));
+        error = std::max(error, _difference(interpolate::cosine(p1, p2, 1.0f), p2));
+        error = std::max(error, _difference(interpolate::coserp(p1, p2, 0.0f), p1));
+        error = std::max(error, _difference(interpolate::coserp(p1, p2, 1.0f), p2));
+        error = std::max(error, _difference(interpolate::sinerp(p1, p2, 0.0f), p1));
+        error = std::max(error, _difference(interpolate::sinerp(p1, p2, 1.0f), p2));
+        error = std::max(error, _difference(interpolate::cubic(p0, p1, p2, p3, 0.0f), p1));
+        error = std::max(error, _difference(interpolate::cubic(p0, p1, p2, p3, 1.0f), p2));
+        error = std::max(error, _difference(interpolate::catmull_rom(p0, p1, p2, p3, 0.0f), p1));
+        error = std::max(error, _difference(interpolate::catmull_rom(p0, p1, p2, p3, 1.0f), p2));
+        error = std::max(error, _difference(interpolate::hermite(p0, p1, p2, p3, 0.0f, 0.0f, 0.0f), p1));
+        error = std::max(error, _difference(interpolate::hermite(p0, p1, p2, p3, 1.0f, 0.0f, 0.0f), p2));
+        _expect(check, error);
+    }
+}
+
+static void
+_smoothstep(_Check &check)
+// 0 to 1 between the edges, flat outside them
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        float x = _real(-1.0f, 2.0f), y = interpolate::smoothstep(0.0f, 1.0f, x);
+        double error = std::max(0.0f, std::max(-y, y - 1.0f));
+        error = std::max(error, _difference(interpolate::smoothstep(0.0f, 1.0f, 0.0f), 0.0f));
+        error = std::max(error, _difference(interpolate::smoothstep(0.0f, 1.0f, 1.0f), 1.0f));
+        _expect(check, error);
+    }
+}
+
+static void
+_noise_range(_Check &check)
+{
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        float n = noise((int)_real(-1e6f, 1e6f), (int)_real(-1e6f, 1e6f));
+        _expect(check, std::max(0.0f, std::abs(n) - 1.0f));
+    }
+}
+
+static void
+_perlin_noise_range(_Check &check)
+// Octaves add up to at most the sum of their amplitudes
+{
+    const float PERSISTENCE = .5f;
+    const int   OCTAVES     = 4;
+    const float LIMIT       = 1.0f + .5f + .25f + .125f;
+
+    for (int i = 0; i < CHECKS / 10; ++i)
+    {
+        Vec3 p = _vec3(1000.0f);
+        float
+            n2 = perlin_noise(p.x, p.y, PERSISTENCE, OCTAVES),
+            n3 = perlin_noise(p.x, p.y, p.z, PERSISTENCE, OCTAVES);
+        _expect(check, std::max(0.0f, std::max(std::abs(n2), std::abs(n3)) - LIMIT));
+    }
+}
+
+static void
+_perlin_noise_repeatable(_Check &check)
+// Whatever was sampled in between
+{
+    for (int i = 0; i < CHECKS / 10; ++i)
+    {
+        Vec3 p = _vec3(1000.0f), q = _vec3(1000.0f);
+        float
+            n2 = perlin_noise(p.x, p.y, .5f, 4),
+            n3 = perlin_noise(p.x, p.y, p.z, .5f, 4);
+
+        perlin_noise(q.x, q.y, .5f, 4);
+        perlin_noise(q.x, q.y, q.z, .5f, 4);
+
+        _expect(check, std::max(
+            std::abs(perlin_noise(p.x, p.y, .5f, 4) - n2),
+            std::abs(perlin_noise(p.x, p.y, p.z, .5f, 4) - n3)));
+    }
+}
+
+static void
+_random_range(_Check &check)
+{
+    Random random(2);
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        float r = rnd(random);
+        _expect(check, std::max(0.0f, std::max(-r, r - 1.0f)));
+    }
+}
+
+static void
+_random_streams(_Check &check)
+// Same keys, same numbers; other keys or splits, other numbers
+{
+    for (int i = 0; i < CHECKS / 100; ++i)
+    {
+        unsigned int seed = _random.next();
+        int x = (int)_random.next(), z = (int)_random.next();
+
+        Random a(seed, x, z), b(seed, x, z), c(seed, x, z + 1), d = a.split(0);
+        int same = 0, other = 0;
+        for (int j = 0; j < 100; ++j)
+        {
+            unsigned int n = a.next();
+            same  += (n == b.next());
+            other += (n == c.next()) + (n == d.next());
+        }
+
+        _expect(check, other, same == 100 && other < 2);
+    }
+}
+
+/*
+    Kernels: the dispatched ones against the scalar reference
+*/
+
+static void
+_exact(_Check &check, _Binary reference, _Binary kernel)
+{
+    float A[16], B[16], expected[16], result[16];
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        for (int j = 0; j < 16; ++j)
+        {
+            A[j] = _real(-10.0f, 10.0f);
+            B[j] = _real(-10.0f, 10.0f);
+        }
+
+        reference(expected, A, B);
+        kernel(result, A, B);
+        _expect(check, _difference(Mat4(expected), Mat4(result)),
+            memcmp(expected, result, sizeof(result)) == 0);
+    }
+}
+
+static void
+_exact(_Check &check, _Unary reference, _Unary kernel, bool quat = false)
+{
+    float M[16], expected[16], result[16];
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        for (int j = 0; j < 16; ++j)
+        {
+            // Arbitrary length quaternions, the formula doesn't care
+            M[j] = _real(-10.0f, 10.0f) * ((quat) ? .1f : 1.0f);
+        }
+
+        reference(expected, M);
+        kernel(result, M);
+        _expect(check, _difference(Mat4(expected), Mat4(result)),
+            memcmp(expected, result, sizeof(result)) == 0);
+    }
+}
+
+static void
+_exact(_Check &check, _Points reference, _Points kernel)
+{
+    // Whatever lies between points must be left alone
+    static float expected[BATCH * STRIDE], result[BATCH * STRIDE];
+    float M[16];
+    for (int i = 0; i < CHECKS / BATCH; ++i)
+    {
+        for (int j = 0; j < 16; ++j)
+        {
+            M[j] = _real(-10.0f, 10.0f);
+        }
+        for (int j = 0; j < BATCH * STRIDE; ++j)
+        {
+            expected[j] = result[j] = _real(-10.0f, 10.0f);
+        }
+
+        reference(expected, expected, BATCH, STRIDE * sizeof(float), M);
+        kernel(result, result, BATCH, STRIDE * sizeof(float), M);
+        for (int j = 0; j < BATCH; ++j)
+        {
+            _expect(check, 0.0, memcmp(
+                expected + j * STRIDE, result + j * STRIDE, STRIDE * sizeof(float)) == 0);
+        }
+    }
+}
+
+static void
+_exact(_Check &check, _Matrices reference, _Matrices kernel)
+{
+    static float A[BATCH * 16], expected[BATCH * 16], result[BATCH * 16];
+    float M[16];
+    for (int i = 0; i < CHECKS / BATCH; ++i)
+    {
+        for (int j = 0; j < 16; ++j)
+        {
+            M[j] = _real(-10.0f, 10.0f);
+        }
+        for (int j = 0; j < BATCH * 16; ++j)
+        {
+            A[j] = _real(-10.0f, 10.0f);
+        }
+
+        reference(expected, A, BATCH, M);
+        kernel(result, A, BATCH, M);
+        for (int j = 0; j < BATCH; ++j)
+        {
+            _expect(check, _difference(Mat4(expected + j * 16), Mat4(result + j * 16)),
+                memcmp(expected + j * 16, result + j * 16, 16 * sizeof(float)) == 0);
+        }
+    }
+}
+
+static void _kernel_mat4_multiply      (_Check &c) { _exact(c, kernels::mat4_multiply_scalar,       kernels::mat4_multiply); }
+static void _kernel_mat4_transpose     (_Check &c) { _exact(c, kernels::mat4_transpose_scalar,      kernels::mat4_transpose); }
+static void _kernel_mat4_inverse       (_Check &c) { _exact(c, kernels::mat4_inverse_scalar,        kernels::mat4_inverse); }
+static void _kernel_quat_mat4          (_Check &c) { _exact(c, kernels::quat_mat4_scalar,           kernels::quat_mat4, true); }
+static void _kernel_transform_points   (_Check &c) { _exact(c, kernels::transform_points_scalar,    kernels::transform_points); }
+static void _kernel_transform_vectors  (_Check &c) { _exact(c, kernels::transform_vectors_scalar,   kernels::transform_vectors); }
+static void _kernel_mat4_multiply_array(_Check &c) { _exact(c, kernels::mat4_multiply_array_scalar, kernels::mat4_multiply_array); }
+
+static const _Property _properties[] =
+{
+    { "mat4.inverse",                   _mat4_inverse,              1e-3 },
+    { "mat4.inverse_transpose",         _mat4_inverse_transpose,    1e-5 },
+    { "mat4.transpose",                 _mat4_transpose,            0.0  },
+    { "mat4.multiply.associative",      _mat4_associative,          1e-5 },
+    { "vec3.mat4",                      _vec3_mat4,                 1e-5 },
+    { "vec3.normalize",                 _vec3_normalize,            1e-6 },
+    { "vec3.cross",                     _vec3_cross,                1e-6 },
+    { "vec3.rotate",                    _vec3_rotate,               1e-5 },
+    { "quat.mat4",                      _quat_mat4,                 1e-5 },
+    { "quat.from_mat4",                 _quat_from_mat4,            1e-5 },
+    { "quat.multiply",                  _quat_multiply,             1e-5 },
+    { "quat.slerp.endpoints",           _quat_slerp_endpoints,      1e-5 },
+    { "quat.slerp.unit",                _quat_slerp_unit,           1e-5 },
+    { "tri3.barycentric",               _tri3_barycentric,          1e-3 },
+    { "tri3.area",                      _tri3_area,                 1e-4 },
+    { "tri2.area",                      _tri2_area,                 1e-4 },
+    { "poly2.center",                   _poly2_center,              1e-5 },
+    { "poly3.center",                   _poly3_center,              1e-5 },
+    { "poly3.xy",                       _poly3_xy,                  1e-5 },
+    { "interpolate.endpoints",          _interpolate_endpoints,     1e-4 },
+    { "interpolate.smoothstep",         _smoothstep,                0.0  },
+    { "noise.range",                    _noise_range,               0.0  },
+    { "perlin_noise.range",             _perlin_noise_range,        0.0  },
+    { "perlin_noise.repeatable",        _perlin_noise_repeatable,   0.0  },
+    { "random.range",                   _random_range,              0.0  },
+    { "random.streams",                 _random_streams,            0.0  },
+    { "kernels.mat4_multiply",          _kernel_mat4_multiply,      0.0  },
+    { "kernels.mat4_transpose",         _kernel_mat4_transpose,     0.0  },
+    { "kernels.mat4_inverse",           _kernel_mat4_inverse,       0.0  },
+    { "kernels.quat_mat4",              _kernel_quat_mat4,          0.0  },
+    { "kernels.transform_points",       _kernel_transform_points,   0.0  },
+    { "kernels.transform_vectors",      _kernel_transform_vectors,  0.0  },
+    { "kernels.mat4_multiply_array",    _kernel_mat4_multiply_array, 0.0 },
+};
+
+/*
+    Benchmarks
+*/
+
+static void _b_vec2_normalize(void)        { for (int i = 0; i < SAMPLES; ++i) _v2_out[i] = _v2[i].normal(); }
+static void _b_vec3_add(void)              { for (int i = 0; i < SAMPLES; ++i) _v3_out[i] = _v3[i] + _v3[(i + 1) & (SAMPLES - 1)]; }
+static void _b_vec3_dot(void)              { for (int i = 0; i < SAMPLES; ++i) _f_out[i] = _v3[i].dot(_v3[(i + 1) & (SAMPLES - 1)]); }
+static void _b_vec3_cross(void)            { for (int i = 0; i < SAMPLES; ++i) _v3_out[i] = _v3[i].cross(_v3[(i + 1) & (SAMPLES - 1)]); }
+static void _b_vec3_normalize(void)        { for (int i = 0; i < SAMPLES; ++i) _v3_out[i] = _v3[i].normal(); }
+static void _b_vec3_mat4(void)             { for (int i = 0; i < SAMPLES; ++i) _v3_out[i] = _v3[i] * _m[i]; }
+static void _b_vec3_rotate(void)           { for (int i = 0; i < SAMPLES; ++i) _v3_out[i] = _v3[i].rotate(_q[i]); }
+static void _b_vec4_mat4(void)             { for (int i = 0; i < SAMPLES; ++i) _v4_out[i] = _v4[i] * _m[i]; }
+static void _b_mat4_multiply(void)         { for (int i = 0; i < SAMPLES; ++i) _m_out[i] = _m[i] * _m[(i + 1) & (SAMPLES - 1)]; }
+static void _b_mat4_inverse(void)          { for (int i = 0; i < SAMPLES; ++i) _m_out[i] = _m[i].inverse(); }
+static void _b_mat4_inverse_transpose(void){ for (int i = 0; i < SAMPLES; ++i) _m_out[i] = _m[i].inverse_transpose(); }
+static void _b_mat4_transpose(void)        { for (int i = 0; i < SAMPLES; ++i) _m_out[i] = _m[i].transpose(); }
+static void _b_mat4_rotY(void)             { for (int i = 0; i < SAMPLES; ++i) { _m_out[i] = _m[i]; _m_out[i].rotY(_f[i]); } }
+static void _b_quat_multiply(void)         { for (int i = 0; i < SAMPLES; ++i) _q_out[i] = _q[i] * _q[(i + 1) & (SAMPLES - 1)]; }
+static void _b_quat_mat4(void)             { for (int i = 0; i < SAMPLES; ++i) _m_out[i] = _q[i].mat4(); }
+static void _b_quat_from_mat4(void)        { for (int i = 0; i < SAMPLES; ++i) _q_out[i] = Quat(_m[i]); }
+static void _b_quat_slerp(void)            { for (int i = 0; i < SAMPLES; ++i) _q_out[i] = Quat::slerp(_q[i], _q[(i + 1) & (SAMPLES - 1)], _f[i]); }
+static void _b_tri3_normal(void)           { for (int i = 0; i < SAMPLES; ++i) _v3_out[i] = _t3[i].normal(); }
+static void _b_tri3_barycentric(void)      { for (int i = 0; i < SAMPLES; ++i) _v3_out[i] = _t3[i].barycentric(_v3[i]); }
+static void _b_tri3_intersects(void)       { for (int i = 0; i < SAMPLES; ++i) _f_out[i] = _t3[i].intersects(_v3[i], _v3[(i + 1) & (SAMPLES - 1)]); }
+static void _b_tri3_area(void)             { for (int i = 0; i < SAMPLES; ++i) _f_out[i] = _t3[i].area(); }
+static void _b_tri2_area(void)             { for (int i = 0; i < SAMPLES; ++i) _f_out[i] = _t2[i].area(); }
+static void _b_poly2_center(void)          { for (int i = 0; i < SAMPLES; ++i) _v2_out[i] = _p2[i].center(); }
+static void _b_poly3_circumference(void)   { for (int i = 0; i < SAMPLES; ++i) _f_out[i] = _p3[i].circumference(); }
+static void _b_interpolate_cosine(void)    { for (int i = 0; i < SAMPLES; ++i) _f_out[i] = interpolate::cosine(_v3[i].x, _v3[i].y, _f[i]); }
+static void _b_interpolate_cubic(void)     { for (int i = 0; i < SAMPLES; ++i) _f_out[i] = interpolate::cubic(_v4[i].x, _v4[i].y, _v4[i].z, _v4[i].w, _f[i]); }
+static void _b_interpolate_catmull_rom(void){ for (int i = 0; i < SAMPLES; ++i) _f_out[i] = interpolate::catmull_rom(_v4[i].x, _v4[i].y, _v4[i].z, _v4[i].w, _f[i]); }
+static void _b_interpolate_smoothstep(void){ for (int i = 0; i < SAMPLES; ++i) _f_out[i] = interpolate::smoothstep(0.0f, 1.0f, _f[i]); }
+static void _b_noise(void)                 { for (int i = 0; i < SAMPLES; ++i) _f_out[i] = noise((int)_v3[i].x, (int)_v3[i].y); }
+static void _b_perlin_noise_2d(void)       { for (int i = 0; i < SAMPLES; ++i) _f_out[i] = perlin_noise(_v3[i].x, _v3[i].y, .5f, 4); }
+static void _b_perlin_noise_3d(void)       { for (int i = 0; i < SAMPLES; ++i) _f_out[i] = perlin_noise(_v3[i].x, _v3[i].y, _v3[i].z, .5f, 4); }
+static void _b_random_next(void)           { for (int i = 0; i < SAMPLES; ++i) _f_out[i] = (float)_random.next(); }
+static void _b_rnd(void)                   { for (int i = 0; i < SAMPLES; ++i) _f_out[i] = rnd(1.0f, 2.0f); }
+
+static const _Benchmark _benchmarks[] =
+{
+    { "vec2.normalize",             _b_vec2_normalize },
+    { "vec3.add",                   _b_vec3_add },
+    { "vec3.dot",                   _b_vec3_dot },
+    { "vec3.cross",                 _b_vec3_cross },
+    { "vec3.normalize",             _b_vec3_normalize },
+    { "vec3.mat4",                  _b_vec3_mat4 },
+    { "vec3.rotate",                _b_vec3_rotate },
+    { "vec4.mat4",                  _b_vec4_mat4 },
+    { "mat4.multiply",              _b_mat4_multiply },
+    { "mat4.inverse",               _b_mat4_inverse },
+    { "mat4.inverse_transpose",     _b_mat4_inverse_transpose },
+    { "mat4.transpose",             _b_mat4_transpose },
+    { "mat4.rotY",                  _b_mat4_rotY },
+    { "quat.multiply",              _b_quat_multiply },
+    { "quat.mat4",                  _b_quat_mat4 },
+    { "quat.from_mat4",             _b_quat_from_mat4 },
+    { "quat.slerp",                 _b_quat_slerp },
+    { "tri3.normal",                _b_tri3_normal },
+    { "tri3.barycentric",           _b_tri3_barycentric },
+    { "tri3.intersects",            _b_tri3_intersects },
+    { "tri3.area",                  _b_tri3_area },
+    { "tri2.area",                  _b_tri2_area },
+    { "poly2.center",               _b_poly2_center },
+    { "poly3.circumference",        _b_poly3_circumference },
+    { "interpolate.cosine",         _b_interpolate_cosine },
+    { "interpolate.cubic",          _b_interpolate_cubic },
+    { "interpolate.catmull_rom",    _b_interpolate_catmull_rom },
+    { "interpolate.smoothstep",     _b_interpolate_smoothstep },
+    { "noise",                      _b_noise },
+    { "perlin_noise.2d",            _b_perlin_noise_2d },
+    { "perlin_noise.3d",            _b_perlin_noise_3d },
+    { "random.next",                _b_random_next },
+    { "rnd",                        _b_rnd },
+};
+
+/*
+    Timing, in nanoseconds per op
+*/
+
+static double
+_time(void (*run)(void))
+{
+    long ops = 0;
+    clock_t start = clock(), elapsed;
+    do
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            run();
+        }
+        ops    += 100 * SAMPLES;
+        elapsed = clock() - start;
+    }
+    while (elapsed < MIN_TIME * CLOCKS_PER_SEC);
+
+    _sink = _f_out[0] + _v3_out[0].x + _m_out[0][0] + _q_out[0].x;
+    return (double)elapsed / CLOCKS_PER_SEC * 1e9 / ops;
+}
+
+static double
+_time(_Binary kernel)
+{
+    long ops = 0;
+    clock_t start = clock(), elapsed;
+    do
+    {
+        for (int i = 0; i < 100000; ++i)
+        {
+            int j = i & (SAMPLES - 1);
+            kernel(_output[j], _input[j], _input[(j + 1) & (SAMPLES - 1)]);
+        }
+        ops    += 100000;
+        elapsed = clock() - start;
+    }
+    while (elapsed < MIN_TIME * CLOCKS_PER_SEC);
+
+    _sink = _output[0][0];
+    return (double)elapsed / CLOCKS_PER_SEC * 1e9 / ops;
+}
+
+static double
+_time(_Unary kernel)
+{
+    long ops = 0;
+    clock_t start = clock(), elapsed;
+    do
+    {
+        for (int i = 0; i < 100000; ++i)
+        {
+            int j = i & (SAMPLES - 1);
+            kernel(_output[j], _input[j]);
+        }
+        ops    += 100000;
+        elapsed = clock() - start;
+    }
+    while (elapsed < MIN_TIME * CLOCKS_PER_SEC);
+
+    _sink = _output[0][0];
+    return (double)elapsed / CLOCKS_PER_SEC * 1e9 / ops;
+}
+
+static double
+_time(_Points kernel)
+// Per point
+{
+    long ops = 0;
+    clock_t start = clock(), elapsed;
+    do
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            // Points 4 floats apart, as in a tight Vec4 array
+            kernel(_batch_output, _batch_input, BATCH * 4, 4 * sizeof(float), _input[i & (SAMPLES - 1)]);
+        }
+        ops    += 100 * BATCH * 4;
+        elapsed = clock() - start;
+    }
+    while (elapsed < MIN_TIME * CLOCKS_PER_SEC);
+
+    _sink = _batch_output[0];
+    return (double)elapsed / CLOCKS_PER_SEC * 1e9 / ops;
+}
+
+static double
+_time(_Matrices kernel)
+// Per matrix
+{
+    long ops = 0;
+    clock_t start = clock(), elapsed;
+    do
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            kernel(_batch_output, _batch_input, BATCH, _input[i & (SAMPLES - 1)]);
+        }
+        ops    += 100 * BATCH;
+        elapsed = clock() - start;
+    }
+    while (elapsed < MIN_TIME * CLOCKS_PER_SEC);
+
+    _sink = _batch_output[0];
+    return (double)elapsed / CLOCKS_PER_SEC * 1e9 / ops;
+}
+
+/*
+    Output
+*/
+
+static bool
+_selected(const char *name)
+{
+    return (_filter == NULL || strstr(name, _filter) != NULL);
+}
+
+static void
+_report(const char *name, double ns)
+{
+    if (_selected(name))
+    {
+        printf("time  %-36s %10.2f %10.2f\n", name, ns, 1e3 / ns);
+    }
+}
+
+template <class T> static void
+_report_kernel(const char *name, T scalar, T kernel)
+// Both versions, so that runs can be compared whatever the build selected
+{
+    char buffer[64];
+    sprintf(buffer, "kernels.%s.scalar", name);
+    if (_selected(buffer))
+    {
+        _report(buffer, _time(scalar));
+    }
+    sprintf(buffer, "kernels.%s", name);
+    if (_selected(buffer))
+    {
+        _report(buffer, _time(kernel));
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc > 1)
+    {
+        _filter = argv[1];
+    }
+
+    _randomize();
+
+    printf("# kernels %s\n", kernels::instruction_set());
+    printf("# check <name> <pass|FAIL> <cases> <largest error>\n");
+    printf("# time  <name> <ns per op> <million ops per second>\n");
+
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(_properties) / sizeof(_properties[0]); ++i)
+    {
+        const _Property &property = _properties[i];
+        if (_selected(property.name))
+        {
+            _Check check = { 0, 0, property.tolerance, 0.0 };
+            property.run(check);
+
+            printf("check %-36s %-4s %10i %10.3g\n", property.name,
+                (check.failures) ? "FAIL" : "pass", check.cases, check.max_error);
+            passed &= (check.failures == 0);
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(_benchmarks) / sizeof(_benchmarks[0]); ++i)
+    {
+        if (_selected(_benchmarks[i].name))
+        {
+            _report(_benchmarks[i].name, _time(_benchmarks[i].run));
+        }
+    }
+
+    _report_kernel("mat4_multiply",       kernels::mat4_multiply_scalar,       kernels::mat4_multiply);
+    _report_kernel("mat4_transpose",      kernels::mat4_transpose_scalar,      kernels::mat4_transpose);
+    _report_kernel("mat4_inverse",        kernels::mat4_inverse_scalar,        kernels::mat4_inverse);
+    _report_kernel("quat_mat4",           kernels::quat_mat4_scalar,           kernels::quat_mat4);
+    _report_kernel("transform_points",    kernels::transform_points_scalar,    kernels::transform_points);
+    _report_kernel("transform_vectors",   kernels::transform_vectors_scalar,   kernels::transform_vectors);
+    _report_kernel("mat4_multiply_array", kernels::mat4_multiply_array_scalar, kernels::mat4_multiply_array);
+
+    return (passed) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -59,7 +59,7 @@ Cormorant::render(void)
         screen.scene->matrix.mv =
             (math::Mat4(screen.scene->player->transformation)
                 .translate(-0.0f, -1.1f, -7.47f)
-                * screen.scene->player->rot
+                * screen.scene->player->render_rot()
                 * -screen.scene->camera.rot);
 
         // (!) TODO: render explicit cockpit geometry here instead of player model
@@ -117,7 +117,10 @@ Cormorant::initialize()
     this->log("Initializing main engine");
     
     // Render player so that there's something to look at
-    _render_loading_screen();
+    if (!screen.headless)
+    {
+        _render_loading_screen();
+    }
 
     screen.scene->camera.rot.x = .3f;
     screen.scene->camera.rot.y = .1f + math::PI;
@@ -222,7 +225,7 @@ Cormorant::initialize()
 
     game::terrain.prefetch(screen.scene->player->pos);
 
-    if (!this->config["video"]["skip_intro"].boolean(false))
+    if (!screen.headless && !this->config["video"]["skip_intro"].boolean(false))
     {
         game::Cutscene *intro = new game::Cutscene("intro");
         intro->run();
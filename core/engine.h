@@ -2,6 +2,7 @@
 #define _CORE_ENGINE_H
 
 #include "engines/core.h"
+#include "engines/jobs.h"
 #include "engines/input.h"
 #include "engines/video.h"
 #include "engines/sound.h"
@@ -12,6 +13,7 @@ namespace core
 {
     class Cormorant:
         virtual public EngineCore,
+        virtual public JobEngine,
         virtual public InputEngine,
         virtual public VideoEngine,
         virtual public SoundEngine,
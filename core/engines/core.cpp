@@ -1,22 +1,23 @@
 #include "core.h"
 
 #include "../util/file.h"
+#include "../util/pack.h"
 #include "../util/string.h"
+#include "../util/profiler.h"
+#include "../util/scratch.h"
+#include "../../math/random.h"
 #include "../../version.h"
 
 #include <cstdio>
+#include <cstdlib> // srand
 #include <ctime>
 
-#ifdef _WIN32
-#include <windows.h>
-#else
-#include <unistd.h>
-#endif
+#include <SDL2/SDL.h>
 
 using namespace core;
 
-#define MAX_MODULE_COUNT 128
-#define CURRENT_TICKS (clock() * 1000 / CLOCKS_PER_SEC)
+#define MAX_MODULE_COUNT  128
+#define MAX_CATCHUP_TICKS 5
 
 static struct
     {
@@ -26,19 +27,56 @@ static struct
     }
     modules;
 
+static Uint64
+_elapsed_time(Uint64 since)
+{
+    // Wall-clock microseconds since given performance counter value
+    Uint64
+        counter   = SDL_GetPerformanceCounter() - since,
+        frequency = SDL_GetPerformanceFrequency();
+
+    return (counter / frequency) * 1000000
+        + (counter % frequency) * 1000000 / frequency;
+}
+
 EngineCore::EngineCore():
-    ticks(mutable_ticks)
+    ticks(mutable_ticks),
+    tick_alpha(mutable_tick_alpha)
 {
     this->log_header("Startup");
     
     modules.active[0]     = NULL;
     modules.registered[0] = NULL;
     
-    this->start_ticks   = CURRENT_TICKS;
-    this->mutable_ticks = 0;
+    this->start_counter      = SDL_GetPerformanceCounter();
+    this->simulated_time     = 0;
+    this->skipped_time       = 0;
+    this->mutable_ticks      = 0;
+    this->mutable_tick_alpha = 0.0f;
+    this->fast_forward       = false;
     
     srand(time(NULL));
+    math::Random::local() = math::Random(time(NULL));
+    
+    // Before anything is read, so that the pack covers everything
+    try
+    {
+        if (pack::mount(PACK_FILENAME))
+            this->log("Mounted " PACK_FILENAME);
+    }
+    catch (int)
+    {
+        this->log("(!) Ignoring corrupt " PACK_FILENAME);
+    }
+    
     this->config.load(DATA_DIRECTORY "settings.cfg");
+
+    int log_level = this->config["log"]["level"].integer(LOG_MAX_LEVEL);
+    for (int c = 0; c < Logger::LOG_CATEGORIES; ++c)
+    {
+        Logger::filter((Logger::Category)c,
+            this->config["log"][Logger::category_name[c]].integer(log_level));
+    }
 }
 
 EngineCore::~EngineCore()
@@ -69,48 +107,85 @@ EngineCore::start(void)
 
     this->log_header(APP_TITLE);
     this->log("Started");
+    PROFILE_THREAD("main");
 
-    this->start_ticks   = CURRENT_TICKS;
-    this->mutable_ticks = 0;
+    this->start_counter      = SDL_GetPerformanceCounter();
+    this->simulated_time     = 0;
+    this->skipped_time       = 0;
+    this->mutable_ticks      = 0;
+    this->mutable_tick_alpha = 0.0f;
 }
 
 bool
 EngineCore::run(void)
 {
     try {
-        unsigned long
-            target_ticks = CURRENT_TICKS - this->start_ticks,
-            old_ticks    = this->ticks,
-            elapsed      = target_ticks - old_ticks,
-            tick_step    = 1000 / this->ticks_per_second;
+        PROFILE("EngineCore::run");
+
+        Uint64
+            tick_step  = 1000000 / this->ticks_per_second,
+            frame_step = 1000000 / this->frames_per_second,
+            now        = _elapsed_time(this->start_counter) - this->skipped_time;
+
+        if (this->fast_forward)
+        {
+            // One tick per frame, however long it took
+            now = this->simulated_time + tick_step;
+        }
+
+        // Cap the backlog so that a single stall doesn't snowball
+        // into ever longer catch-up runs
+        else if (now - this->simulated_time > MAX_CATCHUP_TICKS * tick_step)
+        {
+            Uint64 skip = now - this->simulated_time - MAX_CATCHUP_TICKS * tick_step;
+            this->log("Running behind, skipping %lu ms", (unsigned long)(skip / 1000));
 
-        for (; this->ticks < target_ticks; this->mutable_ticks += tick_step)
+            this->skipped_time += skip;
+            now                -= skip;
+        }
+
+        for (; this->simulated_time + tick_step <= now;
+            this->simulated_time += tick_step)
         {
+            PROFILE("update_tick");
+            this->mutable_ticks = this->simulated_time / 1000;
+
             for (EngineInterface **e = modules.active; *e != NULL; ++e)
             {
+                PROFILE((*e)->get_module_name());
                 (*e)->update_tick();
             }
 
             this->update();
         }
 
-        long wait_time = (1000 / this->frames_per_second) - elapsed;
-        
-        if (wait_time > 0)
-        {
+        this->mutable_ticks      = this->simulated_time / 1000;
+        this->mutable_tick_alpha = (float)(now - this->simulated_time) / tick_step;
 
-#ifdef _WIN32
-            Sleep(wait_time);
-#else
-            usleep(wait_time * 1000);
-#endif
+        {
+            PROFILE("update_frame");
             for (EngineInterface **e = modules.active; *e != NULL; ++e)
             {
+                PROFILE((*e)->get_module_name());
                 (*e)->update_frame();
             }
+        }
 
+        {
+            PROFILE("render");
             this->render();
         }
+
+        // Temporaries made during the frame are gone
+        scratch::reset();
+
+        // Sleep for whatever is left of the frame budget
+        Uint64 spent = _elapsed_time(this->start_counter) - this->skipped_time - now;
+        if (!this->fast_forward && spent + 1000 < frame_step)
+        {
+            PROFILE("sleep");
+            SDL_Delay((frame_step - spent) / 1000);
+        }
     }
     catch (int i)
     {
@@ -5,6 +5,8 @@
 #include "../message.h"
 #include "../util/config.h"
 
+#include <SDL2/SDL_stdinc.h>
+
 namespace core
 {
     class EngineInterface
@@ -23,8 +25,8 @@ namespace core
         virtual void
         update_frame(void) {};
         // Updated once per rendered frame
-        // This is targeted at engine's frames_per_second setting
-        // and the call interval may vary as frames are skipped
+        // This is targeted at engine's frames_per_second setting;
+        // use tick_alpha to interpolate between the last two ticks
     };
 
     class EngineCore:
@@ -32,10 +34,14 @@ namespace core
     {
     public:
         const unsigned long &ticks;
+        const float         &tick_alpha; // Progress towards the next tick [0, 1)
         
         int
             frames_per_second, // Targeted framerate
             ticks_per_second;  // Physics update interval, generally at least the same as FPS
+
+        bool
+            fast_forward;      // Run one tick per frame as fast as possible, ignoring the wall clock
         
         Config  config;
         Message message;
@@ -80,8 +86,15 @@ namespace core
 
     private:
         unsigned long
-            mutable_ticks,
-            start_ticks;
+            mutable_ticks;
+
+        float
+            mutable_tick_alpha;
+
+        Uint64
+            start_counter,  // Performance counter at start
+            simulated_time, // Microseconds simulated so far
+            skipped_time;   // Microseconds dropped to prevent catch-up cascades
     };
 }
 
@@ -6,8 +6,11 @@
 #include <vector>
 #include <algorithm>
 #include <cmath>
+#include <cstdlib> // srand
+#include <ctime>
 
 #include "../util/string.h"
+#include "../../math/random.h"
 
 core::Input input;
 using namespace core;
@@ -63,6 +66,7 @@ static void _init_names()
 
     _actions["fullscreen_toggle"] = Input::FULLSCREEN_TOGGLE;
     _actions["pause"]             = Input::PAUSE;
+    _actions["profiler_capture"]  = Input::PROFILER_CAPTURE;
     _actions["quit"]              = Input::QUIT;
 
     _types["type"]    = Input::TYPE;
@@ -123,17 +127,38 @@ InputEngine::initialize_module()
     input.bind(Input::FULLSCREEN_TOGGLE, input.keyboard.hold(SDL_SCANCODE_LALT), input.keyboard.press(SDL_SCANCODE_RETURN));
     input.bind(Input::FULLSCREEN_TOGGLE, input.keyboard.hold(SDL_SCANCODE_RALT), input.keyboard.press(SDL_SCANCODE_RETURN));
     input.bind(Input::PAUSE,             input.keyboard.press(SDL_SCANCODE_F1));
+    input.bind(Input::PROFILER_CAPTURE,  input.keyboard.press(SDL_SCANCODE_F12));
     input.bind(Input::QUIT,              input.keyboard.press(SDL_SCANCODE_ESCAPE));
 
     // input.load("input.cfg");
     input.save("input.cfg");
 
+    unsigned long seed = time(NULL);
+    const char
+        *replay = this->config["input"]["replay"].string(NULL),
+        *record = this->config["input"]["record"].string(NULL);
+
+    if (replay != NULL && input.replay(replay, seed))
+    {
+        // Recorded joystick axes stand in for live controllers
+        srand(seed);
+        math::Random::local() = math::Random(seed);
+        return;
+    }
+
     this->init_controllers();
+
+    if (record != NULL && input.record(record, seed))
+    {
+        srand(seed);
+        math::Random::local() = math::Random(seed);
+    }
 }
 
 void
 InputEngine::update_tick(void)
 {
+    input.update_tick();
 }
 
 void
@@ -142,6 +167,8 @@ InputEngine::update_frame(void)
     this->update_keyboard();
     this->update_mouse();
     this->update_controllers();
+
+    input.update_frame();
 }
 
 void
@@ -439,12 +466,26 @@ InputEngine::~InputEngine()
 
 Input::Input()
 {
-    this->joysticks = 0;
-    this->joystick  = NULL;
+    this->joysticks  = 0;
+    this->joystick   = NULL;
+
+    this->mode       = LIVE;
+    this->tape       = NULL;
+    this->tape_ticks = 0;
+    this->ticking    = false;
+    for (int i = 0; i < ACTIONS + STICK_AXES; ++i)
+    {
+        this->state[i] = 0.0f;
+    }
+    for (int i = 0; i < ACTIONS; ++i)
+    {
+        this->pressed[i] = 0.0f;
+    }
 }
 
 Input::~Input()
 {
+    delete this->tape;
     delete[] this->joystick;
 }
 
@@ -499,6 +540,61 @@ Input::bind(Action action, Event event0, Event event1, Event event2)
 
 float
 Input::operator[](Action action)
+{
+    switch (action)
+    {
+        // Window and engine controls stay live during replays
+        case FULLSCREEN_TOGGLE:
+        case PROFILER_CAPTURE:
+            break;
+
+        case QUIT:
+            if (this->mode == REPLAY_FINISHED)
+            {
+                return 1.0f;
+            }
+            break;
+
+        default:
+            if (this->ticking)
+            {
+                return this->state[action];
+            }
+    }
+
+    return this->evaluate(action);
+}
+
+void
+Input::update_frame(void)
+{
+    this->ticking = false;
+
+    // The strongest press wins, as in evaluate()
+    for (int a = 0; a < ACTIONS; ++a)
+    {
+        float f = this->evaluate((Action)a);
+        if (f != this->evaluate((Action)a, false)
+            && std::abs(f) > std::abs(this->pressed[a]))
+        {
+            this->pressed[a] = f;
+        }
+    }
+}
+
+float
+Input::latch(Action action)
+{
+    float f = (this->pressed[action] != 0.0f)
+        ? this->pressed[action]
+        : this->evaluate(action, false);
+
+    this->pressed[action] = 0.0f;
+    return f;
+}
+
+float
+Input::evaluate(Action action, bool edges)
 {
     Binding *alternatives = &this->binding[action];
     float result = 0.0f;
@@ -523,19 +619,19 @@ Input::operator[](Action action)
                     break;
                 
                 case PRESS:
-                    output *= (std::find(
+                    output *= edges && (std::find(
                         device->presses.begin(), device->presses.end(),
                         i->event[e].button) != device->presses.end());
                     break;
 
                 case RELEASE:
-                    output *= (std::find(
+                    output *= edges && (std::find(
                         device->releases.begin(), device->releases.end(),
                         i->event[e].button) != device->releases.end());
                     break;
 
                 case TYPE:
-                    output *= (std::find(
+                    output *= edges && (std::find(
                         device->repeats.begin(), device->repeats.end(),
                         i->event[e].button) != device->repeats.end());
                     break;
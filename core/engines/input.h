@@ -6,6 +6,8 @@
 
 namespace core
 {
+    class File;
+
     class Input
     {
     public:
@@ -53,11 +55,16 @@ namespace core
                 
                 FULLSCREEN_TOGGLE,
                 PAUSE,
+                PROFILER_CAPTURE,
 
                 QUIT
             }
             Action;
 
+        static const int
+            ACTIONS    = QUIT + 1,
+            STICK_AXES = 4; // Axes of the first joystick stored in recordings
+
         typedef
             enum
             {
@@ -159,14 +166,48 @@ namespace core
         
         float // Check whether an input action is triggered right now
         operator[](Action action);
+        // Ticks see the state latched for them, recorded or replayed,
+        // so simulation should only read actions in update_tick().
+        // Frames see the live state, which leaves the camera and the
+        // like to the viewer during replays.
         
         Input *
         save(const char *filename);
         
         Input *
         load(const char *filename);
+
+        bool
+        record(const char *filename, unsigned long seed);
+        // Log action states of every tick along with the RNG seed
+
+        bool
+        replay(const char *filename, unsigned long &seed);
+        // Play back a recording instead of live devices and return its seed
+
+        bool
+        is_replaying(void) const { return this->mode == REPLAYING || this->mode == REPLAY_FINISHED; };
+
+        void
+        update_tick(void);
+        // Latch (and record, or replay) the action states seen by this tick
+
+        void
+        update_frame(void);
+        // Keep the presses of a freshly polled frame for the next tick,
+        // which may come a few frames later
         
     protected:
+        typedef
+            enum
+            {
+                LIVE,
+                RECORDING,
+                REPLAYING,
+                REPLAY_FINISHED
+            }
+            Mode;
+
         typedef
             struct
             {
@@ -179,6 +220,22 @@ namespace core
             Binding;
         
         Binding binding[MAX_BINDINGS];
+
+        Mode          mode;
+        File         *tape;
+        unsigned long tape_ticks;
+        float         state[ACTIONS + STICK_AXES]; // Latched by update_tick()
+        float         pressed[ACTIONS];            // Presses since the last tick
+        bool          ticking;
+
+        float
+        evaluate(Action action, bool edges = true);
+        // Live state of an action from its bindings, with edges false
+        // leaving out press, release and type events
+
+        float
+        latch(Action action);
+        // State of an action for this tick, consuming its presses
     };
     
     class InputEngine:
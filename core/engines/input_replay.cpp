@@ -0,0 +1,197 @@
+/*
+    Input recordings.
+    A recording holds the RNG seed and the action states of every tick,
+    stored as changes to the previous tick:
+
+        "CRPL" uint8 version, uint8 channels, uint8 has_stick, uint32 seed
+        per tick: uint8 n, n * (uint8 channel, float value)
+
+    Channels are the Input actions followed by STICK_AXES joystick axes.
+    Values are quantized as by File::write_float() while recording too,
+    so that the recorded run sees exactly what the replay will.
+*/
+
+#include "input.h"
+
+#include "../engine.h"
+#include "../util/file.h"
+
+#define REPLAY_MAGIC   "CRPL"
+#define REPLAY_VERSION 1
+
+using namespace core;
+
+static float
+_quantize(float f)
+{
+    // Same fixed point precision as File::write_float()
+    unsigned long int i = (unsigned long int)(((f < 0.0f) ? -f : f) * 65535.0f);
+    return (f < 0.0f)
+        ? (float)i / -65535.0f
+        : (float)i / 65535.0f;
+}
+
+bool
+Input::record(const char *filename, unsigned long seed)
+{
+    File *tape = new File(filename);
+
+    try
+    {
+        tape->write_magic(REPLAY_MAGIC);
+        tape->write_uint8(REPLAY_VERSION);
+        tape->write_uint8(ACTIONS + STICK_AXES);
+        tape->write_uint8(this->joysticks > 0);
+        tape->write_uint32(seed);
+    }
+    catch (int)
+    {
+        core::engine.log("(!) Failed to record input to %s", filename);
+        delete tape;
+        return false;
+    }
+
+    delete this->tape;
+    this->tape       = tape;
+    this->tape_ticks = 0;
+    this->mode       = RECORDING;
+    core::engine.log("Recording input to %s (seed %lu)", filename, seed);
+
+    return true;
+}
+
+bool
+Input::replay(const char *filename, unsigned long &seed)
+{
+    File *tape = new File(filename);
+
+    try
+    {
+        if (!tape->exists())
+        {
+            throw 404;
+        }
+
+        tape->test_magic(REPLAY_MAGIC);
+        if (tape->read_uint8() != REPLAY_VERSION
+            || (int)tape->read_uint8() != ACTIONS + STICK_AXES)
+        {
+            throw 666;
+        }
+    }
+    catch (int)
+    {
+        core::engine.log("(!) Failed to replay %s: missing or incompatible recording", filename);
+        delete tape;
+        return false;
+    }
+
+    bool has_stick = tape->read_uint8();
+    seed           = tape->read_uint32();
+
+    // Replace live controllers with a single virtual stick, if one was used
+    delete[] this->joystick;
+    this->joystick  = NULL;
+    this->joysticks = 0;
+    if (has_stick)
+    {
+        this->joystick  = new Device[1];
+        this->joysticks = 1;
+        this->joystick[0].init("replay", 0, STICK_AXES);
+    }
+
+    delete this->tape;
+    this->tape       = tape;
+    this->tape_ticks = 0;
+    this->mode       = REPLAYING;
+    core::engine.log("Replaying input from %s (seed %lu)", filename, seed);
+
+    return true;
+}
+
+void
+Input::update_tick(void)
+{
+    this->ticking = true;
+
+    switch (this->mode)
+    {
+        case LIVE:
+            for (int a = 0; a < ACTIONS; ++a)
+            {
+                this->state[a] = this->latch((Action)a);
+            }
+            break;
+
+        case RECORDING:
+        {
+            int   changed = 0;
+            Uint8 channel[ACTIONS + STICK_AXES];
+
+            for (int c = 0; c < ACTIONS + STICK_AXES; ++c)
+            {
+                float value;
+                if (c < ACTIONS)
+                {
+                    value = _quantize(this->latch((Action)c));
+                }
+                else if (this->joysticks > 0 && c - ACTIONS < this->joystick[0].axes)
+                {
+                    // Let this tick see the quantized axis as well
+                    value = _quantize(this->joystick[0](c - ACTIONS));
+                    this->joystick[0].axis_data[c - ACTIONS] = value;
+                }
+                else
+                {
+                    value = 0.0f;
+                }
+
+                if (value != this->state[c])
+                {
+                    this->state[c]     = value;
+                    channel[changed++] = c;
+                }
+            }
+
+            this->tape->write_uint8(changed);
+            for (int i = 0; i < changed; ++i)
+            {
+                this->tape->write_uint8(channel[i]);
+                this->tape->write_float(this->state[channel[i]]);
+            }
+            ++this->tape_ticks;
+            break;
+        }
+
+        case REPLAYING:
+        {
+            int changed = this->tape->read_uint8();
+            if (this->tape->eof())
+            {
+                core::engine.log("Replay finished after %lu ticks", this->tape_ticks);
+                this->mode = REPLAY_FINISHED;
+                break;
+            }
+
+            for (int i = 0; i < changed; ++i)
+            {
+                int   c     = this->tape->read_uint8();
+                float value = this->tape->read_float();
+                if (c < ACTIONS + STICK_AXES)
+                {
+                    this->state[c] = value;
+                }
+            }
+
+            for (int a = 0; a < STICK_AXES && this->joysticks > 0; ++a)
+            {
+                this->joystick[0].axis_data[a] = this->state[ACTIONS + a];
+            }
+            ++this->tape_ticks;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,691 @@
+#include "jobs.h"
+#include "../util/profiler.h"
+#include "../util/scratch.h"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm> // min, max
+#include <deque>
+
+using namespace core;
+
+#define MAX_WORKERS    16
+#define MAX_JOBS       4096 // must be a power of two
+#define MAX_CHUNKS     64   // parallel_for split limit
+#define STATS_PERIOD   1000 // ms between utilization samples
+#define MAIN_BUDGET    4    // default ms per frame for main thread jobs
+
+#define JOB_INDEX_BITS      12
+#define JOB_INDEX_MASK      (MAX_JOBS - 1)
+#define JOB_GENERATION_MASK 0x000fffff
+
+#define JOB_FREE  0
+#define JOB_TAKEN 1
+
+typedef
+    struct
+    {
+        SDL_atomic_t
+            state,
+            generation; // Bumped when the job finishes, invalidating handles
+
+        JobEngine::JobFunction  function;
+        JobEngine::RangeFunction range;
+        void *data;
+        int   first, last;
+        bool  main_thread;
+
+        int
+            dependents, // First job waiting for this one to finish
+            sibling;    // Next job waiting for the same dependency
+    }
+    _Job;
+
+typedef
+    struct
+    {
+        // Chase-Lev deque: owner pushes and pops at the bottom,
+        // other workers steal from the top
+        SDL_atomic_t top, bottom;
+        int          job[MAX_JOBS];
+    }
+    _Queue;
+
+typedef
+    struct
+    {
+        int           index;
+        SDL_Thread   *thread;
+        _Queue        queue;
+
+        SDL_atomic_t  busy_time; // Microseconds spent on jobs since last sample
+        unsigned long jobs, steals;
+        float         utilization;
+    }
+    _Worker;
+
+static struct
+{
+    _Job    job[MAX_JOBS];
+    _Worker worker[MAX_WORKERS];
+    int     worker_count;
+
+    SDL_atomic_t
+        next_job,
+        sleeping,
+        quit,
+        shared_count;
+
+    SDL_mutex
+        *dependency_lock,
+        *shared_lock,
+        *sleep_lock;
+
+    SDL_cond
+        *wake;
+
+    std::deque<int>
+        shared_queue, // Jobs submitted from threads outside the pool
+        main_queue;   // Jobs that must run on the main thread
+
+    SDL_TLSID     tls;
+    Uint64        frequency;
+    Uint64        main_budget; // Performance counter ticks per frame
+    unsigned long sample_ticks;
+} _pool;
+
+static int
+_size(int top, int bottom)
+{
+    // Counters wrap around, compare as unsigned
+    return (int)((unsigned int)bottom - (unsigned int)top);
+}
+
+static bool
+_push(_Queue *q, int job)
+{
+    int
+        b = SDL_AtomicGet(&q->bottom),
+        t = SDL_AtomicGet(&q->top);
+
+    if (_size(t, b) >= MAX_JOBS)
+    {
+        return false;
+    }
+
+    q->job[b & JOB_INDEX_MASK] = job;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&q->bottom, b + 1);
+
+    return true;
+}
+
+static int
+_pop(_Queue *q)
+{
+    int
+        b = SDL_AtomicAdd(&q->bottom, -1) - 1,
+        t = SDL_AtomicGet(&q->top),
+        n = _size(t, b);
+
+    if (n < 0)
+    {
+        SDL_AtomicSet(&q->bottom, b + 1);
+        return -1;
+    }
+
+    int job = q->job[b & JOB_INDEX_MASK];
+    if (n > 0)
+    {
+        return job;
+    }
+
+    // Last job left, race against thieves for it
+    if (!SDL_AtomicCAS(&q->top, t, t + 1))
+    {
+        job = -1;
+    }
+    SDL_AtomicSet(&q->bottom, b + 1);
+
+    return job;
+}
+
+static int
+_steal(_Queue *q)
+{
+    int t = SDL_AtomicGet(&q->top);
+    SDL_MemoryBarrierAcquire();
+    int b = SDL_AtomicGet(&q->bottom);
+
+    if (_size(t, b) <= 0)
+    {
+        return -1;
+    }
+
+    int job = q->job[t & JOB_INDEX_MASK];
+    if (!SDL_AtomicCAS(&q->top, t, t + 1))
+    {
+        return -1;
+    }
+
+    return job;
+}
+
+static int
+_current_worker(void)
+{
+    _Worker *worker = (_Worker *)SDL_TLSGet(_pool.tls);
+    return (worker != NULL) ? worker->index : -1;
+}
+
+static JobEngine::Job
+_handle(int i)
+{
+    return ((unsigned long)(SDL_AtomicGet(&_pool.job[i].generation)
+        & JOB_GENERATION_MASK) << JOB_INDEX_BITS) | i;
+}
+
+static bool
+_has_work(void)
+{
+    if (SDL_AtomicGet(&_pool.shared_count) > 0)
+    {
+        return true;
+    }
+
+    for (int w = 0; w < _pool.worker_count; ++w)
+    {
+        _Queue *q = &_pool.worker[w].queue;
+        if (_size(SDL_AtomicGet(&q->top), SDL_AtomicGet(&q->bottom)) > 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void
+_wake_worker(void)
+{
+    if (SDL_AtomicGet(&_pool.sleeping) > 0)
+    {
+        SDL_LockMutex(_pool.sleep_lock);
+        SDL_CondSignal(_pool.wake);
+        SDL_UnlockMutex(_pool.sleep_lock);
+    }
+}
+
+static void
+_schedule(int i)
+{
+    if (_pool.job[i].main_thread)
+    {
+        SDL_LockMutex(_pool.shared_lock);
+        _pool.main_queue.push_back(i);
+        SDL_UnlockMutex(_pool.shared_lock);
+        return;
+    }
+
+    int w = _current_worker();
+    if (w < 0 || !_push(&_pool.worker[w].queue, i))
+    {
+        SDL_LockMutex(_pool.shared_lock);
+        _pool.shared_queue.push_back(i);
+        SDL_AtomicAdd(&_pool.shared_count, 1);
+        SDL_UnlockMutex(_pool.shared_lock);
+    }
+
+    _wake_worker();
+}
+
+static void
+_finish(int i)
+{
+    _Job *job = &_pool.job[i];
+
+    SDL_LockMutex(_pool.dependency_lock);
+    int dependent = job->dependents;
+    job->dependents = -1;
+
+    // Skip generation 0 so that no handle equals NO_JOB
+    if (((SDL_AtomicAdd(&job->generation, 1) + 1) & JOB_GENERATION_MASK) == 0)
+    {
+        SDL_AtomicAdd(&job->generation, 1);
+    }
+    SDL_UnlockMutex(_pool.dependency_lock);
+
+    SDL_AtomicSet(&job->state, JOB_FREE);
+
+    while (dependent != -1)
+    {
+        int next = _pool.job[dependent].sibling;
+        _schedule(dependent);
+        dependent = next;
+    }
+}
+
+static void
+_run(int i, int w)
+{
+    PROFILE("job");
+
+    _Job *job = &_pool.job[i];
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    if (job->range != NULL)
+    {
+        job->range(job->first, job->last, job->data);
+    }
+    else
+    {
+        job->function(job->data);
+    }
+
+    _finish(i);
+
+    if (w >= 0)
+    {
+        _pool.worker[w].jobs++;
+        SDL_AtomicAdd(&_pool.worker[w].busy_time,
+            (int)((SDL_GetPerformanceCounter() - start) * 1000000 / _pool.frequency));
+    }
+}
+
+static int
+_find_job(int w)
+{
+    int i = -1;
+
+    if (w >= 0 && (i = _pop(&_pool.worker[w].queue)) != -1)
+    {
+        return i;
+    }
+
+    if (SDL_AtomicGet(&_pool.shared_count) > 0)
+    {
+        SDL_LockMutex(_pool.shared_lock);
+        if (!_pool.shared_queue.empty())
+        {
+            i = _pool.shared_queue.front();
+            _pool.shared_queue.pop_front();
+            SDL_AtomicAdd(&_pool.shared_count, -1);
+        }
+        SDL_UnlockMutex(_pool.shared_lock);
+
+        if (i != -1)
+        {
+            return i;
+        }
+    }
+
+    for (int n = 1; n <= _pool.worker_count; ++n)
+    {
+        int victim = (w + n) % _pool.worker_count;
+        if (victim != w && (i = _steal(&_pool.worker[victim].queue)) != -1)
+        {
+            if (w >= 0)
+            {
+                _pool.worker[w].steals++;
+            }
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static bool
+_run_main_job(void)
+{
+    int i = -1;
+
+    SDL_LockMutex(_pool.shared_lock);
+    if (!_pool.main_queue.empty())
+    {
+        i = _pool.main_queue.front();
+        _pool.main_queue.pop_front();
+    }
+    SDL_UnlockMutex(_pool.shared_lock);
+
+    if (i != -1)
+    {
+        _run(i, 0);
+        return true;
+    }
+
+    return false;
+}
+
+static int
+_worker_thread(void *data)
+{
+    _Worker *worker = (_Worker *)data;
+    SDL_TLSSet(_pool.tls, worker, NULL);
+    PROFILE_THREAD("worker");
+
+    while (!SDL_AtomicGet(&_pool.quit))
+    {
+        int i = _find_job(worker->index);
+        if (i != -1)
+        {
+            _run(i, worker->index);
+            scratch::reset();
+            continue;
+        }
+
+        SDL_LockMutex(_pool.sleep_lock);
+        SDL_AtomicAdd(&_pool.sleeping, 1);
+        if (!_has_work() && !SDL_AtomicGet(&_pool.quit))
+        {
+            SDL_CondWaitTimeout(_pool.wake, _pool.sleep_lock, 100);
+        }
+        SDL_AtomicAdd(&_pool.sleeping, -1);
+        SDL_UnlockMutex(_pool.sleep_lock);
+    }
+
+    return 0;
+}
+
+static bool
+_is_done(JobEngine::Job job)
+{
+    if (job == JobEngine::NO_JOB)
+    {
+        return true;
+    }
+
+    return (unsigned long)(SDL_AtomicGet(&_pool.job[job & JOB_INDEX_MASK].generation)
+        & JOB_GENERATION_MASK) != (job >> JOB_INDEX_BITS);
+}
+
+static void
+_wait(JobEngine::Job job)
+{
+    int w = _current_worker();
+
+    while (!_is_done(job))
+    {
+        if (w == 0 && _run_main_job())
+        {
+            continue;
+        }
+
+        int i = _find_job(w);
+        if (i != -1)
+        {
+            _run(i, w);
+        }
+        else
+        {
+            SDL_Delay(0);
+        }
+    }
+}
+
+static JobEngine::Job
+_submit(JobEngine::JobFunction function, JobEngine::RangeFunction range,
+    void *data, int first, int last, bool main_thread, JobEngine::Job after)
+{
+    int i = -1;
+
+    if (_pool.worker_count > 0)
+    {
+        for (int tries = 0; tries < MAX_JOBS && i == -1; ++tries)
+        {
+            i = SDL_AtomicAdd(&_pool.next_job, 1) & JOB_INDEX_MASK;
+            if (!SDL_AtomicCAS(&_pool.job[i].state, JOB_FREE, JOB_TAKEN))
+            {
+                i = -1;
+            }
+        }
+    }
+
+    if (i == -1)
+    {
+        // Not started yet or out of job slots, run right away
+        _wait(after);
+        if (range != NULL)
+        {
+            range(first, last, data);
+        }
+        else
+        {
+            function(data);
+        }
+        return JobEngine::NO_JOB;
+    }
+
+    _Job *job = &_pool.job[i];
+    job->function    = function;
+    job->range       = range;
+    job->data        = data;
+    job->first       = first;
+    job->last        = last;
+    job->main_thread = main_thread;
+    job->dependents  = -1;
+    job->sibling     = -1;
+
+    JobEngine::Job handle = _handle(i);
+    bool blocked = false;
+
+    if (after != JobEngine::NO_JOB)
+    {
+        SDL_LockMutex(_pool.dependency_lock);
+        if (!_is_done(after))
+        {
+            _Job *dependency = &_pool.job[after & JOB_INDEX_MASK];
+            job->sibling           = dependency->dependents;
+            dependency->dependents = i;
+            blocked = true;
+        }
+        SDL_UnlockMutex(_pool.dependency_lock);
+    }
+
+    if (!blocked)
+    {
+        _schedule(i);
+    }
+
+    return handle;
+}
+
+JobEngine::JobEngine()
+{
+    _pool.worker_count = 0;
+    this->register_module(this);
+}
+
+JobEngine::~JobEngine()
+{
+    if (_pool.worker_count == 0)
+    {
+        return;
+    }
+
+    SDL_AtomicSet(&_pool.quit, 1);
+
+    SDL_LockMutex(_pool.sleep_lock);
+    SDL_CondBroadcast(_pool.wake);
+    SDL_UnlockMutex(_pool.sleep_lock);
+
+    for (int w = 1; w < _pool.worker_count; ++w)
+    {
+        SDL_WaitThread(_pool.worker[w].thread, NULL);
+    }
+
+    for (int w = 0; w < _pool.worker_count; ++w)
+    {
+        this->log("Worker %i ran %lu jobs (%lu stolen)", w,
+            _pool.worker[w].jobs, _pool.worker[w].steals);
+    }
+
+    SDL_DestroyCond(_pool.wake);
+    SDL_DestroyMutex(_pool.sleep_lock);
+    SDL_DestroyMutex(_pool.shared_lock);
+    SDL_DestroyMutex(_pool.dependency_lock);
+}
+
+void
+JobEngine::initialize_module(void)
+{
+    int threads = std::max(0, std::min(MAX_WORKERS - 1,
+        this->config["engine"]["threads"].integer(SDL_GetCPUCount() - 1)));
+
+    for (int i = 0; i < MAX_JOBS; ++i)
+    {
+        SDL_AtomicSet(&_pool.job[i].state, JOB_FREE);
+        SDL_AtomicSet(&_pool.job[i].generation, 1);
+        _pool.job[i].dependents = -1;
+    }
+
+    SDL_AtomicSet(&_pool.next_job, 0);
+    SDL_AtomicSet(&_pool.sleeping, 0);
+    SDL_AtomicSet(&_pool.quit, 0);
+    SDL_AtomicSet(&_pool.shared_count, 0);
+
+    _pool.dependency_lock = SDL_CreateMutex();
+    _pool.shared_lock     = SDL_CreateMutex();
+    _pool.sleep_lock      = SDL_CreateMutex();
+    _pool.wake            = SDL_CreateCond();
+    _pool.tls             = SDL_TLSCreate();
+    _pool.frequency       = SDL_GetPerformanceFrequency();
+    _pool.sample_ticks    = SDL_GetTicks();
+    _pool.main_budget     = _pool.frequency * std::max(0,
+        this->config["engine"]["main_budget"].integer(MAIN_BUDGET)) / 1000;
+
+    for (int w = 0; w <= threads; ++w)
+    {
+        _Worker *worker = &_pool.worker[w];
+        worker->index       = w;
+        worker->thread      = NULL;
+        worker->jobs        = 0;
+        worker->steals      = 0;
+        worker->utilization = 0.0f;
+        SDL_AtomicSet(&worker->busy_time, 0);
+        SDL_AtomicSet(&worker->queue.top, 0);
+        SDL_AtomicSet(&worker->queue.bottom, 0);
+    }
+
+    // Main thread is worker 0 and only runs jobs while waiting
+    SDL_TLSSet(_pool.tls, &_pool.worker[0], NULL);
+    _pool.worker_count = 1;
+
+    for (int w = 1; w <= threads; ++w)
+    {
+        _pool.worker[w].thread
+            = SDL_CreateThread(_worker_thread, "worker", &_pool.worker[w]);
+
+        if (_pool.worker[w].thread == NULL)
+        {
+            this->log("(!) Failed to create worker thread: %s", SDL_GetError());
+            break;
+        }
+
+        _pool.worker_count++;
+    }
+
+    this->log("Started %i worker threads", _pool.worker_count - 1);
+}
+
+void
+JobEngine::update_frame(void)
+{
+    // Run main thread jobs, at least one but the rest only while within
+    // the frame's budget. Jobs that resubmit themselves are cut off too.
+    Uint64 start = SDL_GetPerformanceCounter();
+    while (_run_main_job()
+        && SDL_GetPerformanceCounter() - start < _pool.main_budget);
+
+    unsigned long
+        now     = SDL_GetTicks(),
+        elapsed = now - _pool.sample_ticks;
+
+    if (elapsed >= STATS_PERIOD)
+    {
+        for (int w = 0; w < _pool.worker_count; ++w)
+        {
+            _pool.worker[w].utilization
+                = SDL_AtomicSet(&_pool.worker[w].busy_time, 0)
+                / (elapsed * 1000.0f);
+        }
+        _pool.sample_ticks = now;
+    }
+}
+
+JobEngine::Job
+JobEngine::submit(JobFunction function, void *data, Job after)
+{
+    return _submit(function, NULL, data, 0, 0, false, after);
+}
+
+JobEngine::Job
+JobEngine::submit_main(JobFunction function, void *data, Job after)
+{
+    return _submit(function, NULL, data, 0, 0, true, after);
+}
+
+void
+JobEngine::parallel_for(int count, RangeFunction function, void *data, int grain)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    int
+        chunks = std::min(MAX_CHUNKS, std::max(1, _pool.worker_count * 4)),
+        size   = std::max(std::max(grain, 1), (count + chunks - 1) / chunks),
+        first  = 0,
+        n      = 0;
+
+    Job job[MAX_CHUNKS];
+    for (; first + size < count; first += size)
+    {
+        job[n++] = _submit(NULL, function, data, first, first + size, false, NO_JOB);
+    }
+
+    // Caller takes the last chunk
+    function(first, count, data);
+
+    for (int i = 0; i < n; ++i)
+    {
+        this->wait(job[i]);
+    }
+}
+
+bool
+JobEngine::is_done(Job job)
+const
+{
+    return _is_done(job);
+}
+
+void
+JobEngine::wait(Job job)
+{
+    _wait(job);
+}
+
+int
+JobEngine::worker_count(void)
+const
+{
+    return _pool.worker_count;
+}
+
+JobEngine::WorkerStats
+JobEngine::get_worker_stats(int worker)
+const
+{
+    WorkerStats stats = { 0, 0, 0.0f };
+
+    if (worker >= 0 && worker < _pool.worker_count)
+    {
+        stats.jobs        = _pool.worker[worker].jobs;
+        stats.steals      = _pool.worker[worker].steals;
+        stats.utilization = _pool.worker[worker].utilization;
+    }
+
+    return stats;
+}
@@ -0,0 +1,82 @@
+#ifndef _CORE_ENGINES_JOBS_H
+#define _CORE_ENGINES_JOBS_H
+
+#include "core.h"
+
+namespace core
+{
+    class JobEngine:
+        virtual public EngineCore,
+        public EngineInterface
+    {
+    public:
+        typedef
+            unsigned long
+            Job;
+            // Handle to a scheduled job, NO_JOB is never a valid handle
+
+        typedef
+            void (*JobFunction)(void *data);
+
+        typedef
+            void (*RangeFunction)(int first, int last, void *data);
+            // Processes items [first, last)
+
+        typedef
+            struct
+            {
+                unsigned long
+                    jobs,   // Jobs run since startup
+                    steals; // Jobs taken from other workers' queues
+                float
+                    utilization; // Busy time ratio over the last sample period
+            }
+            WorkerStats;
+
+        static const Job
+            NO_JOB = 0;
+
+        JobEngine();
+        ~JobEngine();
+
+        virtual const char *
+        get_module_name(void) { return "jobs"; };
+
+        virtual void
+        initialize_module(void);
+
+        virtual void
+        update_frame(void);
+
+        Job
+        submit(JobFunction function, void *data, Job after = NO_JOB);
+        // Run function(data) on any worker once job "after" has finished
+
+        Job
+        submit_main(JobFunction function, void *data, Job after = NO_JOB);
+        // Run function(data) on the main thread (for GL calls). Each frame
+        // runs these for up to engine/main_budget ms (at least one), the rest
+        // wait for the next frame. Keep them short.
+
+        void
+        parallel_for(int count, RangeFunction function, void *data, int grain = 1);
+        // Split [0, count) into chunks of at least grain items and wait for all of them
+
+        bool
+        is_done(Job job) const;
+
+        void
+        wait(Job job);
+        // Block until job has finished, running other jobs in the meantime
+
+        int
+        worker_count(void) const;
+        // Number of threads executing jobs, including the main thread
+
+        WorkerStats
+        get_worker_stats(int worker) const;
+        // Worker 0 is the main thread
+    };
+}
+
+#endif
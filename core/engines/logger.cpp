@@ -3,36 +3,740 @@
 #include <cstdio>
 #include <cstdarg>
 #include <cstring>
+#include <csignal>
+
+#include <SDL2/SDL.h>
+
+#ifdef _WIN32
+#	include <io.h>     // _write, for the crash handler
+#else
+#	include <unistd.h> // write
+#endif
 
 #include "../../version.h"
 #include "../util/file.h"
+#include "../util/profiler.h"
+
+#define MAX_THREADS    32
+#define RING_SIZE      1024 // lines per thread, must be a power of two
+#define LINE_SIZE      240  // longer lines are truncated
+#define FLUSH_INTERVAL 50   // ms
+#define MAX_ARGUMENTS  8    // more are formatted by the caller
+#define MAX_SPEC       16   // longest conversion spec, "%-08.3lf" and such
+
+// Conversions whose arguments are copied for the writer to format
+#define FLAGS          "-+ #0123456789."
+#define CONVERSIONS    "diouxXcsfFeEgGaAp"
 
 using namespace core;
 
+typedef
+	enum
+	{
+		_LINE,
+		_APPEND,
+		_HEADER
+	}
+	_Kind;
+
+typedef
+	union
+	{
+		long        i;  // Any integer, unsigned ones converted back
+		double      f;
+		const void *p;
+		int         s;  // Offset of the copied string in text
+	}
+	_Argument;
+
+typedef
+	struct
+	{
+		int         sequence;
+		int         kind;
+		Uint64      time;
+		const char *format; // NULL once text holds the line
+		_Argument   argument[MAX_ARGUMENTS];
+		char        text[LINE_SIZE]; // Until then, the %s strings
+	}
+	_Entry;
+
+typedef
+	struct
+	{
+		// Single producer (the owning thread), single consumer (the writer)
+		_Entry       entry[RING_SIZE];
+		SDL_atomic_t head, tail, dropped;
+
+		int          reported; // Drops already written to the log
+	}
+	_Ring;
+
+// Zero-initialized, as the engine logs before dynamic initialization is done
+static struct
+	{
+		_Ring        *ring[MAX_THREADS];
+		SDL_atomic_t  rings, sequence, errors, running;
+		SDL_TLSID     tls;
+
+		SDL_Thread   *writer;
+		SDL_mutex    *lock;
+		SDL_cond     *wake;
+		SDL_SpinLock  draining;
+
+		FILE         *file;
+		int           fd;   // Same file, for the crash handler
+		Uint64        start;
+	}
+	_log;
+
+#define ALL_CATEGORIES ((1u << Logger::LOG_CATEGORIES) - 1)
+
+unsigned int
+Logger::mask[LOG_LEVELS] = {
+	ALL_CATEGORIES,
+	ALL_CATEGORIES,
+	ALL_CATEGORIES,
+	(LOG_MAX_LEVEL >= LOG_DEBUG) ? ALL_CATEGORIES : 0
+};
+
+const char *
+Logger::category_name[LOG_CATEGORIES] = {
+	"engine",
+	"video",
+	"sound",
+	"input",
+	"game",
+	"entity",
+	"terrain"
+};
+
+static _Ring *
+_get_ring(void)
+{
+	_Ring *ring = (_Ring *)SDL_TLSGet(_log.tls);
+	if (ring != NULL)
+	{
+		return ring;
+	}
+
+	if (SDL_AtomicGet(&_log.rings) >= MAX_THREADS)
+	{
+		return NULL;
+	}
+
+	int slot = SDL_AtomicAdd(&_log.rings, 1);
+	if (slot >= MAX_THREADS)
+	{
+		return NULL;
+	}
+
+	ring = new _Ring;
+	SDL_AtomicSet(&ring->head,    0);
+	SDL_AtomicSet(&ring->tail,    0);
+	SDL_AtomicSet(&ring->dropped, 0);
+	ring->reported = 0;
+
+	SDL_AtomicSetPtr((void **)&_log.ring[slot], ring);
+	SDL_TLSSet(_log.tls, ring, NULL);
+
+	return ring;
+}
+
+static const char *
+_conversion(const char *c, int *longs)
+// From a '%' to its conversion character, counting 'l' modifiers
+{
+	c += strspn(c + 1, FLAGS) + 1;
+	for (*longs = 0; *c == 'l' || *c == 'h'; ++c)
+	{
+		*longs += (*c == 'l');
+	}
+
+	return c;
+}
+
+static bool
+_deferrable(const char *format)
+// Whether _capture() can copy every argument the format takes
+{
+	int count = 0;
+	for (const char *c = format; (c = strchr(c, '%')) != NULL; ++c)
+	{
+		const char *spec = c;
+		int longs;
+
+		c = _conversion(c, &longs);
+		if (*c == '%')
+		{
+			continue;
+		}
+
+		if (*c == '\0' || strchr(CONVERSIONS, *c) == NULL || longs > 1 ||
+			c - spec >= MAX_SPEC - 1 || ++count > MAX_ARGUMENTS)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+_capture(_Entry *entry, const char *format, va_list arguments)
+// Copies the arguments of a _deferrable() format into the entry, strings
+// into its text as long as there's room
+{
+	int n = 0, used = 0;
+	for (const char *c = format; (c = strchr(c, '%')) != NULL; ++c)
+	{
+		int longs;
+
+		c = _conversion(c, &longs);
+		if (*c == '%')
+		{
+			continue;
+		}
+
+		_Argument &argument = entry->argument[n++];
+		switch (*c)
+		{
+			case 'd': case 'i': case 'c':
+				argument.i = (longs) ? va_arg(arguments, long) : va_arg(arguments, int);
+				break;
+
+			case 'o': case 'u': case 'x': case 'X':
+				argument.i = (longs) ? (long)va_arg(arguments, unsigned long) : (long)va_arg(arguments, unsigned int);
+				break;
+
+			case 'p':
+				argument.p = va_arg(arguments, const void *);
+				break;
+
+			case 's':
+			{
+				const char *s = va_arg(arguments, const char *);
+				if (s == NULL)
+				{
+					s = "(null)";
+				}
+
+				int length = (int)strlen(s);
+				if (length > LINE_SIZE - 1 - used)
+				{
+					length = LINE_SIZE - 1 - used;
+				}
+				memcpy(&entry->text[used], s, length);
+				entry->text[used + length] = '\0';
+
+				argument.s = used;
+				used += length + (used + length < LINE_SIZE - 1);
+				break;
+			}
+
+			default:
+				argument.f = va_arg(arguments, double);
+		}
+	}
+}
+
+static void
+_format(_Entry *entry)
+// Turns captured arguments into the line, on the writer thread
+{
+	if (entry->format == NULL)
+	{
+		return;
+	}
+
+	char  line[LINE_SIZE];
+	char *p = line, *end = line + LINE_SIZE - 1;
+	int   n = 0;
+
+	for (const char *c = entry->format; *c != '\0' && p < end; ++c)
+	{
+		if (*c != '%')
+		{
+			*p++ = *c;
+			continue;
+		}
+
+		const char *start = c;
+		int longs;
+
+		c = _conversion(c, &longs);
+		if (*c == '%')
+		{
+			*p++ = '%';
+			continue;
+		}
+
+		char spec[MAX_SPEC];
+		memcpy(spec, start, c - start + 1);
+		spec[c - start + 1] = '\0';
+
+		const _Argument &argument = entry->argument[n++];
+		size_t room    = end - p + 1;
+		int    written;
+		switch (*c)
+		{
+			case 'd': case 'i': case 'c':
+				written = (longs) ? SDL_snprintf(p, room, spec, argument.i)
+					: SDL_snprintf(p, room, spec, (int)argument.i);
+				break;
+
+			case 'o': case 'u': case 'x': case 'X':
+				written = (longs) ? SDL_snprintf(p, room, spec, (unsigned long)argument.i)
+					: SDL_snprintf(p, room, spec, (unsigned int)argument.i);
+				break;
+
+			case 'p':
+				written = SDL_snprintf(p, room, spec, argument.p);
+				break;
+
+			case 's':
+				written = SDL_snprintf(p, room, spec, &entry->text[argument.s]);
+				break;
+
+			default:
+				written = SDL_snprintf(p, room, spec, argument.f);
+		}
+
+		if (written > 0)
+		{
+			p += ((size_t)written < room) ? written : room - 1;
+		}
+	}
+
+	*p = '\0';
+	memcpy(entry->text, line, p - line + 1);
+	entry->format = NULL;
+}
+
+static void
+_write_entry(const _Entry *entry)
+{
+	switch (entry->kind)
+	{
+		case _APPEND:
+			fprintf(_log.file, " %s", entry->text);
+			break;
+
+		case _HEADER:
+			fprintf(_log.file, "\n\n%s", entry->text);
+			break;
+
+		default:
+		{
+			Uint64 frac = (entry->time - _log.start) * 100
+				/ SDL_GetPerformanceFrequency();
+			Uint64 runtime = frac / 100;
+			fprintf(_log.file, "\n  %01i:%02i:%02i.%02i - %s",
+				(int)(runtime / 3600), (int)((runtime / 60) % 60), (int)(runtime % 60), (int)(frac % 100),
+				entry->text);
+		}
+	}
+}
+
+static int
+_ring_count(void)
+{
+	int rings = SDL_AtomicGet(&_log.rings);
+	return (rings < MAX_THREADS) ? rings : MAX_THREADS;
+}
+
+static _Ring *
+_oldest(_Entry **first)
+// Ring holding the oldest unwritten entry, merging all rings in call
+// order keeps "<" appends on their line. NULL when all are empty.
+{
+	_Ring *next  = NULL;
+	int    rings = _ring_count();
+
+	*first = NULL;
+	for (int r = 0; r < rings; ++r)
+	{
+		_Ring *ring = (_Ring *)SDL_AtomicGetPtr((void **)&_log.ring[r]);
+		if (ring == NULL)
+		{
+			continue;
+		}
+
+		int tail = SDL_AtomicGet(&ring->tail);
+		if (tail == SDL_AtomicGet(&ring->head))
+		{
+			continue;
+		}
+
+		_Entry *entry = &ring->entry[tail & (RING_SIZE - 1)];
+		if (*first == NULL || entry->sequence - (*first)->sequence < 0)
+		{
+			next   = ring;
+			*first = entry;
+		}
+	}
+
+	return next;
+}
+
+static void
+_drain(void)
+{
+	bool written = false;
+	int rings = _ring_count();
+
+	_Entry *first;
+	for (_Ring *next; (next = _oldest(&first)) != NULL; )
+	{
+		_format(first);
+		_write_entry(first);
+		SDL_AtomicAdd(&next->tail, 1);
+		written = true;
+	}
+
+	for (int r = 0; r < rings; ++r)
+	{
+		_Ring *ring = (_Ring *)SDL_AtomicGetPtr((void **)&_log.ring[r]);
+		if (ring == NULL)
+		{
+			continue;
+		}
+
+		int dropped = SDL_AtomicGet(&ring->dropped);
+		if (dropped != ring->reported)
+		{
+			_Entry note;
+			note.kind   = _LINE;
+			note.time   = SDL_GetPerformanceCounter();
+			note.format = NULL;
+			sprintf(note.text, "(!) %i log lines dropped", dropped - ring->reported);
+
+			_write_entry(&note);
+			ring->reported = dropped;
+			written = true;
+		}
+	}
+
+	if (written)
+	{
+		fflush(_log.file);
+	}
+}
+
+static int
+_writer_thread(void *)
+{
+	PROFILE_THREAD("logger");
+
+	SDL_LockMutex(_log.lock);
+	while (SDL_AtomicGet(&_log.running))
+	{
+		SDL_CondWaitTimeout(_log.wake, _log.lock, FLUSH_INTERVAL);
+
+		SDL_AtomicLock(&_log.draining);
+		_drain();
+		SDL_AtomicUnlock(&_log.draining);
+	}
+	SDL_UnlockMutex(_log.lock);
+
+	return 0;
+}
+
+static void
+_push(int kind, const char *format, va_list arguments)
+{
+	_Ring *ring = _get_ring();
+	if (ring == NULL)
+	{
+		return;
+	}
+
+	int
+		head = ring->head.value, // only ever written by this thread
+		used = head - SDL_AtomicGet(&ring->tail);
+
+	if (used >= RING_SIZE)
+	{
+		SDL_AtomicAdd(&ring->dropped, 1);
+		return;
+	}
+
+	_Entry *entry = &ring->entry[head & (RING_SIZE - 1)];
+	entry->sequence = SDL_AtomicAdd(&_log.sequence, 1);
+	entry->kind     = kind;
+	entry->time     = SDL_GetPerformanceCounter();
+
+	// Formatting is left to the writer, unless the entry can't hold
+	// what it takes
+	if (_deferrable(format))
+	{
+		entry->format = format;
+		_capture(entry, format, arguments);
+	}
+	else
+	{
+		entry->format = NULL;
+		SDL_vsnprintf(entry->text, LINE_SIZE, format, arguments);
+	}
+
+	// Publish only after the entry has been written
+	SDL_AtomicSet(&ring->head, head + 1);
+
+	if (_log.writer == NULL)
+	{
+		// No background thread (yet or anymore), write through
+		SDL_AtomicLock(&_log.draining);
+		_drain();
+		SDL_AtomicUnlock(&_log.draining);
+	}
+	else if (used + 1 == RING_SIZE / 2)
+	{
+		SDL_CondSignal(_log.wake);
+	}
+}
+
+static void
+_pushf(int kind, const char *format, ...)
+{
+	va_list arguments;
+	va_start(arguments, format);
+	_push(kind, format, arguments);
+	va_end(arguments);
+}
+
+/*
+	Crash handler.
+	Only async-signal-safe calls from here on: no stdio, no allocation,
+	no sleeping. Entries the writer didn't get to format yet are written
+	with integers and strings filled in, other conversions left as they
+	are.
+*/
+
+static void
+_raw_write(const char *s, size_t length)
+{
+#ifdef _WIN32
+	_write(_log.fd, s, (unsigned int)length);
+#else
+	if (write(_log.fd, s, length) < 0)
+	{
+		// Nothing left to report it to
+	}
+#endif
+}
+
+static char *
+_raw_append(char *dst, const char *end, const char *s)
+{
+	while (*s != '\0' && dst < end)
+	{
+		*dst++ = *s++;
+	}
+
+	return dst;
+}
+
+static char *
+_raw_number(char *dst, const char *end, Uint64 n, int digits)
+// At least the given number of digits, zero padded
+{
+	char buf[24];
+	int  length = 0;
+	do
+	{
+		buf[length++] = '0' + (char)(n % 10);
+		n /= 10;
+	}
+	while (n > 0 || length < digits);
+
+	while (length > 0 && dst < end)
+	{
+		*dst++ = buf[--length];
+	}
+
+	return dst;
+}
+
+static char *
+_raw_format(char *dst, const char *end, const _Entry *entry)
+// Signal safe stand-in for _format()
+{
+	int n = 0;
+	for (const char *c = entry->format; *c != '\0' && dst < end; ++c)
+	{
+		if (*c != '%')
+		{
+			*dst++ = *c;
+			continue;
+		}
+
+		const char *start = c;
+		int longs;
+
+		c = _conversion(c, &longs);
+		if (*c == '%')
+		{
+			*dst++ = '%';
+			continue;
+		}
+
+		const _Argument &argument = entry->argument[n++];
+		switch (*c)
+		{
+			case 'd': case 'i':
+			{
+				long i = (longs) ? argument.i : (int)argument.i;
+				if (i < 0)
+				{
+					dst = _raw_append(dst, end, "-");
+				}
+				dst = _raw_number(dst, end, (i < 0) ? 0 - (Uint64)i : (Uint64)i, 1);
+				break;
+			}
+
+			case 'u':
+				dst = _raw_number(dst, end,
+					(longs) ? (unsigned long)argument.i : (unsigned int)argument.i, 1);
+				break;
+
+			case 'c':
+				*dst++ = (char)argument.i;
+				break;
+
+			case 's':
+				dst = _raw_append(dst, end, &entry->text[argument.s]);
+				break;
+
+			default:
+				while (start <= c && dst < end)
+				{
+					*dst++ = *start++;
+				}
+		}
+	}
+
+	return dst;
+}
+
+static void
+_raw_write_entry(const _Entry *entry, Uint64 frequency)
+// Same layout as _write_entry()
+{
+	char  line[LINE_SIZE + 32];
+	char *p = line, *end = line + sizeof(line);
+
+	switch (entry->kind)
+	{
+		case _APPEND:
+			p = _raw_append(p, end, " ");
+			break;
+
+		case _HEADER:
+			p = _raw_append(p, end, "\n\n");
+			break;
+
+		default:
+		{
+			Uint64 frac = (entry->time - _log.start) * 100 / frequency;
+			Uint64 runtime = frac / 100;
+			p = _raw_append(p, end, "\n  ");
+			p = _raw_number(p, end, runtime / 3600, 1);
+			p = _raw_append(p, end, ":");
+			p = _raw_number(p, end, (runtime / 60) % 60, 2);
+			p = _raw_append(p, end, ":");
+			p = _raw_number(p, end, runtime % 60, 2);
+			p = _raw_append(p, end, ".");
+			p = _raw_number(p, end, frac % 100, 2);
+			p = _raw_append(p, end, " - ");
+		}
+	}
+
+	if (entry->format == NULL)
+	{
+		p = _raw_append(p, end, entry->text);
+	}
+	else
+	{
+		p = _raw_format(p, end, entry);
+	}
+	_raw_write(line, p - line);
+}
+
+static void
+_crash(int signal_number)
+{
+	// The writer flushes before letting go of the lock, so holding it
+	// means nothing is left in the stdio buffer to be overtaken. Give up
+	// on the rings if it can't be had, as the crash may be in the writer.
+	bool locked = false;
+	for (int i = 0; i < 1000000 && !locked; ++i)
+	{
+		locked = SDL_AtomicTryLock(&_log.draining);
+	}
+
+	if (locked)
+	{
+		Uint64 frequency = SDL_GetPerformanceFrequency();
+
+		_Entry *first;
+		for (_Ring *next; (next = _oldest(&first)) != NULL; )
+		{
+			_raw_write_entry(first, frequency);
+			SDL_AtomicAdd(&next->tail, 1);
+		}
+	}
+
+	char  line[64];
+	char *p = line, *end = line + sizeof(line);
+	p = _raw_append(p, end, "\n(!) Caught signal ");
+	p = _raw_number(p, end, signal_number, 1);
+	p = _raw_append(p, end, ", terminating\n");
+	_raw_write(line, p - line);
+
+	signal(signal_number, SIG_DFL);
+	raise(signal_number);
+}
+
 Logger::Logger()
 {
 	const char *filename = DATA_DIRECTORY "../" APP_TITLE ".log";
-	
+
 	this->logging_enabled = true;
-	this->error_count          = 0;
-	this->file            = (void *)fopen(filename, "w");
-	
-	if (this->file == NULL)
+	_log.file             = fopen(filename, "w");
+	_log.start            = SDL_GetPerformanceCounter();
+
+	if (_log.file == NULL)
 	{
 		printf("(!) Failed to write runtime log to %s\n", filename);
-		this->error_count++;
 		this->logging_enabled = false;
 		return;
 	}
-	
+
 	time(&start_time);
-	if (fprintf((FILE *)this->file, "%s (%s)\nLog of the latest runtime,\n%s",
+	if (fprintf(_log.file, "%s (%s)\nLog of the latest runtime,\n%s",
 		APP_TITLE, VER_STRING, ctime(&start_time)) < 0)
 	{
 		printf("(!) Failed to write runtime log to %s\n", filename);
-		this->error_count++;
-		return;
+		SDL_AtomicAdd(&_log.errors, 1);
 	}
+	fflush(_log.file);
+
+#ifdef _WIN32
+	_log.fd = _fileno(_log.file);
+#else
+	_log.fd = fileno(_log.file);
+#endif
+
+	_log.tls  = SDL_TLSCreate();
+	_log.lock = SDL_CreateMutex();
+	_log.wake = SDL_CreateCond();
+	SDL_AtomicSet(&_log.running, 1);
+	_log.writer = SDL_CreateThread(_writer_thread, "logger", NULL);
+
+	signal(SIGSEGV, _crash);
+	signal(SIGABRT, _crash);
+	signal(SIGFPE,  _crash);
+	signal(SIGILL,  _crash);
 }
 
 void
@@ -40,8 +744,7 @@ Logger::log_header(const char *s)
 {
 	if (this->logging_enabled)
 	{
-		fprintf((FILE *)this->file, "\n\n%s", s);
-		fflush((FILE *)this->file);
+		_pushf(_HEADER, "%s", s);
 	}
 }
 
@@ -49,67 +752,91 @@ void
 Logger::log(const char *format, ...)
 {
 	va_list arguments;
-	const char *s;
-	int r;
 
-	if (!this->logging_enabled || this->file == NULL)
+	if (!this->logging_enabled)
 	{
 		return;
 	}
-	
+
+	if (strstr(format, "(!)") != NULL)
+	{
+		SDL_AtomicAdd(&_log.errors, 1);
+	}
+
+	va_start(arguments, format);
 	if (format[0] == '<')
 	{
-		s = &format[1];
-		fputc(' ', (FILE *)this->file);
+		_push(_APPEND, &format[1], arguments);
 	}
 	else
 	{
-		s = format;
-		clock_t frac    = clock() * 100 / CLOCKS_PER_SEC;
-		clock_t runtime = frac / 100;
-		r = fprintf((FILE *)this->file, "\n  %01i:%02i:%02i.%02i - ",
-			(int)(runtime / 3600), (int)((runtime / 60) % 60), (int)(runtime % 60), (int)(frac % 100));
-		
-		if (r < 0)
+		_push(_LINE, format, arguments);
+	}
+	va_end(arguments);
+}
+
+void
+Logger::filter(Category category, int level)
+{
+	for (int l = 0; l < LOG_LEVELS; ++l)
+	{
+		if (l <= level)
 		{
-			return;
+			mask[l] |= (1u << category);
+		}
+		else
+		{
+			mask[l] &= ~(1u << category);
 		}
 	}
+}
 
-	if (strstr(s, "(!)") != NULL)
+void
+Logger::flush(void)
+{
+	if (this->logging_enabled)
 	{
-		this->error_count++;
+		SDL_AtomicLock(&_log.draining);
+		_drain();
+		SDL_AtomicUnlock(&_log.draining);
 	}
-	
-	va_start(arguments, format);
-	r = vfprintf((FILE *)this->file, s, arguments);
-	va_end(arguments);
-	
-	fflush((FILE *)this->file);
 }
 
 Logger::~Logger()
 {
 	long runtime;
 	time_t current_time;
-	
-	if (this->file != NULL)
+
+	if (_log.file != NULL)
 	{
+		if (_log.writer != NULL)
+		{
+			SDL_LockMutex(_log.lock);
+			SDL_AtomicSet(&_log.running, 0);
+			SDL_CondSignal(_log.wake);
+			SDL_UnlockMutex(_log.lock);
+
+			SDL_WaitThread(_log.writer, NULL);
+			_log.writer = NULL;
+		}
+		this->flush();
+
 		time(&current_time);
 		runtime = difftime(current_time, start_time);
-		
-		fprintf((FILE *)this->file, "\n\n\nTotal runtime: %02i:%02i:%02i\n",
+
+		fprintf(_log.file, "\n\n\nTotal runtime: %02i:%02i:%02i\n",
 			(int)((runtime / 3600) % 100), (int)((runtime / 60) % 60), (int)(runtime % 60));
-		
-		if (this->error_count)
+
+		if (SDL_AtomicGet(&_log.errors))
 		{
-			fprintf((FILE *)this->file, "Errors: %i.\n", this->error_count);
+			fprintf(_log.file, "Errors: %i.\n", SDL_AtomicGet(&_log.errors));
 		}
 		else
 		{
-			fprintf((FILE *)this->file, "There were no errors.\n");
+			fprintf(_log.file, "There were no errors.\n");
 		}
-		
-		// fclose((FILE *)this->file);
+		fflush(_log.file);
+
+		// fclose(_log.file);
 	}
 }
@@ -1,13 +1,71 @@
+/*
+    Runtime log.
+    Plain log() calls are always written. Chatty subsystems tag their
+    messages with a level and a category instead:
+
+        ------------------------------------------------------------------------
+        LOG(DEBUG, ENTITY)("Creating entity #%i", id);
+        ------------------------------------------------------------------------
+
+    Levels above LOG_MAX_LEVEL compile to nothing, arguments included.
+    The rest cost one test against a cached mask, set up from the "log"
+    config section (log/level and per-category log/<category>, 0 = errors
+    only ... 3 = debug).
+*/
+
 #ifndef _CORE_ENGINES_LOGGER_H
 #define _CORE_ENGINES_LOGGER_H
 
 #include <ctime>
 
+#ifndef LOG_MAX_LEVEL
+#   ifdef DEBUG
+#       define LOG_MAX_LEVEL 3
+#   else
+#       define LOG_MAX_LEVEL 2
+#   endif
+#endif
+
+#define LOG(level, category) \
+    if (core::Logger::LOG_##level > LOG_MAX_LEVEL \
+        || !core::Logger::is_logged(core::Logger::LOG_##level, core::Logger::LOG_##category)) {} \
+    else core::engine.log
+
 namespace core
 {
     class Logger
     {
     public:
+        typedef
+            enum
+            {
+                LOG_ERROR,
+                LOG_WARNING,
+                LOG_INFO,
+                LOG_DEBUG,
+
+                LOG_LEVELS
+            }
+            Level;
+
+        typedef
+            enum
+            {
+                LOG_ENGINE,
+                LOG_VIDEO,
+                LOG_SOUND,
+                LOG_INPUT,
+                LOG_GAME,
+                LOG_ENTITY,
+                LOG_TERRAIN,
+
+                LOG_CATEGORIES
+            }
+            Category;
+
+        static const char *
+            category_name[LOG_CATEGORIES]; // Config keys under "log"
+
         Logger();
         ~Logger();
 
@@ -16,12 +74,27 @@ namespace core
 
         void
         log(const char *format, ...);
+        // Copies the arguments into a per-thread buffer, a background thread
+        // formats them and writes the file. The format has to outlive that,
+        // as literals do, %s strings are copied.
+
+        void
+        flush(void);
+        // Write out everything logged so far before returning
+
+        static void
+        filter(Category category, int level);
+        // Log messages of category up to level (LOG_MAX_LEVEL still applies)
+
+        static inline bool
+        is_logged(Level level, Category category) { return (mask[level] >> category) & 1; };
 
     private:
-        void   *file;
-        int    error_count;
+        static unsigned int
+            mask[LOG_LEVELS]; // Bit per category enabled at each level
+
         time_t start_time;
-        
+
         bool   logging_enabled;
     };
 }
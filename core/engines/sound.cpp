@@ -1,6 +1,8 @@
 #include "sound.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_Mixer.h>
+#include <vector>
+#include <cstdio> // fopen
 
 #include "../util/file.h"
 #include "../util/string.h"
@@ -16,9 +18,12 @@ using namespace core;
 
 #include "../engine.h"
 
+static core::Config::Handle
+    _sound_volume(core::engine.config, "audio/volume/sound");
+
 typedef
-    std::map<core::Config::Hash, Mix_Chunk *>
-    SoundLibrary;
+    std::vector<Mix_Chunk *>
+    SoundLibrary; // Indexed by symbol, NULL for symbols that aren't sounds
 
 static struct
 {
@@ -45,7 +50,7 @@ SoundEngine::update_frame(void)
             if (channel != -1)
             {
                 Mix_Volume(channel,
-                    this->config["audio"]["volume"]["sound"].percentage(100)
+                    _sound_volume.percentage(100)
                     * sound_queue[i].volume * MIX_MAX_VOLUME);
             }
             else
@@ -121,7 +126,7 @@ SoundEngine::~SoundEngine()
     for (SoundLibrary::iterator sfx = sounds->begin();
     sfx != sounds->end(); ++sfx)
     {
-        Mix_FreeChunk(sfx->second);
+        Mix_FreeChunk(*sfx);
     }
     delete sounds;
     
@@ -146,7 +151,7 @@ SoundEngine::reload_music_library(void)
     for (SoundLibrary::iterator sfx = sounds->begin();
     sfx != sounds->end(); ++sfx)
     {
-        Mix_FreeChunk(sfx->second);
+        Mix_FreeChunk(*sfx);
     }
     sounds->clear();
 
@@ -160,9 +165,13 @@ SoundEngine::reload_music_library(void)
         char *name     = core::str::dup(wav[i]);
         char *filename = core::str::format(SOUND_DIRECTORY "%s.wav", name);
         
-        core::Config::Hash hash = core::Config::get_hash(core::str::lcase(name));
+        core::symbol::Id id = core::symbol::intern(core::str::lcase(name));
+        if (id >= sounds->size())
+        {
+            sounds->resize(id + 1, NULL);
+        }
         
-        if (sounds->find(hash) == sounds->end())
+        if ((*sounds)[id] == NULL)
         {
             Mix_Chunk *chunk = Mix_LoadWAV(filename);
             
@@ -172,7 +181,7 @@ SoundEngine::reload_music_library(void)
             }
             else
             {
-                sounds->insert(std::make_pair(hash, chunk));
+                (*sounds)[id] = chunk;
             }
         }
         
@@ -207,6 +216,19 @@ SoundEngine::reload_music_library(void)
 
 void
 SoundEngine::play_sound_at(const char *sound, float distance, float volume)
+{
+    core::symbol::Id id = core::symbol::find(sound);
+    if (id == core::symbol::NONE)
+    {
+        this->log("(!) Unknown sound effect: '%s'", sound);
+        return;
+    }
+
+    this->play_sound_at(id, distance, volume);
+}
+
+void
+SoundEngine::play_sound_at(core::symbol::Id sound, float distance, float volume)
 {
     static const float min_damping_dist   = 25.0f;
     static const float damping_multiplier = .08f;
@@ -224,38 +246,52 @@ SoundEngine::play_sound_at(const char *sound, float distance, float volume)
 void
 SoundEngine::play_sound(const char *sound, unsigned long delay, float volume)
 {
-    SoundLibrary *sounds       = (SoundLibrary *)this->sound_data;
-    core::Config::Hash hash    = core::Config::get_hash(sound);
-    SoundLibrary::iterator sfx = sounds->find(hash);
-    
-    if (sfx == sounds->end())
+    core::symbol::Id id = core::symbol::find(sound);
+    if (id == core::symbol::NONE)
     {
         this->log("(!) Unknown sound effect: '%s'", sound);
         return;
     }
 
+    this->play_sound(id, delay, volume);
+}
+
+void
+SoundEngine::play_sound(core::symbol::Id sound, unsigned long delay, float volume)
+{
+    SoundLibrary *sounds = (SoundLibrary *)this->sound_data;
+    Mix_Chunk    *chunk  = (sound < sounds->size())
+        ? (*sounds)[sound]
+        : NULL;
+    
+    if (chunk == NULL)
+    {
+        this->log("(!) Unknown sound effect: '%s'", core::symbol::name(sound));
+        return;
+    }
+
     for (int i = 0; i < SOUND_QUEUE_LEN; ++i)
     {
         if (sound_queue[i].chunk == NULL)
         {
-            sound_queue[i].chunk  = sfx->second;
+            sound_queue[i].chunk  = chunk;
             sound_queue[i].volume = volume;
             sound_queue[i].ticks  = this->ticks + delay;
             
             if (delay)
             {
-                this->log("Sound effect: %s (delayed %0.1f s)", sound, delay / 1000.0f);
+                LOG(DEBUG, SOUND)("Sound effect: %s (delayed %0.1f s)", core::symbol::name(sound), delay / 1000.0f);
             }
             else
             {
-                this->log("Sound effect: %s", sound);
+                LOG(DEBUG, SOUND)("Sound effect: %s", core::symbol::name(sound));
             }
 
             return;
         }
     }
     
-    this->log("(!) Failed to play sound effect %s: queue full", sound);
+    this->log("(!) Failed to play sound effect %s: queue full", core::symbol::name(sound));
 }
 
 void
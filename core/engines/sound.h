@@ -33,6 +33,14 @@ namespace core
         
         void
         play_sound_at(const char *sound, float distance, float volume = 1.0f);
+
+        void
+        play_sound(symbol::Id sound, unsigned long delay = 0, float volume = 1.0f);
+
+        void
+        play_sound_at(symbol::Id sound, float distance, float volume = 1.0f);
+        // Sound effects are named by their lower case file names without
+        // the extension, interned as symbols on load
         
         void
         play_music(const char *theme);
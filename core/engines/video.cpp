@@ -9,6 +9,9 @@
 #include "input.h"
 #include "../engine.h"
 #include "../../version.h"
+#include "../util/file.h"
+#include "../util/string.h"
+#include "../util/profiler.h"
 #include "../../gfx/3d/program.h"
 #include "../../gfx/3d/material.h"
 #include "../../gfx/3d/model.h"
@@ -19,6 +22,13 @@ core::Graphics screen;
 
 using namespace core;
 
+#ifdef USE_OPENGL
+// Megabytes of estimated texture and model memory kept for reuse
+static core::Config::Handle
+    _gpu_budget(core::engine.config, "video/cache/gpu_budget"),
+    _cpu_budget(core::engine.config, "video/cache/cpu_budget");
+#endif
+
 void
 VideoEngine::update_tick(void)
 {
@@ -31,14 +41,56 @@ VideoEngine::update_frame(void)
     {
         screen.set_fullscreen(!screen.fullscreen);
     }
+
+#ifdef PROFILING
+    if (input[Input::PROFILER_CAPTURE])
+    {
+        char *filename = str::format(DATA_DIRECTORY "../" APP_TITLE "_%i.json", (int)this->ticks);
+        if (profiler::save(filename))
+        {
+            this->log("Profile saved to %s", filename);
+        }
+        else
+        {
+            this->log("(!) Failed to save profile to %s", filename);
+        }
+        delete[] filename;
+    }
+#endif
     
     screen.show();
+
+#ifdef USE_OPENGL
+    {
+        PROFILE("Video::trim_caches");
+
+        // Evicted models release their materials, which release their textures
+        gfx::Model::trim_cache((size_t)_cpu_budget.integer(256) << 20);
+        gfx::Material::trim_cache();
+        gfx::Texture::trim_cache((size_t)_gpu_budget.integer(512) << 20);
+    }
+#endif
 }
 
 void
 VideoEngine::initialize_module()
 {
-   if (!SDL_WasInit(SDL_INIT_VIDEO))
+    if (this->config["video"]["headless"].boolean(false))
+    {
+        // Keep sound scheduling alive on machines without an audio device
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+        SDL_Init(SDL_INIT_EVENTS);
+
+        this->fast_forward = this->config["video"]["fast_forward"].boolean(true);
+
+        screen.open_headless(
+            this->config["video"]["resolution"]["x"].integer(1280),
+            this->config["video"]["resolution"]["y"].integer(720)
+        );
+        return;
+    }
+
+    if (!SDL_WasInit(SDL_INIT_VIDEO))
     {
         SDL_Init(SDL_INIT_VIDEO);
     }
@@ -118,6 +170,7 @@ Graphics::Graphics()
 {
     this->fullscreen   = false;
     this->detail_level = 0;
+    this->headless     = false;
     
     this->window       = NULL;
 
@@ -141,6 +194,11 @@ Graphics::~Graphics()
 void
 Graphics::show()
 {
+    if (this->headless)
+    {
+        return;
+    }
+
 #ifdef USE_OPENGL
     glViewport(this->x, this->y, this->w, this->h);
     SDL_GL_SwapWindow(this->window);
@@ -165,6 +223,12 @@ Graphics::resize(int w, int h, bool fullscreen)
     SDL_Texture  *tex   = NULL;
 #endif
 
+    if (this->headless)
+    {
+        this->open_headless(w, h);
+        return;
+    }
+
     if (w <= 0 || h <= 0)
     {
         engine.log("(!) Failed to set video mode: invalid parameters or graphics module uninitialized");
@@ -335,7 +399,7 @@ Graphics::resize(int w, int h, bool fullscreen)
 void
 Graphics::set_fullscreen(bool fullscreen)
 {
-    if (fullscreen != this->fullscreen)
+    if (fullscreen != this->fullscreen && !this->headless)
     {
         engine.log((fullscreen) ? "Windowed mode" : "Fullscreen mode");
         if (SDL_SetWindowFullscreen(this->window,
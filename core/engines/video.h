@@ -38,6 +38,7 @@ namespace core
         // (!) FIXME: use const references for READ-ONLIES
         bool fullscreen;        /* READ-ONLY, use set_fullscreen() instead */
         int detail_level;       /* READ-ONLY */
+        bool headless;          /* READ-ONLY, no window or GPU, see open_headless() */
         
         SDL_Window    *window;    /* READ-ONLY */
 
@@ -68,6 +69,10 @@ namespace core
         void
         set_fullscreen(bool fullscreen = true);
 
+        void
+        open_headless(int w, int h);
+        // Simulate a screen of w x h without a window, GPU calls do nothing
+
     protected:
 #ifdef USE_OPENGL
         int mutable_x, mutable_y;
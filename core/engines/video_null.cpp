@@ -0,0 +1,172 @@
+/*
+    Headless video backend.
+    Opens no window or GL context; extension entry points are replaced
+    with no-ops that hand out fake names and report success, so scenes,
+    meshes and terrain still build and "render" without a display.
+    GL 1.1 calls are dropped by the driver when no context is current.
+*/
+
+#ifdef USE_OPENGL
+#   define GLEW_STATIC
+#   define GL3_PROTOTYPES 1
+#   include <GL/glew.h>
+#endif
+
+#include "video.h"
+
+#include "../engine.h"
+
+using namespace core;
+
+#if defined(USE_OPENGL) && !defined(__APPLE__)
+
+static GLuint _next_name = 1;
+
+static void
+_gen_names(GLsizei n, GLuint *names)
+{
+    for (GLsizei i = 0; i < n; ++i)
+    {
+        names[i] = _next_name++;
+    }
+}
+
+static GLuint GLAPIENTRY _create_program(void) { return _next_name++; }
+static GLuint GLAPIENTRY _create_shader(GLenum) { return _next_name++; }
+
+static void GLAPIENTRY _gen_buffers(GLsizei n, GLuint *names) { _gen_names(n, names); }
+static void GLAPIENTRY _gen_framebuffers(GLsizei n, GLuint *names) { _gen_names(n, names); }
+static void GLAPIENTRY _gen_renderbuffers(GLsizei n, GLuint *names) { _gen_names(n, names); }
+
+static void GLAPIENTRY
+_get_iv(GLuint, GLenum pname, GLint *params)
+{
+    // Every compile and link succeeds, and there is never anything to log
+    *params = (pname == GL_INFO_LOG_LENGTH) ? 1 : GL_TRUE;
+}
+
+static void GLAPIENTRY
+_get_info_log(GLuint, GLsizei size, GLsizei *length, GLchar *log)
+{
+    if (size > 0)
+    {
+        *log = '\0';
+    }
+    if (length != NULL)
+    {
+        *length = 0;
+    }
+}
+
+static GLint GLAPIENTRY _get_location(GLuint, const GLchar *) { return -1; }
+static GLboolean GLAPIENTRY _is_false(GLuint) { return GL_FALSE; }
+
+static void GLAPIENTRY _nop_e(GLenum) {}
+static void GLAPIENTRY _nop_u(GLuint) {}
+static void GLAPIENTRY _nop_uu(GLuint, GLuint) {}
+static void GLAPIENTRY _nop_eu(GLenum, GLuint) {}
+static void GLAPIENTRY _nop_names(GLsizei, const GLuint *) {}
+static void GLAPIENTRY _nop_draw_buffers(GLsizei, const GLenum *) {}
+static void GLAPIENTRY _nop_buffer_data(GLenum, GLsizeiptr, const void *, GLenum) {}
+static void GLAPIENTRY _nop_framebuffer_renderbuffer(GLenum, GLenum, GLenum, GLuint) {}
+static void GLAPIENTRY _nop_framebuffer_texture(GLenum, GLenum, GLenum, GLuint, GLint) {}
+static void GLAPIENTRY _nop_renderbuffer_storage(GLenum, GLenum, GLsizei, GLsizei) {}
+static void GLAPIENTRY _nop_shader_source(GLuint, GLsizei, const GLchar *const *, const GLint *) {}
+static void GLAPIENTRY _nop_vertex_attrib_pointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void *) {}
+
+static void GLAPIENTRY _nop_uniform_1f(GLint, GLfloat) {}
+static void GLAPIENTRY _nop_uniform_1i(GLint, GLint) {}
+static void GLAPIENTRY _nop_uniform_2f(GLint, GLfloat, GLfloat) {}
+static void GLAPIENTRY _nop_uniform_2i(GLint, GLint, GLint) {}
+static void GLAPIENTRY _nop_uniform_3f(GLint, GLfloat, GLfloat, GLfloat) {}
+static void GLAPIENTRY _nop_uniform_4f(GLint, GLfloat, GLfloat, GLfloat, GLfloat) {}
+static void GLAPIENTRY _nop_uniform_4i(GLint, GLint, GLint, GLint, GLint) {}
+static void GLAPIENTRY _nop_uniform_matrix(GLint, GLsizei, GLboolean, const GLfloat *) {}
+
+static void
+_install_null_gl(void)
+{
+    glCreateProgram             = _create_program;
+    glCreateShader              = _create_shader;
+    glGenBuffers                = _gen_buffers;
+    glGenFramebuffers           = _gen_framebuffers;
+    glGenRenderbuffers          = _gen_renderbuffers;
+
+    glGetProgramiv              = _get_iv;
+    glGetShaderiv               = _get_iv;
+    glGetProgramInfoLog         = _get_info_log;
+    glGetShaderInfoLog          = _get_info_log;
+    glGetAttribLocation         = _get_location;
+    glGetUniformLocation        = _get_location;
+    glIsProgram                 = _is_false;
+    glIsShader                  = _is_false;
+
+    glActiveTexture             = _nop_e;
+    glGenerateMipmap            = _nop_e;
+    glCompileShader             = _nop_u;
+    glDeleteProgram             = _nop_u;
+    glDeleteShader              = _nop_u;
+    glLinkProgram               = _nop_u;
+    glUseProgram                = _nop_u;
+    glEnableVertexAttribArray   = _nop_u;
+    glDisableVertexAttribArray  = _nop_u;
+    glAttachShader              = _nop_uu;
+    glDetachShader              = _nop_uu;
+    glBindBuffer                = _nop_eu;
+    glBindFramebuffer           = _nop_eu;
+    glBindRenderbuffer          = _nop_eu;
+    glDeleteBuffers             = _nop_names;
+    glDeleteFramebuffers        = _nop_names;
+    glDeleteRenderbuffers       = _nop_names;
+    glDrawBuffers               = _nop_draw_buffers;
+    glBufferData                = _nop_buffer_data;
+    glFramebufferRenderbuffer   = _nop_framebuffer_renderbuffer;
+    glFramebufferTexture2D      = _nop_framebuffer_texture;
+    glRenderbufferStorage       = _nop_renderbuffer_storage;
+    glShaderSource              = _nop_shader_source;
+    glVertexAttribPointer       = _nop_vertex_attrib_pointer;
+
+    glUniform1f                 = _nop_uniform_1f;
+    glUniform1i                 = _nop_uniform_1i;
+    glUniform2f                 = _nop_uniform_2f;
+    glUniform2i                 = _nop_uniform_2i;
+    glUniform3f                 = _nop_uniform_3f;
+    glUniform4f                 = _nop_uniform_4f;
+    glUniform4i                 = _nop_uniform_4i;
+    glUniformMatrix4fv          = _nop_uniform_matrix;
+}
+
+#endif
+
+void
+Graphics::open_headless(int w, int h)
+{
+    if (w <= 0 || h <= 0)
+    {
+        engine.log("(!) Failed to set headless mode: invalid parameters");
+        return;
+    }
+
+    engine.log("Video mode: %i x %i (headless)", w, h);
+
+#ifdef USE_OPENGL
+#   ifndef __APPLE__
+    _install_null_gl();
+#   else
+    engine.log("(!) Headless mode is not supported on this platform");
+#   endif
+#endif
+
+    this->headless   = true;
+    this->fullscreen = false;
+
+    Sprite::resize(w, h);
+
+#ifdef USE_OPENGL
+    delete this->scene;
+    this->scene = new gfx::Scene();
+    this->scene->resize(w, h);
+#endif
+
+    engine.log("Video mode set");
+}
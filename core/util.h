@@ -3,6 +3,9 @@
 
 #include "util/config.h"
 #include "util/file.h"
+#include "util/pack.h"
+#include "util/scratch.h"
 #include "util/string.h"
+#include "util/symbol.h"
 
 #endif
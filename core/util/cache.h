@@ -9,6 +9,29 @@
         cout << cache["one"] << cache["two"];
         return 0;
         ------------------------------------------------------------------------
+
+    Entries may also carry a reference count and a size estimate in bytes.
+    trim() evicts the least recently used entries that have a size but no
+    references, until the cache fits in the given budget.
+
+    All calls are safe from any thread. Loaders reserve a key before doing
+    the work, so that others asking for it meanwhile wait for the result
+    instead of loading it again:
+
+        ------------------------------------------------------------------------
+        bool loading;
+        Texture *texture = cache.reserve(key, &loading);
+        if (loading)
+        {
+            texture = cache.store(key, Texture::load(...), size);
+        }
+        ------------------------------------------------------------------------
+
+    Don't wait on the main thread for an entry whose loader in turn waits
+    for the main thread.
+
+    Keys may also be interned symbols, whose hash is then reused instead of
+    hashing the key on every call. Both name the same entry.
         
     Phvli 2017-08-06
 */
@@ -16,8 +39,14 @@
 #ifndef _CORE_UTIL_CACHE_H
 #define _CORE_UTIL_CACHE_H
 
-#include <cstddef> // void
-#include <map>
+#include <cstddef>   // void
+#include <cstring>   // strcmp, strlen, memcpy
+#include <vector>
+#include <algorithm> // sort
+
+#include <SDL2/SDL.h>
+
+#include "symbol.h"
 
 namespace core
 {
@@ -29,11 +58,43 @@ namespace core
                 unsigned int
                 Hash; // 32-bit
             
-            Cache() {}
-            ~Cache() { this->flush(); }
+            typedef
+                struct
+                {
+                    size_t        bytes;         // Sum of entry sizes
+                    unsigned int  entries;
+                    unsigned long evictions;     // Since creation
+                    size_t        evicted_bytes;
+                }
+                Stats;
+            
+            Cache(): entry(NULL), reverse(NULL), capacity(0), used(0), clock(0)
+            {
+                this->stats.bytes         = 0;
+                this->stats.entries       = 0;
+                this->stats.evictions     = 0;
+                this->stats.evicted_bytes = 0;
+                
+                this->lock   = SDL_CreateMutex();
+                this->loaded = SDL_CreateCond();
+            }
+            ~Cache()
+            {
+                this->flush();
+                
+                // Late drops by objects outliving the cache find a NULL lock
+                SDL_DestroyCond(this->loaded);
+                SDL_DestroyMutex(this->lock);
+                this->loaded = NULL;
+                this->lock   = NULL;
+            }
             
             T *
-            store(const char *key, T *data_point);
+            store(const char *key, T *data_point, size_t size = 0)
+                { return this->store(key, Cache::get_hash(key), data_point, size); }
+            T *
+            store(symbol::Id key, T *data_point, size_t size = 0)
+                { return this->store(symbol::name(key), symbol::hash(key), data_point, size); }
             // Stores a new object and assigns given key to it.
             // The object should be deleted after it's been stored.
             // Cache destroys stored objects in its destructor.
@@ -41,18 +102,75 @@ namespace core
             // If a conflicting old value exists, data_point will
             // be destroyed immediately and the old value returned
             // instead.
+            // Size is the estimated memory cost of the object, objects
+            // of size 0 are never evicted.
+            // Storing a reserved key completes it, data_point may then be
+            // NULL for a failed load.
+            // An object is cached under one key only. If data_point is
+            // already cached under another key, key is left uncached and
+            // any reference taken by reserve() passes on to that entry.
             
             T *
-            get(const char *key);
+            reserve(const char *key, bool *loading, bool wait = true)
+                { return this->reserve(key, Cache::get_hash(key), loading, wait); }
+            T *
+            reserve(symbol::Id key, bool *loading, bool wait = true)
+                { return this->reserve(symbol::name(key), symbol::hash(key), loading, wait); }
+            // Returns the object cached under key with a reference taken.
+            // If the key is unknown, reserves it and sets *loading; the
+            // caller should then store() it, and the reservation's reference
+            // passes on to the stored object. If another thread is loading
+            // it, waits for that unless wait is false, in which case NULL
+            // is returned.
+            
+            T *
+            get(const char *key) { return this->get(key, Cache::get_hash(key)); }
+            T *
+            get(symbol::Id key)  { return this->get(symbol::name(key), symbol::hash(key)); }
             // Returns pointer to the cached object.
+            // Returns NULL while it's being loaded.
+            
+            T *
+            acquire(const char *key) { return this->acquire(key, Cache::get_hash(key)); }
+            T *
+            acquire(symbol::Id key)  { return this->acquire(symbol::name(key), symbol::hash(key)); }
+            // Same as get(), but waits for loading to finish
+            // and takes a reference.
+            
+            T *
+            acquire(T *data_point);
+            // Adds a reference to a cached object, which then won't be
+            // evicted until released. Returns data_point.
+            
+            void
+            release(const T *data_point);
+            // Removes a reference. Uncached objects are ignored.
+            
+            void
+            set_size(const T *data_point, size_t size);
+            // Updates the size estimate of a cached object.
+            
+            unsigned int
+            trim(size_t budget);
+            // Deletes the least recently used unreferenced objects until
+            // the total size fits in budget or nothing else can go.
+            // Returns the number of objects evicted.
+            
+            const Stats &
+            get_stats(void) const { return this->stats; }
+            // Not synchronized, only for reporting.
             
             T *
             operator[](const char *key) { return this->get(key); }
+            T *
+            operator[](symbol::Id key)  { return this->get(key); }
             // Same as get().
             
             bool
-            contains(const char *key);
-            // Returns true if given key is cached.
+            contains(const char *key) { return this->contains(key, Cache::get_hash(key)); }
+            bool
+            contains(symbol::Id key)  { return this->contains(symbol::name(key), symbol::hash(key)); }
+            // Returns true if given key is cached or being loaded.
             
             bool
             contains(const T *data_point);
@@ -74,14 +192,94 @@ namespace core
             // Actual objects will only be deleted if delete_targets is set to true.
 
         protected:
+            /*
+                Open addressing with linear probing. Keys are stored and
+                compared in full, the hash only picks the starting slot.
+                A second table of the same capacity maps objects back to
+                their slots, so that lookups and drops by object (done by
+                every cached object's destructor) don't scan the cache.
+            */
+            static const unsigned int NOT_FOUND = ~0u;
+
             typedef
-                std::map<Hash, T *>
-                Storage;
+                enum
+                {
+                    FREE,
+                    LIVE,
+                    LOADING, // Reserved, value not stored yet
+                    DROPPED  // Keeps probe chains intact until the next rehash
+                }
+                State;
+
+            typedef
+                struct
+                {
+                    Hash  hash;
+                    int   state;
+                    char *key;
+                    T    *value;
+                    
+                    int           references;
+                    size_t        size;
+                    unsigned long last_use;
+                }
+                Entry;
+
+            typedef
+                struct
+                {
+                    const T      *value; // NULL if free
+                    unsigned int  slot;
+                }
+                Reverse;
+
+            Entry        *entry;
+            Reverse      *reverse;
+            unsigned int  capacity; // Power of two, same for both tables
+            unsigned int  used;     // Slots not FREE
+            unsigned long clock;    // Ticks on every use, orders evictions
+            Stats         stats;
+            
+            SDL_mutex    *lock;     // Held by every public call
+            SDL_cond     *loaded;   // Signalled when a reserved key is done
             
             static Hash
             get_hash(const char *s);
+            // Same as Config::get_hash, so that symbol hashes can be used
+            
+            T *store(const char *key, Hash hash, T *data_point, size_t size);
+            T *reserve(const char *key, Hash hash, bool *loading, bool wait);
+            T *get(const char *key, Hash hash);
+            T *acquire(const char *key, Hash hash);
+            bool contains(const char *key, Hash hash);
             
-            Storage data;
+            static inline Hash
+            get_hash(const T *p) { return (Hash)(((size_t)p >> 4) * 2654435761u); }
+            
+            unsigned int
+            find(const char *key, Hash hash);
+            
+            unsigned int
+            find(const T *data_point);
+            
+            unsigned int
+            insert(const char *key, Hash hash);
+            
+            void
+            remove(unsigned int slot);
+            
+            void
+            index(const T *data_point, unsigned int slot);
+            
+            void
+            unindex(const T *data_point);
+            
+            void
+            resize(unsigned int capacity);
+        
+        private:
+            Cache(const Cache &);
+            Cache &operator=(const Cache &);
     };
 
     // Classic Jenkins
@@ -106,92 +304,501 @@ namespace core
     }
 
     template <class T>
-    bool
-    Cache<T>::contains(const char *key)
+    unsigned int
+    Cache<T>::find(const char *key, Hash hash)
     {
-        return (this->data.find(Cache::get_hash(key)) != this->data.end());
+        if (this->capacity == 0)
+        {
+            return NOT_FOUND;
+        }
+
+        unsigned int mask = this->capacity - 1;
+        for (unsigned int i = hash & mask;; i = (i + 1) & mask)
+        {
+            Entry &e = this->entry[i];
+            if (e.state == FREE)
+            {
+                return NOT_FOUND;
+            }
+            
+            if ((e.state == LIVE || e.state == LOADING)
+                && e.hash == hash && strcmp(e.key, key) == 0)
+            {
+                return i;
+            }
+        }
     }
 
     template <class T>
-    bool
-    Cache<T>::contains(const T *data_point)
+    unsigned int
+    Cache<T>::find(const T *data_point)
     {
-        for (typename Cache::Storage::iterator i = this->data.begin();
-            i != this->data.end(); ++i)
+        if (this->capacity == 0 || data_point == NULL)
         {
-            if (i->second == data_point)
+            return NOT_FOUND;
+        }
+
+        unsigned int mask = this->capacity - 1;
+        for (unsigned int i = Cache::get_hash(data_point) & mask;; i = (i + 1) & mask)
+        {
+            if (this->reverse[i].value == NULL)
+            {
+                return NOT_FOUND;
+            }
+            
+            if (this->reverse[i].value == data_point)
             {
-                return true;
+                return this->reverse[i].slot;
             }
         }
+    }
+
+    template <class T>
+    void
+    Cache<T>::index(const T *data_point, unsigned int slot)
+    {
+        if (data_point == NULL)
+        {
+            return;
+        }
 
-        return false;
+        unsigned int mask = this->capacity - 1, i;
+        for (i = Cache::get_hash(data_point) & mask;
+            this->reverse[i].value != NULL; i = (i + 1) & mask)
+        {
+            if (this->reverse[i].value == data_point)
+            {
+                // Already indexed, store() keeps objects under one key
+                return;
+            }
+        }
+        
+        this->reverse[i].value = data_point;
+        this->reverse[i].slot  = slot;
+    }
+
+    template <class T>
+    void
+    Cache<T>::unindex(const T *data_point)
+    {
+        if (this->capacity == 0 || data_point == NULL)
+        {
+            return;
+        }
+
+        unsigned int mask = this->capacity - 1, i;
+        for (i = Cache::get_hash(data_point) & mask;
+            this->reverse[i].value != data_point; i = (i + 1) & mask)
+        {
+            if (this->reverse[i].value == NULL)
+            {
+                return;
+            }
+        }
+
+        // Shift later members of the probe chain back into the gap
+        for (unsigned int j = (i + 1) & mask; this->reverse[j].value != NULL; j = (j + 1) & mask)
+        {
+            unsigned int home = Cache::get_hash(this->reverse[j].value) & mask;
+            if (((j - home) & mask) >= ((j - i) & mask))
+            {
+                this->reverse[i] = this->reverse[j];
+                i = j;
+            }
+        }
+        this->reverse[i].value = NULL;
+    }
+
+    template <class T>
+    unsigned int
+    Cache<T>::insert(const char *key, Hash hash)
+    {
+        // Keep at most 3/4 of the slots in use, rehashing away dropped ones
+        if ((this->used + 1) * 4 > this->capacity * 3)
+        {
+            unsigned int live = 0;
+            for (unsigned int i = 0; i < this->capacity; ++i)
+            {
+                live += (this->entry[i].state == LIVE || this->entry[i].state == LOADING);
+            }
+
+            unsigned int capacity = (this->capacity) ? this->capacity : 16;
+            while ((live + 1) * 2 > capacity)
+            {
+                capacity *= 2;
+            }
+            this->resize(capacity);
+        }
+        
+        unsigned int mask = this->capacity - 1, slot;
+        for (slot = hash & mask;
+            this->entry[slot].state == LIVE || this->entry[slot].state == LOADING;
+            slot = (slot + 1) & mask);
+        
+        Entry &e = this->entry[slot];
+        if (e.state == FREE)
+        {
+            this->used++;
+        }
+        
+        size_t length = strlen(key) + 1;
+        e.key        = new char[length];
+        memcpy(e.key, key, length);
+        e.hash       = hash;
+        e.value      = NULL;
+        e.state      = LIVE;
+        e.references = 0;
+        e.size       = 0;
+        e.last_use   = ++this->clock;
+        
+        this->stats.entries++;
+        
+        return slot;
+    }
+
+    template <class T>
+    void
+    Cache<T>::remove(unsigned int slot)
+    {
+        Entry &e = this->entry[slot];
+
+        if (e.state == LOADING)
+        {
+            // Waiters will find the key gone and reserve it themselves
+            SDL_CondBroadcast(this->loaded);
+        }
+
+        this->stats.bytes -= e.size;
+        this->stats.entries--;
+
+        this->unindex(e.value);
+        delete[] e.key;
+        e.key   = NULL;
+        e.value = NULL;
+        e.state = DROPPED;
+    }
+
+    template <class T>
+    void
+    Cache<T>::resize(unsigned int capacity)
+    {
+        Entry        *old_entry    = this->entry;
+        unsigned int  old_capacity = this->capacity;
+
+        delete[] this->reverse;
+        this->entry    = new Entry[capacity];
+        this->reverse  = new Reverse[capacity];
+        this->capacity = capacity;
+        this->used     = 0;
+        
+        for (unsigned int i = 0; i < capacity; ++i)
+        {
+            this->entry[i].state   = FREE;
+            this->reverse[i].value = NULL;
+        }
+        
+        // Dropped slots are left behind
+        for (unsigned int i = 0; i < old_capacity; ++i)
+        {
+            if (old_entry[i].state == LIVE || old_entry[i].state == LOADING)
+            {
+                unsigned int j;
+                for (j = old_entry[i].hash & (capacity - 1);
+                    this->entry[j].state != FREE; j = (j + 1) & (capacity - 1));
+                
+                this->entry[j] = old_entry[i];
+                this->index(this->entry[j].value, j);
+                this->used++;
+            }
+        }
+        
+        delete[] old_entry;
+    }
+
+    template <class T>
+    bool
+    Cache<T>::contains(const char *key, Hash hash)
+    {
+        SDL_LockMutex(this->lock);
+        bool found = (this->find(key, hash) != NOT_FOUND);
+        SDL_UnlockMutex(this->lock);
+        
+        return found;
+    }
+
+    template <class T>
+    bool
+    Cache<T>::contains(const T *data_point)
+    {
+        SDL_LockMutex(this->lock);
+        bool found = (this->find(data_point) != NOT_FOUND);
+        SDL_UnlockMutex(this->lock);
+        
+        return found;
     }
 
     template <class T>
     T *
-    Cache<T>::get(const char *key)
+    Cache<T>::get(const char *key, Hash hash)
     {
-        typename Cache::Storage::iterator i
-            = this->data.find(Cache::get_hash(key));
+        T *value = NULL;
         
-        return (i != this->data.end())
-            ? i->second
-            : NULL;
+        SDL_LockMutex(this->lock);
+        unsigned int slot = this->find(key, hash);
+        if (slot != NOT_FOUND)
+        {
+            this->entry[slot].last_use = ++this->clock;
+            value = this->entry[slot].value;
+        }
+        SDL_UnlockMutex(this->lock);
+        
+        return value;
     }
 
     template <class T>
     T *
-    Cache<T>::store(const char *key, T *data_point)
+    Cache<T>::reserve(const char *key, Hash hash, bool *loading, bool wait)
     {
-        typename Cache::Hash hash = Cache::get_hash(key);
+        T *value = NULL;
+        
+        *loading = false;
+        
+        SDL_LockMutex(this->lock);
+        unsigned int slot = this->find(key, hash);
+        while (wait && slot != NOT_FOUND && this->entry[slot].state == LOADING)
+        {
+            // Slots move when the table grows
+            SDL_CondWait(this->loaded, this->lock);
+            slot = this->find(key, hash);
+        }
+        
+        if (slot == NOT_FOUND)
+        {
+            slot = this->insert(key, hash);
+            this->entry[slot].state      = LOADING;
+            this->entry[slot].references = 1;
+            *loading = true;
+        }
+        else if (this->entry[slot].state == LIVE)
+        {
+            this->entry[slot].references++;
+            this->entry[slot].last_use = ++this->clock;
+            value = this->entry[slot].value;
+        }
+        SDL_UnlockMutex(this->lock);
+        
+        return value;
+    }
 
-        typename Cache::Storage::iterator i = this->data.find(hash);
-        if (i != this->data.end())
+    template <class T>
+    T *
+    Cache<T>::acquire(const char *key, Hash hash)
+    {
+        T *value = NULL;
+        
+        SDL_LockMutex(this->lock);
+        unsigned int slot = this->find(key, hash);
+        while (slot != NOT_FOUND && this->entry[slot].state == LOADING)
         {
-            delete data_point;
-            return i->second;
+            SDL_CondWait(this->loaded, this->lock);
+            slot = this->find(key, hash);
+        }
+        
+        if (slot != NOT_FOUND)
+        {
+            this->entry[slot].references++;
+            this->entry[slot].last_use = ++this->clock;
+            value = this->entry[slot].value;
+        }
+        SDL_UnlockMutex(this->lock);
+        
+        return value;
+    }
+
+    template <class T>
+    T *
+    Cache<T>::acquire(T *data_point)
+    {
+        SDL_LockMutex(this->lock);
+        unsigned int slot = this->find(data_point);
+        if (slot != NOT_FOUND)
+        {
+            this->entry[slot].references++;
+            this->entry[slot].last_use = ++this->clock;
         }
+        SDL_UnlockMutex(this->lock);
         
-        this->data.insert(std::make_pair(hash, data_point));
         return data_point;
     }
 
     template <class T>
     void
-    Cache<T>::flush(bool delete_targets)
+    Cache<T>::release(const T *data_point)
+    {
+        SDL_LockMutex(this->lock);
+        unsigned int slot = this->find(data_point);
+        if (slot != NOT_FOUND && this->entry[slot].references > 0)
+        {
+            this->entry[slot].references--;
+            this->entry[slot].last_use = ++this->clock;
+        }
+        SDL_UnlockMutex(this->lock);
+    }
+
+    template <class T>
+    void
+    Cache<T>::set_size(const T *data_point, size_t size)
     {
-        if (delete_targets)
+        SDL_LockMutex(this->lock);
+        unsigned int slot = this->find(data_point);
+        if (slot != NOT_FOUND)
         {
-            Cache::Storage backup = this->data;
-            this->data.clear();
+            this->stats.bytes += size - this->entry[slot].size;
+            this->entry[slot].size = size;
+        }
+        SDL_UnlockMutex(this->lock);
+    }
 
-            for (typename Cache::Storage::iterator i = backup.begin();
-                i != backup.end(); ++i)
+    template <class T>
+    unsigned int
+    Cache<T>::trim(size_t budget)
+    {
+        std::vector<T *> evicted;
+        std::vector<std::pair<unsigned long, unsigned int> > candidates;
+        
+        SDL_LockMutex(this->lock);
+        for (unsigned int i = 0; i < this->capacity && this->stats.bytes > budget; ++i)
+        {
+            const Entry &e = this->entry[i];
+            if (e.state == LIVE && e.references == 0 && e.size > 0)
             {
-                delete i->second;
+                candidates.push_back(std::make_pair(e.last_use, i));
             }
         }
+        std::sort(candidates.begin(), candidates.end());
+        
+        for (size_t i = 0; i < candidates.size() && this->stats.bytes > budget; ++i)
+        {
+            Entry &e = this->entry[candidates[i].second];
+            
+            this->stats.evictions++;
+            this->stats.evicted_bytes += e.size;
+            evicted.push_back(e.value);
+            this->remove(candidates[i].second);
+        }
+        SDL_UnlockMutex(this->lock);
+        
+        // Destructors may call back into the cache
+        for (size_t i = 0; i < evicted.size(); ++i)
+        {
+            delete evicted[i];
+        }
+        
+        return evicted.size();
+    }
+
+    template <class T>
+    T *
+    Cache<T>::store(const char *key, Hash hash, T *data_point, size_t size)
+    {
+        T *value = data_point;
+
+        SDL_LockMutex(this->lock);
+        unsigned int slot = this->find(key, hash);
+        if (slot == NOT_FOUND)
+        {
+            slot = this->insert(key, hash);
+            this->entry[slot].state = LOADING;
+        }
+        
+        Entry &e = this->entry[slot];
+        unsigned int other = (e.state == LIVE) ? NOT_FOUND : this->find(data_point);
+        if (e.state == LIVE)
+        {
+            value = e.value;
+        }
+        else if (other != NOT_FOUND)
+        {
+            // Cached under another key already; a second key would drop
+            // its reverse entry, and trim() could delete it twice
+            this->entry[other].references += e.references;
+            this->entry[other].last_use    = ++this->clock;
+            this->remove(slot);
+        }
         else
         {
-            this->data.clear();
+            e.value = data_point;
+            e.state = LIVE;
+            e.size  = size;
+            this->index(data_point, slot);
+            
+            this->stats.bytes += size;
+            SDL_CondBroadcast(this->loaded);
         }
+        SDL_UnlockMutex(this->lock);
+        
+        if (value != data_point)
+        {
+            delete data_point;
+        }
+        
+        return value;
     }
 
     template <class T>
     void
-    Cache<T>::drop(const char *key, bool delete_target)
+    Cache<T>::flush(bool delete_targets)
     {
-        typename Cache::Storage::iterator i
-            = this->data.find(Cache::get_hash(key));
+        // Detach first, as destroyed objects drop themselves from the cache
+        SDL_LockMutex(this->lock);
+        Entry        *old_entry    = this->entry;
+        unsigned int  old_capacity = this->capacity;
+        
+        delete[] this->reverse;
+        this->entry    = NULL;
+        this->reverse  = NULL;
+        this->capacity = 0;
+        this->used     = 0;
+        
+        this->stats.bytes   = 0;
+        this->stats.entries = 0;
+        
+        SDL_CondBroadcast(this->loaded);
+        SDL_UnlockMutex(this->lock);
         
-        if (i != this->data.end())
+        for (unsigned int i = 0; i < old_capacity; ++i)
         {
-            if (delete_target)
+            if (old_entry[i].state == LIVE || old_entry[i].state == LOADING)
             {
-                delete i->second;
+                delete[] old_entry[i].key;
+                if (delete_targets)
+                {
+                    delete old_entry[i].value;
+                }
             }
-            this->data.erase(i);
+        }
+        
+        delete[] old_entry;
+    }
+
+    template <class T>
+    void
+    Cache<T>::drop(const char *key, bool delete_target)
+    {
+        T *value = NULL;
+        
+        SDL_LockMutex(this->lock);
+        unsigned int slot = this->find(key, Cache::get_hash(key));
+        if (slot != NOT_FOUND)
+        {
+            value = this->entry[slot].value;
+            this->remove(slot);
+        }
+        SDL_UnlockMutex(this->lock);
+        
+        if (delete_target)
+        {
+            delete value;
         }
     }
 
@@ -199,18 +806,17 @@ namespace core
     void
     Cache<T>::drop(T *data_point, bool delete_target)
     {
-        for (typename Cache::Storage::iterator i = this->data.begin();
-            i != this->data.end(); ++i)
+        SDL_LockMutex(this->lock);
+        unsigned int slot = this->find(data_point);
+        if (slot != NOT_FOUND)
         {
-            if (i->second == data_point)
-            {
-                if (delete_target)
-                {
-                    delete i->second;
-                }
-                this->data.erase(i);
-                return;
-            }
+            this->remove(slot);
+        }
+        SDL_UnlockMutex(this->lock);
+        
+        if (slot != NOT_FOUND && delete_target)
+        {
+            delete data_point;
         }
     }
 }
@@ -6,8 +6,10 @@
 #include <cstring> // strcmp, strncmp, strlen
 #include <cstdlib> // rand()
 
-#include <map>
+#include <algorithm> // lower_bound, sort, unique
 #include <string>
+#include <vector>
+#include <SDL2/SDL.h>
 
 using namespace core;
 
@@ -41,47 +43,119 @@ Config::get_hash(const char *s)
     return hash;
 }
 
-class KeyStorage
-{
-    /* Global storage for key -> hash mapping
-      instead of storing duplicates for every Config instance with the same key.
-    */
-public:
-    std::map<Config::Hash, char *> data;
-    
-    const char *
-    get(Config::Hash hash)
+#define NODES_PER_BLOCK 256
+
+/*
+    Binary image, little-endian 32-bit words, read in place:
+
+        "CCFG" version, nodes (N), keys (K), string bytes (S)
+        N * { type, value, first, count }  node 0 is the root
+        N - 1 hashes                       children of a node are nodes
+                                           first + 1 ... first + count,
+                                           keyed by hashes first ... in order
+        K * { hash, string }               string keys
+        S bytes of NUL-terminated strings
+
+    Floats are stored as their bit patterns, strings as offsets.
+*/
+#define IMAGE_MAGIC   "CCFG"
+#define IMAGE_VERSION 1
+
+typedef
+    struct
     {
-        std::map<Config::Hash, char *>::iterator i = this->data.find(hash);
-        
-        return (i != this->data.end())
-            ? i->second
-            : NULL;
+        char   magic[4];
+        Uint32 version, nodes, keys, strings;
     }
-    
-    void
-    store(Config::Hash hash, const char *key)
+    _ImageHeader;
+
+typedef
+    struct
     {
-        if (this->data.find(hash) == this->data.end())
-        {
-            this->data.insert(std::make_pair(hash, str::dup(key)));
-        }
+        Uint32 type, value, first, count;
     }
-    
-    ~KeyStorage()
+    _ImageNode;
+
+struct Config::Image
+{
+    File             *file;
+    const _ImageNode *node;
+    const Uint32     *hash;
+    const char       *strings;
+    int               references;
+};
+
+// Released nodes, linked through their first bytes
+static struct
+{
+    void         *free;
+    SDL_SpinLock  lock;
+} _nodes;
+
+// Key strings live in the symbol table, hash -> key lookups go through it
+static inline const char *
+_get_key(Config::Hash hash)
+{
+    return symbol::name(symbol::find_hash(hash));
+}
+
+static inline void
+_store_key(const char *key)
+{
+    symbol::intern(key);
+}
+
+static bool
+_key_less(const std::pair<Config::Hash, Config *> &child, Config::Hash hash)
+{
+    return child.first < hash;
+}
+
+SDL_atomic_t Config::revision = { 0 };
+const Config Config::Handle::undefined;
+
+void *
+Config::operator new(size_t size)
+{
+    SDL_AtomicLock(&_nodes.lock);
+
+    if (_nodes.free == NULL)
     {
-        for (std::map<Config::Hash, char *>::iterator i = this->data.begin();
-        i != this->data.end(); ++i)
+        // Blocks are never returned, released nodes are reused instead
+        char *block = (char *)::operator new(NODES_PER_BLOCK * sizeof(Config));
+        for (int i = NODES_PER_BLOCK - 1; i >= 0; --i)
         {
-            delete[] i->second;
+            *(void **)&block[i * sizeof(Config)] = _nodes.free;
+            _nodes.free = &block[i * sizeof(Config)];
         }
     }
-    
-} stored_keys;
+
+    void *p = _nodes.free;
+    _nodes.free = *(void **)p;
+
+    SDL_AtomicUnlock(&_nodes.lock);
+
+    return p;
+}
+
+void
+Config::operator delete(void *p)
+{
+    if (p == NULL)
+    {
+        return;
+    }
+
+    SDL_AtomicLock(&_nodes.lock);
+    *(void **)p = _nodes.free;
+    _nodes.free = p;
+    SDL_AtomicUnlock(&_nodes.lock);
+}
 
 Config::Config()
 {
-    this->parent = NULL;
+    this->parent   = NULL;
+    this->children = NULL;
     
     this->type   = TYPE_UNDEFINED;
     this->value  = NULL;
@@ -90,7 +164,8 @@ Config::Config()
 
 Config::Config(const Config &config)
 {
-    this->parent = NULL;
+    this->parent   = NULL;
+    this->children = NULL;
     
     this->type   = TYPE_UNDEFINED;
     this->value  = NULL;
@@ -101,7 +176,8 @@ Config::Config(const Config &config)
 
 Config::Config(const char *filename)
 {
-    this->parent = NULL;
+    this->parent   = NULL;
+    this->children = NULL;
     
     this->type   = TYPE_UNDEFINED;
     this->value  = NULL;
@@ -113,6 +189,11 @@ Config::Config(const char *filename)
 Config &
 Config::operator=(const Config &v)
 {
+    if (&v == this)
+        return *this;
+
+    this->unshare();
+
     // clear old data
     if (this->type == TYPE_STRING && this->value == this->data)
     {
@@ -120,7 +201,6 @@ Config::operator=(const Config &v)
     }
     delete[] this->s;
     this->s = NULL;
-    this->children.clear();
 
     // copy data from v to this
     this->type = v.type;
@@ -143,12 +223,19 @@ Config::operator=(const Config &v)
         this->value = v.value;
     }
 
-    // copy children recursively
-    for (Config::Value::const_iterator i = v.children.begin();
-    i != v.children.end(); ++i)
+    // share children, released last as v may be one of the old ones
+    Children *children = v.children;
+    if (children != NULL)
     {
-        (*this)[i->first] = *i->second;
+        children->references++;
     }
+    if (this->children != NULL && this->children != children)
+    {
+        // Handles may point into the subtree being replaced
+        SDL_AtomicAdd(&Config::revision, 1);
+    }
+    this->release_children();
+    this->children = children;
 
     return *this;
 }
@@ -165,16 +252,17 @@ Config::pop(bool free_memory)
     if (this->parent != NULL)
     {
         // remove from parent's bookkeeping
-        for (Config::Value::iterator i = this->parent->children.begin();
-        i != this->parent->children.end(); ++i)
+        Config::Value &siblings = this->parent->write_children();
+        for (Config::Value::iterator i = siblings.begin(); i != siblings.end(); ++i)
         {
             if (i->second == this)
             {
-                this->parent->children.erase(i);
+                siblings.erase(i);
                 break;
             }
         }
         this->parent = NULL;
+        SDL_AtomicAdd(&Config::revision, 1);
     }
 
     if (free_memory)
@@ -186,16 +274,257 @@ Config::pop(bool free_memory)
     return this;
 }
 
+static Config::Value
+    _no_children;
+
 void
-Config::clear()
+Config::release_image(Image *image)
 {
-    for (Config::Value::iterator i = this->children.begin(); i != this->children.end(); ++i)
+    if (--image->references == 0)
     {
-        i->second->parent = NULL; // prevent destructor from meddling with the container while we iterate
-        delete i->second;
+        delete image->file; // unmaps
+        delete image;
+    }
+}
+
+void
+Config::expand()
+const
+{
+    Children         *children = this->children;
+    Image            *image    = children->image;
+    const _ImageNode &node     = image->node[children->image_node];
+    
+    Uint32
+        first = SDL_SwapLE32(node.first),
+        count = SDL_SwapLE32(node.count);
+    
+    // Stored in order, no need to search
+    children->image = NULL;
+    children->list.reserve(count);
+    for (Uint32 i = 0; i < count; ++i)
+    {
+        Config *c = new Config();
+        c->parent = const_cast<Config *>(this);
+        c->materialize(image, first + i + 1);
+        children->list.push_back(std::make_pair((Hash)SDL_SwapLE32(image->hash[first + i]), c));
+    }
+    
+    Config::release_image(image);
+}
+
+void
+Config::materialize(Image *image, unsigned int n)
+{
+    const _ImageNode &node = image->node[n];
+    
+    Uint32 value = SDL_SwapLE32(node.value);
+    switch (SDL_SwapLE32(node.type))
+    {
+        case TYPE_ARRAY:  this->type = TYPE_ARRAY; break;
+        case TYPE_BOOL:   *this = (value != 0); break;
+        case TYPE_CHAR:   *this = (char)value; break;
+        case TYPE_INT:    *this = (int)value; break;
+        case TYPE_UINT32: *this = (unsigned int)value; break;
+        case TYPE_STRING: *this = image->strings + value; break;
+        case TYPE_FLOAT:
+        {
+            float f;
+            memcpy(&f, &value, sizeof(float));
+            *this = f;
+            break;
+        }
     }
     
-    this->children.clear();
+    if (node.count != 0)
+    {
+        this->release_children();
+        this->children = new Children;
+        this->children->references = 1;
+        this->children->image      = image;
+        this->children->image_node = n;
+        image->references++;
+    }
+}
+
+const Config::Value &
+Config::read_children()
+const
+{
+    if (this->children == NULL)
+        return _no_children;
+    
+    if (this->children->image != NULL)
+        this->expand();
+    
+    return this->children->list;
+}
+
+Config::Value &
+Config::write_children()
+const
+{
+    this->unshare();
+    
+    if (this->children == NULL)
+    {
+        this->children = new Children;
+        this->children->references = 1;
+        this->children->image      = NULL;
+    }
+    else if (this->children->image != NULL)
+    {
+        this->expand();
+    }
+    
+    this->own_children();
+    
+    return this->children->list;
+}
+
+void
+Config::own_children()
+const
+{
+    Config *self = const_cast<Config *>(this);
+    
+    if (this->children->references > 1)
+    {
+        // Duplicate this level, grandchildren stay shared
+        Children *copy = new Children;
+        copy->references = 1;
+        copy->image      = NULL;
+        copy->list.reserve(this->children->list.size());
+        for (Config::Value::const_iterator i = this->children->list.begin();
+        i != this->children->list.end(); ++i)
+        {
+            Config *c = new Config(*i->second);
+            c->parent = self;
+            copy->list.push_back(std::make_pair(i->first, c));
+        }
+        
+        this->children->references--;
+        if (!copy->list.empty() && this->children->list.front().second->parent == this)
+        {
+            // The originals are ours, hand the duplicates to the other copies
+            copy->list.swap(this->children->list);
+            for (Config::Value::iterator i = this->children->list.begin();
+            i != this->children->list.end(); ++i)
+            {
+                i->second->parent = NULL;
+            }
+        }
+        this->children = copy;
+        
+        // One of the copies now holds new nodes, handles into it are stale
+        SDL_AtomicAdd(&Config::revision, 1);
+    }
+    else if (!this->children->list.empty() && this->children->list.front().second->parent != this)
+    {
+        // The last copy holding these, adopt them
+        for (Config::Value::iterator i = this->children->list.begin();
+        i != this->children->list.end(); ++i)
+        {
+            i->second->parent = self;
+        }
+        SDL_AtomicAdd(&Config::revision, 1);
+    }
+}
+
+void
+Config::unshare()
+const
+{
+    // References into a shared level bypass write_children(), so before
+    // anything is written to this, every shared level above it hands the
+    // other copies their own nodes, top down. The parent pointers lead to
+    // the copy this was handed out by, which keeps the originals.
+    if (this->parent != NULL)
+    {
+        this->parent->unshare();
+        if (this->parent->children->references > 1)
+        {
+            this->parent->own_children();
+        }
+    }
+}
+
+void
+Config::release_children()
+{
+    if (this->children == NULL)
+        return;
+    
+    this->unshare();
+    
+    Config::Value &list = this->children->list;
+    if (--this->children->references == 0)
+    {
+        if (!list.empty() || this->children->image != NULL)
+        {
+            SDL_AtomicAdd(&Config::revision, 1);
+        }
+        for (Config::Value::iterator i = list.begin(); i != list.end(); ++i)
+        {
+            i->second->parent = NULL; // prevent destructor from meddling with the container while we iterate
+            delete i->second;
+        }
+        if (this->children->image != NULL)
+        {
+            Config::release_image(this->children->image);
+        }
+        delete this->children;
+    }
+    else if (!list.empty() && list.front().second->parent == this)
+    {
+        // Still used by other copies, which must not refer back to this
+        for (Config::Value::iterator i = list.begin(); i != list.end(); ++i)
+        {
+            i->second->parent = NULL;
+        }
+    }
+    
+    this->children = NULL;
+}
+
+Config::Value::iterator
+Config::begin()
+{
+    return (this->children != NULL)
+        ? this->write_children().begin()
+        : _no_children.begin();
+}
+
+Config::Value::iterator
+Config::end()
+{
+    return (this->children != NULL)
+        ? this->write_children().end()
+        : _no_children.end();
+}
+
+Config::Value::const_iterator
+Config::begin()
+const
+{
+    return (this->children != NULL)
+        ? this->read_children().begin()
+        : _no_children.begin();
+}
+
+Config::Value::const_iterator
+Config::end()
+const
+{
+    return (this->children != NULL)
+        ? this->read_children().end()
+        : _no_children.end();
+}
+
+void
+Config::clear()
+{
+    this->release_children();
     
     this->_bind(NULL, TYPE_UNDEFINED);
     
@@ -206,6 +535,8 @@ Config::clear()
 void
 Config::_bind(void *p, int type)
 {
+    this->unshare();
+    
     if (this->type == TYPE_STRING && this->value == this->data)
     {
         delete[] *(char **)this->value;
@@ -273,6 +604,8 @@ Config::bind(Config &nested_config)
     
     if (&nested_config == this)
         return;
+
+    SDL_AtomicAdd(&Config::revision, 1);
     
     /* Prevent from binding an ancestor to its children */
     for (c = this->parent; c != NULL; c = c->parent)
@@ -284,12 +617,12 @@ Config::bind(Config &nested_config)
     if (nested_config.parent != NULL)
     {
         /* Free nested_config from its parent if already bound */
-        c = nested_config.parent;
-        for (i = c->children.begin(); i != c->children.end(); ++i)
+        Config::Value &siblings = nested_config.parent->write_children();
+        for (i = siblings.begin(); i != siblings.end(); ++i)
         {
             if (i->second == &nested_config)
             {
-                c->children.erase(i);
+                siblings.erase(i);
                 break;
             }
         }
@@ -299,11 +632,12 @@ Config::bind(Config &nested_config)
         {
             if (c->parent == this)
             {
-                for (i = this->children.begin(); i != this->children.end(); ++i)
+                Config::Value &children = this->write_children();
+                for (i = children.begin(); i != children.end(); ++i)
                 {
                     if (i->second == c)
                     {
-                        this->children.erase(i);
+                        children.erase(i);
                         
                         c->parent = NULL;
                         delete c;
@@ -319,7 +653,8 @@ Config::bind(Config &nested_config)
     
     /* Find this in parent's children and replace the reference with nested_config */
     c = this->parent;
-    for (i = c->children.begin(); i != c->children.end(); ++i)
+    Config::Value &siblings = c->write_children();
+    for (i = siblings.begin(); i != siblings.end(); ++i)
     {
         if (i->second == this)
         {
@@ -491,6 +826,8 @@ const
 Config &
 Config::operator=(bool v)
 {
+    this->unshare();
+    
     if (this->value == NULL)
     {
         this->value = this->data;
@@ -525,6 +862,8 @@ Config::operator=(bool v)
 Config &
 Config::operator=(char v)
 {
+    this->unshare();
+    
     if (this->value == NULL)
     {
         this->value = this->data;
@@ -551,6 +890,8 @@ Config::operator=(char v)
 Config &
 Config::operator=(int v)
 {
+    this->unshare();
+    
     if (this->value == NULL)
     {
         this->value = this->data;
@@ -577,6 +918,8 @@ Config::operator=(int v)
 Config &
 Config::operator=(float v)
 {
+    this->unshare();
+    
     if (this->value == NULL)
     {
         this->value = this->data;
@@ -603,6 +946,8 @@ Config::operator=(float v)
 Config &
 Config::operator=(unsigned int v)
 {
+    this->unshare();
+    
     if (this->value == NULL)
     {
         this->value = this->data;
@@ -629,6 +974,8 @@ Config::operator=(unsigned int v)
 Config &
 Config::operator=(const char *v)
 {
+    this->unshare();
+    
     if (this->value == NULL)
     {
         this->value = this->data;
@@ -700,6 +1047,8 @@ Config::set(const char *v)
     const char *s;
     char c;
 
+    this->unshare();
+
     if (this->value == NULL)
     {
         this->value = this->data;
@@ -822,12 +1171,15 @@ const
         return false;
     
     Config::Value::const_iterator i0, i1;
-    i0 = this->children.begin();
-    i1 = c.children.begin();
+    const Config::Value
+        &c0 = this->read_children(),
+        &c1 = c.read_children();
+    i0 = c0.begin();
+    i1 = c1.begin();
     
     for (;;)
     {
-        if (i0 == this->children.end() || i1 == c.children.end())
+        if (i0 == c0.end() || i1 == c1.end())
             break;
         
         if (i0->first != i1->first || *i0->second != *i1->second)
@@ -837,7 +1189,7 @@ const
         i1++;
     }
     
-    return (i0 == this->children.end() && i1 == c.children.end());
+    return (i0 == c0.end() && i1 == c1.end());
 }
 
 bool Config::operator!=(const Config &c)
@@ -850,12 +1202,13 @@ Config::key(void)
 {
     if (this->parent != NULL)
     {
-        for (Config::Value::iterator i = this->parent->children.begin();
-        i != this->parent->children.end(); ++i)
+        const Config::Value &siblings = this->parent->read_children();
+        for (Config::Value::const_iterator i = siblings.begin();
+        i != siblings.end(); ++i)
         {
             if (i->second == this)
             {
-                return stored_keys.get(i->first);
+                return _get_key(i->first);
             }
         }
     }
@@ -868,8 +1221,9 @@ Config::numeric_key(void)
 {
     if (this->parent != NULL)
     {
-        for (Config::Value::iterator i = this->parent->children.begin();
-        i != this->parent->children.end(); ++i)
+        const Config::Value &siblings = this->parent->read_children();
+        for (Config::Value::const_iterator i = siblings.begin();
+        i != siblings.end(); ++i)
         {
             if (i->second == this)
             {
@@ -903,42 +1257,95 @@ Config::find(const char *path)
     }
 }
 
-Config &
-Config::operator[](const char *key)
+const Config *
+Config::lookup(const char *path)
+const
 {
-    Config::Hash hash = Config::get_hash(key);
-    Config::Value::iterator i = this->children.find(hash);
+    const char *s;
+    const Config *c = this;
+    
+    for (s = path;; ++s)
+    {
+        if (*s == '/' || *s == '\0')
+        {
+            char *key = str::unescape(str::substring(path, s - 1));
+            Hash hash = Config::get_hash(key);
+            delete[] key;
+            
+            const Config::Value &children = c->read_children();
+            Config::Value::const_iterator i = std::lower_bound(children.begin(), children.end(), hash, _key_less);
+            if (i == children.end() || i->first != hash)
+                return NULL;
+            
+            c = i->second;
+            if (*s == '\0')
+                return c;
+            
+            path = s + 1;
+        }
+    }
+}
+
+Config::Value::iterator
+Config::locate(Hash hash)
+{
+    // Most trees are built in key order, check the tail first
+    Config::Value &children = this->write_children();
+    if (children.empty() || children.back().first < hash)
+        return children.end();
     
-    if (i == this->children.end())
+    return std::lower_bound(children.begin(), children.end(), hash, _key_less);
+}
+
+Config &
+Config::child(Config::Value::iterator i, Hash hash)
+{
+    Config::Value &children = this->write_children();
+    if (i == children.end() || i->first != hash)
     {
-        i = this->children.insert(std::make_pair(hash, new Config())).first;
+        i = children.insert(i, std::make_pair(hash, new Config()));
         i->second->parent = this;
-        stored_keys.store(hash, key);
     }
     
     return *i->second;
 }
 
 Config &
-Config::operator[](int numeric_key)
+Config::operator[](const char *key)
 {
-    Config::Hash hash = numeric_key;
-    Config::Value::iterator i = this->children.find(hash);
+    Config::Hash hash = Config::get_hash(key);
+    Config::Value::iterator i = this->locate(hash);
     
-    if (i == this->children.end())
+    if (i == this->children->list.end() || i->first != hash)
     {
-        i = this->children.insert(std::make_pair(hash, new Config())).first;
-        i->second->parent = this;
+        _store_key(key);
     }
     
-    return *i->second;
+    return this->child(i, hash);
+}
+
+Config &
+Config::at(symbol::Id key)
+{
+    Config::Hash hash = symbol::hash(key);
+    
+    return this->child(this->locate(hash), hash);
+}
+
+Config &
+Config::operator[](int numeric_key)
+{
+    Config::Hash hash = numeric_key;
+    
+    return this->child(this->locate(hash), hash);
 }
 
 Config &
 Config::operator[](Accessor token)
 {
     Config *result;
-    if (this->children.size())
+    Config::Value &children = this->write_children();
+    if (children.size())
     {
         Config::Value::iterator i;
         Config::Hash hash;
@@ -948,38 +1355,37 @@ Config::operator[](Accessor token)
         {
             // get existing elements
             case Config::FIRST:
-                result = this->children.begin()->second;
+                result = children.begin()->second;
 
                 break;
             
 
             case Config::LAST:
-                result = this->children.rbegin()->second;
+                result = children.rbegin()->second;
 
                 break;
 
 
             case Config::RANDOM:
             case Config::MIDDLE:
-                n = this->children.size();
+                n = children.size();
             
                 if (token == Config::RANDOM)
                     n = rand() % n;
                 else
                     n /= 2;
                 
-                for (i = this->children.begin(); --n >= 0; ++i);
-                result = i->second;
+                result = children[n].second;
             
                 break;
             
 
            case Config::WEIGHTED:
-                i = this->children.begin();
-                hash = this->children.rbegin()->first;
+                i = children.begin();
+                hash = children.rbegin()->first;
                 if (hash)
                 {
-                    for (hash = rand() % hash; i->first < hash; ++i);
+                    i = this->locate(rand() % hash);
                 }
                 result = i->second;
 
@@ -988,21 +1394,21 @@ Config::operator[](Accessor token)
 
             // create new elements
             case Config::PREPEND:
-                result = &(*this)[this->children.begin()->first - 1];
+                result = &(*this)[children.begin()->first - 1];
 
                 break;
             
 
             case Config::APPEND:
-                result = &(*this)[this->children.rbegin()->first + 1];
+                result = &(*this)[children.rbegin()->first + 1];
 
                 break;
 
             
             case Config::NEXT:
-                i = this->children.find(n = 0);
-                for (i = this->children.begin();
-                    i != this->children.end() && (int)i->first <= n;
+                n = 0;
+                for (i = children.begin();
+                    i != children.end() && (int)i->first <= n;
                     ++i, ++n
                 );
                     
@@ -1056,22 +1462,23 @@ bool
 Config::is_empty()
 const
 {
-    return (this->children.size() == 0);
+    return (this->read_children().size() == 0);
 }
 
 int
 Config::count()
 const
 {
-    return ((int)this->children.size());
+    return ((int)this->read_children().size());
 }
 
 Config *
 Config::search(int match)
 const
 {
-    for (Config::Value::const_iterator i = this->children.begin();
-        i != this->children.end(); ++i)
+    const Config::Value &children = this->read_children();
+    for (Config::Value::const_iterator i = children.begin();
+        i != children.end(); ++i)
     {
         if (i->second->integer() == match)
         {
@@ -1088,8 +1495,9 @@ const
 {
     match    -= threshold;
     threshold = match + threshold * 2.0f;
-    for (Config::Value::const_iterator i = this->children.begin();
-        i != this->children.end(); ++i)
+    const Config::Value &children = this->read_children();
+    for (Config::Value::const_iterator i = children.begin();
+        i != children.end(); ++i)
     {
         float f = i->second->real();
         if (f >= match && f <= threshold)
@@ -1104,8 +1512,9 @@ const
 Config *
 Config::search(const char *match)
 {
-    for (Config::Value::iterator i = this->children.begin();
-        i != this->children.end(); ++i)
+    Config::Value &children = this->write_children();
+    for (Config::Value::iterator i = children.begin();
+        i != children.end(); ++i)
     {
         if (strcmp(i->second->string(), match) == 0)
         {
@@ -1116,6 +1525,28 @@ Config::search(const char *match)
     return NULL;
 }
 
+Config *
+Config::merge(const Config *config)
+{
+    // Values and children of config override those of this, others are kept
+    const Config::Value &children = config->read_children();
+    if (children.empty())
+    {
+        if (config->exists())
+            *this = *config;
+        
+        return this;
+    }
+    
+    for (Config::Value::const_iterator i = children.begin();
+    i != children.end(); ++i)
+    {
+        this->child(this->locate(i->first), i->first).merge(i->second);
+    }
+    
+    return this;
+}
+
 void
 Config::load(const char *filename)
 {
@@ -1125,9 +1556,24 @@ Config::load(const char *filename)
        strcmp(file.ext,  "txt")
     && strcmp(file.ext,  "cfg")
     && strncmp(file.ext, "conf", 4)))
-        this->read_binary(&file);
+    {
+        if (!this->read_image(filename))
+            this->read_binary(&file);
+    }
     else
-        this->parse_file_contents(file.get_contents());
+    {
+        // Parse straight from the mapping, no copy of the whole file
+        size_t size;
+        const char *s = (const char *)file.map(&size);
+
+        if (s != NULL)
+            this->parse_file_contents(s, size);
+        else
+            this->parse_file_contents("", 0);
+    }
+
+    // Reloaded, look settings up again
+    SDL_AtomicAdd(&Config::revision, 1);
 }
 
 void
@@ -1139,38 +1585,197 @@ Config::save(const char *filename)
        strcmp(file.ext,  "txt")
     && strcmp(file.ext,  "cfg")
     && strncmp(file.ext, "conf", 4)))
-        this->write_binary(&file);
+        this->write_image(&file);
     else
         this->print(file.get_FILE());
 }
 
-void
-Config::write_binary(void *stream)
+bool
+Config::read_image(const char *filename)
 {
-    core::File *file = (core::File *)stream;
+    File *file = new File(filename);
+    
+    size_t      size;
+    const char *base = (const char *)file->map(&size);
     
-    file->write_uint16(this->children.size());
-    if (this->children.size())
+    if (base == NULL || size < sizeof(_ImageHeader)
+        || strncmp(base, IMAGE_MAGIC, 4) != 0)
     {
-        for (Config::Value::iterator i = this->children.begin(); i != this->children.end(); ++i)
+        delete file;
+        return false;
+    }
+    
+    const _ImageHeader *header = (const _ImageHeader *)base;
+    Uint32
+        nodes   = SDL_SwapLE32(header->nodes),
+        keys    = SDL_SwapLE32(header->keys),
+        strings = SDL_SwapLE32(header->strings);
+    
+    Image *image   = new Image;
+    image->file    = file;
+    image->node    = (const _ImageNode *)(base + sizeof(_ImageHeader));
+    image->hash    = (const Uint32 *)(image->node + nodes);
+    image->strings = (const char *)(image->hash + (nodes - 1) + 2 * keys);
+    image->references = 1;
+    
+    // Check everything once, so that unpacking later on can't fail
+    bool valid = (SDL_SwapLE32(header->version) == IMAGE_VERSION
+        && nodes >= 1 && strings >= 1
+        && nodes   <= size / sizeof(_ImageNode)
+        && keys    <= size / (2 * sizeof(Uint32))
+        && (size_t)(image->strings - base) + strings == size
+        && image->strings[strings - 1] == '\0');
+    
+    for (Uint32 n = 0; valid && n < nodes; ++n)
+    {
+        const _ImageNode &node = image->node[n];
+        Uint32
+            first = SDL_SwapLE32(node.first),
+            count = SDL_SwapLE32(node.count);
+        
+        // Children follow their parent, so there can be no cycles
+        valid = (SDL_SwapLE32(node.type) <= TYPE_STRING
+            && (SDL_SwapLE32(node.type) != TYPE_STRING || SDL_SwapLE32(node.value) < strings)
+            && (count == 0 || (first >= n && count <= nodes - 1 && first <= nodes - 1 - count)));
+        
+        for (Uint32 i = 1; valid && i < count; ++i)
         {
-            file->write_uint32(i->first);
-            i->second->write_binary(stream);
+            valid = (SDL_SwapLE32(image->hash[first + i - 1]) < SDL_SwapLE32(image->hash[first + i]));
         }
     }
+    
+    const Uint32 *key = image->hash + (nodes - 1);
+    for (Uint32 k = 0; valid && k < keys; ++k)
+    {
+        valid = (SDL_SwapLE32(key[2 * k + 1]) < strings);
+    }
+    
+    if (!valid)
+    {
+        Config::release_image(image);
+        throw 666;
+    }
+    
+    for (Uint32 k = 0; k < keys; ++k)
+    {
+        _store_key(image->strings + SDL_SwapLE32(key[2 * k + 1]));
+    }
+    
+    if (this->read_children().empty())
+    {
+        this->materialize(image, 0);
+    }
     else
     {
-        file->write_uint8(this->type);
-        switch (this->type)
+        Config loaded;
+        loaded.materialize(image, 0);
+        this->merge(&loaded);
+    }
+    Config::release_image(image);
+    
+    return true;
+}
+
+void
+Config::write_image(void *stream)
+{
+    core::File *file = (core::File *)stream;
+    
+    std::vector<const Config *> queue;
+    std::vector<_ImageNode>     nodes;
+    std::vector<Uint32>         hashes, keys;
+    std::string                 strings;
+    
+    // Breadth first, so that the children of each node are consecutive
+    queue.push_back(this);
+    for (size_t n = 0; n < queue.size(); ++n)
+    {
+        const Config        *c        = queue[n];
+        const Config::Value &children = c->read_children();
+        
+        _ImageNode node;
+        node.type  = c->type;
+        node.value = 0;
+        node.first = hashes.size();
+        node.count = children.size();
+        
+        switch (c->type)
+        {
+            case TYPE_BOOL:   node.value = *(bool *)c->value; break;
+            case TYPE_CHAR:   node.value = *(char *)c->value; break;
+            case TYPE_INT:    node.value = *(int *)c->value; break;
+            case TYPE_UINT32: node.value = *(unsigned int *)c->value; break;
+            case TYPE_FLOAT:  memcpy(&node.value, c->value, sizeof(float)); break;
+            case TYPE_STRING:
+                if (*(const char **)c->value != NULL)
+                {
+                    node.value = strings.size();
+                    strings.append(*(const char **)c->value);
+                    strings.push_back('\0');
+                }
+                else
+                {
+                    node.type = TYPE_UNDEFINED;
+                }
+                break;
+        }
+        
+        for (Config::Value::const_iterator i = children.begin(); i != children.end(); ++i)
         {
-            case TYPE_BOOL:   file->write_uint8(*(bool *)this->value); break;
-            case TYPE_CHAR:   file->write_uint8((*(char *)this->value)); break;
-            case TYPE_INT:    file->write_int((*(int *)this->value)); break;
-            case TYPE_FLOAT:  file->write_float((*(float *)this->value)); break;
-            case TYPE_UINT32: file->write_uint32((*(unsigned int *)this->value)); break;
-            case TYPE_STRING: file->write_string(*(char **)this->value); break;
+            hashes.push_back(i->first);
+            queue.push_back(i->second);
+            
+            const char *key = _get_key(i->first);
+            if (key != NULL)
+            {
+                keys.push_back(i->first);
+            }
         }
+        
+        node.type  = SDL_SwapLE32(node.type);
+        node.value = SDL_SwapLE32(node.value);
+        node.first = SDL_SwapLE32(node.first);
+        node.count = SDL_SwapLE32(node.count);
+        nodes.push_back(node);
+    }
+    
+    // Each key once
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    
+    std::vector<Uint32> key_table;
+    for (size_t k = 0; k < keys.size(); ++k)
+    {
+        key_table.push_back(SDL_SwapLE32(keys[k]));
+        key_table.push_back(SDL_SwapLE32(strings.size()));
+        strings.append(_get_key(keys[k]));
+        strings.push_back('\0');
+    }
+    if (strings.empty())
+    {
+        strings.push_back('\0');
+    }
+    
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        hashes[i] = SDL_SwapLE32(hashes[i]);
     }
+    
+    _ImageHeader header;
+    memcpy(header.magic, IMAGE_MAGIC, 4);
+    header.version = SDL_SwapLE32(IMAGE_VERSION);
+    header.nodes   = SDL_SwapLE32(nodes.size());
+    header.keys    = SDL_SwapLE32(keys.size());
+    header.strings = SDL_SwapLE32(strings.size());
+    
+    file->empty();
+    file->write(&header, sizeof(header), 1);
+    file->write(&nodes[0], sizeof(_ImageNode), nodes.size());
+    if (!hashes.empty())
+        file->write(&hashes[0], sizeof(Uint32), hashes.size());
+    if (!key_table.empty())
+        file->write(&key_table[0], sizeof(Uint32), key_table.size());
+    file->write(strings.data(), 1, strings.size());
 }
 
 void
@@ -1220,16 +1825,18 @@ Config::print(void *stream, int indent)
         ? (FILE *)stream
         : stdout;
     
-    if (this->children.size())
+    const Config::Value &children = this->read_children();
+    
+    if (children.size())
     {
         // TODO: sort alphabetically by key
-        for (Config::Value::const_iterator i = this->children.begin();
-        i != this->children.end(); ++i)
+        for (Config::Value::const_iterator i = children.begin();
+        i != children.end(); ++i)
         {
             const char *separator;
-            if (i->second->children.size())
+            if (i->second->read_children().size())
             {
-                if (i != this->children.begin())
+                if (i != children.begin())
                     fprintf(file, LINE_BREAK);
                 
                 separator = ":" LINE_BREAK;
@@ -1243,7 +1850,7 @@ Config::print(void *stream, int indent)
             fwrite(indent_str, 1, n, file);
             
             // string key
-            const char *key = stored_keys.get(i->first);
+            const char *key = _get_key(i->first);
             if (key != NULL)
                 fprintf(file, "%s", key);
             
@@ -1271,6 +1878,12 @@ Config::print(void *stream, int indent)
 
 bool
 Config::parse_file_contents(const char *s)
+{
+    return this->parse_file_contents(s, strlen(s));
+}
+
+bool
+Config::parse_file_contents(const char *s, size_t length)
 {
 #define MAX_NESTING_DEPTH 64
     struct
@@ -1279,7 +1892,7 @@ Config::parse_file_contents(const char *s)
         Config *ptr;
     } nest_table[MAX_NESTING_DEPTH], *nesting;
 
-    const char *pos, *start_pos, *end_pos;
+    const char *pos, *start_pos, *end_pos, *end = s + length;
     char *key = NULL;
     char c;
     
@@ -1295,9 +1908,10 @@ Config::parse_file_contents(const char *s)
     nesting->indent = 0;
     nesting->ptr = this;
  
+    /* The buffer needs no terminator, reading past its end yields '\0' */
     for (pos = s;; ++pos)
     {
-        c = *pos;
+        c = (pos < end) ? *pos : '\0';
         
         /* Skip over quoted strings */
         if (c == '"')
@@ -1305,17 +1919,17 @@ Config::parse_file_contents(const char *s)
             start_pos = pos;
             for (pos++;; ++pos)
             {
-                c = *pos;
+                c = (pos < end) ? *pos : '\0';
                 
                 if (c == '\\')
-                    c = *(++pos);
+                    c = (++pos < end) ? *pos : '\0';
                 else if (c == '"')
                     break;
                 
                 if (c == '\n' || c == '\0')
                     break;
             }
-            end_pos = pos;
+            end_pos = (pos < end) ? pos : end - 1;
             
             if (c == '"')
                 continue;
@@ -1351,18 +1965,18 @@ Config::parse_file_contents(const char *s)
                     else
                     {
                         sscanf(key + 2, "%d", &numeric_key);
-                        switch (key[1] * (nesting->ptr->children.size() > 0))
+                        switch (key[1] * (nesting->ptr->count() > 0))
                         {
                             /* (+n): add n to highest key */
                             case '+':
                                 numeric_key
-                                    += nesting->ptr->children.rbegin()->first;
+                                    += nesting->ptr->write_children().rbegin()->first;
                                 break;
 
                             /* (-n): subtract n from smallest key */
                             case '-':
                                 numeric_key
-                                    -= nesting->ptr->children.begin()->first;
+                                    -= nesting->ptr->write_children().begin()->first;
                                 break;
                         }
                     }
@@ -1,9 +1,15 @@
 #ifndef _CORE_UTIL_CONFIG_H
 #define _CORE_UTIL_CONFIG_H
 
-#include <map>
+#include <vector>
+#include <utility>
 #include <iterator>
 #include <cstring>
+#include <cstddef>
+
+#include <SDL2/SDL.h>
+
+#include "symbol.h"
 
 namespace core
 {
@@ -30,18 +36,95 @@ namespace core
                 Hash; // 32-bit
                 
             typedef
-                std::map<Hash, Config *>
-                Value;
+                std::vector<std::pair<Hash, Config *> >
+                Value; // Sorted by hash, binary searched
+
+            class Handle
+            {
+                /*
+                    Pre-resolved path for settings read every frame.
+                    Resolves lazily (root may still be unconstructed when the
+                    handle is), and again after nodes have been detached,
+                    replaced, freed or unshared anywhere. Reading never
+                    creates the setting, a missing one is looked up again
+                    on every read. Path must outlive the handle.
+
+                    static core::Config::Handle
+                        _view_range(core::engine.config, "video/detail/view_range");
+                    ...
+                    float range = _view_range.real(6000.0f);
+                */
+                public:
+                    Handle(Config &root, const char *path):
+                        root(&root), node(NULL), path(path), revision(0) {}
+
+                    // Unshares the setting for writing, creating it if it's missing
+                    inline Config &operator*()  { return this->get(); }
+                    inline Config *operator->() { return &this->get(); }
+
+                    inline bool         boolean(bool         def = false) { return this->read().boolean(def); }
+                    inline int          integer(int          def = 0)     { return this->read().integer(def); }
+                    inline float        real   (float        def = 0.0f)  { return this->read().real(def); }
+                    inline unsigned int uint32 (unsigned int def = 0)     { return this->read().uint32(def); }
+                    inline float        percentage(int       def = 0)     { return this->read().percentage(def); }
+
+                protected:
+                    Config       *root;
+                    const Config *node;
+                    const char   *path;
+                    int           revision;
+
+                    static const Config undefined; // Stands in for missing settings
+
+                    inline const Config *
+                    resolve(void)
+                    {
+                        int revision = SDL_AtomicGet(&Config::revision);
+                        if (this->node == NULL || this->revision != revision)
+                        {
+                            this->node     = this->root->lookup(this->path);
+                            this->revision = revision;
+                        }
+                        return this->node;
+                    }
+
+                    inline const Config &
+                    read(void)
+                    {
+                        const Config *c = this->resolve();
+                        return (c != NULL) ? *c : Config::Handle::undefined;
+                    }
+
+                    inline Config &
+                    get(void)
+                    {
+                        // The resolved node may be shared with copies of root
+                        return this->root->find(this->path);
+                    }
+
+                private:
+                    Handle(const Handle &);
+                    Handle &operator=(const Handle &);
+            };
+            friend class Handle;
             
             Config();
             Config(const char *filename);
             Config(const Config &config);
             ~Config();
+
+            // Nodes are carved out of shared blocks instead of one heap allocation each
+            static void *operator new(size_t size);
+            static void  operator delete(void *p);
             
             static Hash
             get_hash(const char *s);
 
-            /* Save and load */
+            /*
+                Save and load. Files with a txt, cfg or conf* extension are
+                text, others binary. Binary files are memory-mapped, and each
+                level of the tree is only unpacked when first accessed.
+            */
             void load(const char *filename);
             void save(const char *filename);
             
@@ -64,6 +147,8 @@ namespace core
             Config &operator[](int numeric_key);
             Config &operator[](Accessor token);
             Config &find(const char *path); // Returns a child object, keys in path separated by '/'
+            const Config *lookup(const char *path) const; // Same, but NULL if missing instead of creating it
+            Config &at(symbol::Id key);     // Same as [symbol::name(key)], without hashing the key again
             
             const char *key(void);  // returns string key or NULL if has no parents
             int numeric_key(void);  // returns numeric key or NULL if has no parents
@@ -122,28 +207,65 @@ namespace core
             void clear();
             inline void empty() { this->clear(); }
             
-            Config::Value::iterator begin() { return this->children.begin(); }
-            Config::Value::iterator end()   { return this->children.end();   }
-            Config::Value::const_iterator begin() const { return this->children.begin(); };
-            Config::Value::const_iterator end()   const { return this->children.end();   };
+            Config::Value::iterator begin();
+            Config::Value::iterator end();
+            Config::Value::const_iterator begin() const;
+            Config::Value::const_iterator end()   const;
             
             
             
         protected:
+            static SDL_atomic_t revision; // Bumped whenever nodes are detached, replaced, freed or change copies, invalidates handles
+
             void *value; // pointer to bound variable
             int   type;  // type of bound variable
             
             char  *s;   // container for return value of string() method
             unsigned char data[sizeof(void *)]; // data storage for unbound values
             
+            /*
+                Copies share their children until either side accesses them
+                for writing, at which point that level (only) is duplicated.
+                The copy the nodes' parent pointers lead to keeps the
+                original nodes, so references into it stay valid. Writing
+                through such a reference first hands the other copies
+                duplicates of every shared level above it.
+                Copies sharing children must stay on the same thread.
+            */
+            struct Image; // Mapped binary file
+
+            typedef
+                struct
+                {
+                    Config::Value list;
+                    int           references;
+
+                    Image        *image;      // Unpacked into list when first accessed
+                    unsigned int  image_node;
+                }
+                Children;
+
             Config *parent;
-            Config::Value children;
+            mutable Children *children; // NULL if none
+
+            const Config::Value &read_children() const; // Possibly shared, don't modify
+            Config::Value &write_children() const;      // Unshared, created if missing
+            void own_children() const; // Unshares this level, keeping the nodes if they are ours
+            void unshare() const;      // Unshares every level above this, before writing to it
+            void release_children();
+            void expand() const;
+            void materialize(Image *image, unsigned int node);
+            static void release_image(Image *image);
             
             void _bind(void *p, int type);
+            Config::Value::iterator locate(Hash hash);       // First child with a key >= hash
+            Config &child(Config::Value::iterator i, Hash hash); // Child at i, created if it's not there
             bool parse_file_contents(const char *s);
+            bool parse_file_contents(const char *s, size_t length); // s needs no terminator
             
-            void read_binary(void *stream);
-            void write_binary(void *stream);
+            bool read_image(const char *filename);
+            void write_image(void *stream);
+            void read_binary(void *stream); // Pre-image format, read only
     };
 }
 
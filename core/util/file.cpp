@@ -1,10 +1,19 @@
 #include "file.h"
+#include "pack.h"
 #include "string.h"
 // #include "../engine.h"
 
 #include <cstdio>
 #include <cstring>
 #include <vector>
+#include <algorithm> // min
+
+#ifndef _WIN32
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
 
 using namespace core;
 
@@ -284,6 +293,15 @@ File::File(const char *filename):
     this->mode     = MODE_UNOPENED;
     this->data     = NULL;
     this->contents = NULL;
+    this->mapping  = NULL;
+    
+    this->mapping_packed = false;
+    
+    this->stream_buffer = NULL;
+    this->stream        = NULL;
+    this->stream_pos    = this->stream_end = 0;
+    this->at_eof        = false;
+    this->packed        = false;
     
     this->mutable_line_number = 0;
 }
@@ -294,9 +312,11 @@ File::~File()
     {
         fclose((FILE *)this->data);
     }
+    this->unmap();
 
     delete[] this->filename;
 	delete[] this->contents;
+    delete[] this->stream_buffer;
 }
 
 void
@@ -328,6 +348,9 @@ File::set_mode(int mode)
     if (this->mode == mode)
         return;
     
+    this->packed = false;
+    this->drop_stream();
+    
     switch (mode)
     {
         case MODE_UNOPENED:
@@ -346,12 +369,30 @@ File::set_mode(int mode)
             {
                 fclose((FILE *)this->data);
             }
+            if (mode != MODE_READ)
+            {
+                this->unmap();
+            }
             
             this->data = fopen(this->filename, fopen_mode[mode]);
             if (this->data == NULL)
             {
-                this->set_mode(MODE_UNOPENED);
-                throw 666;
+                // Missing files can still be read from a pack
+                size_t size;
+                const void *contents = (mode == MODE_READ)
+                    ? pack::find(this->filename, &size)
+                    : NULL;
+                
+                if (contents == NULL)
+                {
+                    this->set_mode(MODE_UNOPENED);
+                    throw 666;
+                }
+                
+                this->packed     = true;
+                this->stream     = (const unsigned char *)contents;
+                this->stream_pos = 0;
+                this->stream_end = size;
             }
             
             if (mode == MODE_APPEND)
@@ -370,7 +411,7 @@ File::set_mode(int mode)
 bool
 File::exists(void)
 {
-    if (this->data != NULL)
+    if (this->data != NULL || this->packed)
         return true;
     
     FILE *file = fopen(this->filename, "rb");
@@ -380,7 +421,7 @@ File::exists(void)
         return true;
     }
     
-    return false;
+    return (pack::find(this->filename) != NULL);
 }
 
 void
@@ -417,6 +458,10 @@ File::get_size(void)
         
         fseek((FILE *)this->data, pos, SEEK_SET);
     }
+    else if (this->packed)
+    {
+        size = this->stream_end;
+    }
     else
     {
         FILE *file = fopen(this->filename, "rb");
@@ -430,7 +475,7 @@ File::get_size(void)
             
             fclose(file);
         }
-        else
+        else if (pack::find(this->filename, &size) == NULL)
         {
             size = 0;
         }
@@ -439,11 +484,76 @@ File::get_size(void)
     return size;
 }
 
+#define STREAM_BUFFER_SIZE 4096
+
 size_t
 File::read(void *ptr, size_t size, size_t count)
 {
     this->set_mode(MODE_READ);
-    return fread(ptr, size, count, (FILE *)this->data);
+    
+    size_t bytes = size * count, done = 0;
+    if (bytes == 0)
+        return 0;
+    
+    unsigned char *dst = (unsigned char *)ptr;
+    while (done < bytes)
+    {
+        size_t available = this->stream_end - this->stream_pos;
+        if (available == 0)
+        {
+            // Packed files are buffered whole
+            if (this->packed)
+                break;
+            
+            // Large reads skip the buffer
+            if (bytes - done >= STREAM_BUFFER_SIZE)
+            {
+                done += fread(dst + done, 1, bytes - done, (FILE *)this->data);
+                break;
+            }
+            
+            if (this->stream_buffer == NULL)
+                this->stream_buffer = new unsigned char[STREAM_BUFFER_SIZE];
+            
+            this->stream     = this->stream_buffer;
+            this->stream_pos = 0;
+            this->stream_end = fread(this->stream_buffer, 1, STREAM_BUFFER_SIZE, (FILE *)this->data);
+            if (this->stream_end == 0)
+                break;
+            
+            continue;
+        }
+        
+        size_t n = std::min(available, bytes - done);
+        memcpy(dst + done, this->stream + this->stream_pos, n);
+        this->stream_pos += n;
+        done             += n;
+    }
+    
+    // Read-ahead hits the end of the FILE early, so keep our own flag
+    if (done < bytes)
+        this->at_eof = true;
+    
+    return done / size;
+}
+
+void
+File::drop_stream(void)
+{
+    if (!this->packed)
+        this->stream_pos = this->stream_end = 0;
+    
+    this->at_eof = false;
+}
+
+void
+File::unbuffer(void)
+{
+    size_t unread = this->stream_end - this->stream_pos;
+    if (unread > 0 && !this->packed)
+        fseek((FILE *)this->data, -(long int)unread, SEEK_CUR);
+    
+    this->drop_stream();
 }
 
 size_t
@@ -492,10 +602,13 @@ File::remove(void)
 size_t
 File::get_pos(void)
 {
+    if (this->packed)
+        return this->stream_pos;
+    
     if (this->data == NULL)
         return 0;
     
-    return ftell((FILE *)this->data);
+    return ftell((FILE *)this->data) - (this->stream_end - this->stream_pos);
 }
 
 void
@@ -504,7 +617,10 @@ File::set_pos(long int byte)
     if (this->mode != MODE_WRITE)
         this->set_mode(MODE_READ);
     
-    if (fseek((FILE *)this->data, byte, SEEK_SET) != 0)
+    this->drop_stream();
+    if (this->packed)
+        this->seek_packed(byte);
+    else if (fseek((FILE *)this->data, byte, SEEK_SET) != 0)
         throw 666;
 }
 
@@ -514,7 +630,10 @@ File::seek(long int byte_offset)
     if (this->mode != MODE_WRITE)
         this->set_mode(MODE_READ);
     
-    if (fseek((FILE *)this->data, byte_offset, SEEK_CUR) != 0)
+    this->unbuffer();
+    if (this->packed)
+        this->seek_packed(this->stream_pos + byte_offset);
+    else if (fseek((FILE *)this->data, byte_offset, SEEK_CUR) != 0)
         throw 666;
 }
 
@@ -524,13 +643,34 @@ File::rewind(void)
     if (this->mode != MODE_WRITE)
         this->set_mode(MODE_READ);
 
-    ::rewind((FILE *)this->data);
+    this->drop_stream();
+    if (this->packed)
+        this->stream_pos = 0;
+    else
+        ::rewind((FILE *)this->data);
+}
+
+void
+File::seek_packed(long int byte)
+{
+    if (byte < 0 || (size_t)byte > this->stream_end)
+        throw 666;
+    
+    this->stream_pos = byte;
 }
 
 bool
 File::eof(void)
 {
-    return (this->data != NULL && feof((FILE *)this->data) != 0);
+    if (this->packed)
+        return this->at_eof;
+    
+    if (this->data == NULL)
+        return false;
+    
+    // While buffered, the FILE itself may have reached the end ahead of us
+    return (this->at_eof
+        || (this->stream_end == 0 && feof((FILE *)this->data) != 0));
 }
 
 char *
@@ -538,6 +678,33 @@ File::read(void)
 {
 #define CHUNK_SIZE 256
     this->set_mode(MODE_READ);
+    this->unbuffer();
+    
+    if (this->packed)
+    {
+        // Lines straight from the pack
+        const char
+            *s   = (const char *)this->stream + this->stream_pos,
+            *end = (const char *)this->stream + this->stream_end,
+            *eol = (const char *)memchr(s, '\n', end - s);
+        
+        size_t len = ((eol != NULL) ? eol : end) - s;
+        
+        this->stream_pos += len + (eol != NULL);
+        this->at_eof      = (eol == NULL);
+        if (s < end)
+            this->mutable_line_number++;
+        
+        // ignore carriage return in Windows style line breaks
+        if (len && s[len - 1] == '\r')
+            len--;
+        
+        char *result = new char[len + 1];
+        memcpy(result, s, len);
+        result[len] = '\0';
+        
+        return result;
+    }
     
     char buf[CHUNK_SIZE];
     char *result = NULL, *s, *end;
@@ -634,8 +801,23 @@ File::get_contents(bool force_update)
     FILE *file = fopen(this->filename, "r");
     if (file == NULL)
     {
-        // engine.log("(!) File not found: %s", this->filename);
-        return "";
+        size_t size;
+        const void *packed = pack::find(this->filename, &size);
+        if (packed == NULL)
+        {
+            // engine.log("(!) File not found: %s", this->filename);
+            return "";
+        }
+        
+        if (this->contents == NULL || force_update)
+        {
+            delete[] this->contents;
+            this->contents = new char[size + 1];
+            memcpy(this->contents, packed, size);
+            this->contents[size] = '\0';
+        }
+        
+        return this->contents;
     }
     
     fseek(file, 0, SEEK_END);
@@ -658,100 +840,352 @@ File::get_contents(bool force_update)
     return this->contents;
 }
 
-void
-File::write_uint8(unsigned int n)
+const void *
+File::map(size_t *size_out)
 {
-    unsigned char v = n;
-    this->write(&v, 1, 1);
+    if (this->mapping != NULL)
+    {
+        if (size_out != NULL)
+            *size_out = this->mapping_size;
+        
+        return this->mapping;
+    }
+    
+    size_t size = 0;
+    void  *view = NULL;
+    
+#ifdef _WIN32
+    HANDLE file = CreateFileA(this->filename, GENERIC_READ, FILE_SHARE_READ,
+        NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return this->map_packed(size_out);
+    
+    size = GetFileSize(file, NULL);
+    if (size != 0 && size != INVALID_FILE_SIZE)
+    {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL)
+        {
+            // The view keeps the file open
+            view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(this->filename, O_RDONLY);
+    if (file < 0)
+        return this->map_packed(size_out);
+    
+    struct stat info;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+    {
+        size = info.st_size;
+        view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (view == MAP_FAILED)
+            view = NULL;
+    }
+    ::close(file);
+#endif
+    
+    this->mapping      = view;
+    this->mapping_size = (view != NULL) ? size : 0;
+    
+    if (size_out != NULL)
+        *size_out = this->mapping_size;
+    
+    return this->mapping;
 }
 
 void
-File::write_uint16(unsigned int n)
+File::unmap(void)
 {
-    unsigned char v[2];
-    v[0] = (n >> 8) & 0xff;
-    v[1] =  n       & 0xff;
-    this->write(v, 1, 2);
+    if (this->mapping == NULL)
+        return;
+    
+    if (!this->mapping_packed)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(this->mapping);
+#else
+        munmap(this->mapping, this->mapping_size);
+#endif
+    }
+    
+    this->mapping        = NULL;
+    this->mapping_packed = false;
 }
 
-void
-File::write_uint32(unsigned long int n)
+const void *
+File::map_packed(size_t *size_out)
 {
-    unsigned char v[4];
-    v[0] = (n >> 24) & 0xff;
-    v[1] = (n >> 16) & 0xff;
-    v[2] = (n >> 8)  & 0xff;
-    v[3] =  n        & 0xff;
-    this->write(v, 1, 4);
+    size_t      size;
+    const void *view = pack::find(this->filename, &size);
+    
+    // Empty files map to NULL, as they would when loose
+    if (view == NULL || size == 0)
+        return NULL;
+    
+    this->mapping        = (void *)view;
+    this->mapping_size   = size;
+    this->mapping_packed = true;
+    
+    if (size_out != NULL)
+        *size_out = size;
+    
+    return view;
 }
 
-void
-File::write_int(int n)
+/*
+    Binary encodings, shared by the single value and bulk functions:
+    big-endian unsigned integers, 32-bit sign-magnitude integers and
+    sign-magnitude 16.16 fixed point floats. Each codec is branchless
+    so that the bulk loops below vectorize.
+*/
+template <class T>
+struct Codec;
+
+template <>
+struct Codec<unsigned char>
 {
-    int sign_bit;
-    unsigned long int i;
-    unsigned char v[4];
+    static const size_t SIZE = 1;
+    
+    static inline unsigned char
+    decode(const unsigned char *v) { return v[0]; }
+    
+    static inline void
+    encode(unsigned char n, unsigned char *v) { v[0] = n; }
+};
+
+template <>
+struct Codec<unsigned short>
+{
+    static const size_t SIZE = 2;
+    
+    static inline unsigned short
+    decode(const unsigned char *v) { return (v[0] << 8) | v[1]; }
     
-    if (n < 0)
+    static inline void
+    encode(unsigned short n, unsigned char *v)
     {
-        i = -n;
-        sign_bit = 1;
+        v[0] = (n >> 8) & 0xff;
+        v[1] =  n       & 0xff;
     }
-    else
+};
+
+template <>
+struct Codec<unsigned int>
+{
+    static const size_t SIZE = 4;
+    
+    static inline unsigned int
+    decode(const unsigned char *v)
     {
-        i = n;
-        sign_bit = 0;
+        return ((unsigned int)v[0] << 24)
+             | ((unsigned int)v[1] << 16)
+             | ((unsigned int)v[2] << 8 )
+             |  (unsigned int)v[3];
     }
     
-    v[0] = (i >> 24) & 0xff;
-    v[1] = (i >> 16) & 0xff;
-    v[2] = (i >> 8 ) & 0xff;
-    v[3] =  i        & 0xff;
-    
-    if (sign_bit)
+    static inline void
+    encode(unsigned int n, unsigned char *v)
     {
-        v[0] |= 0x80;
+        v[0] = (n >> 24) & 0xff;
+        v[1] = (n >> 16) & 0xff;
+        v[2] = (n >> 8 ) & 0xff;
+        v[3] =  n        & 0xff;
     }
-    else
+};
+
+template <>
+struct Codec<int>
+{
+    static const size_t SIZE = 4;
+    
+    static inline int
+    decode(const unsigned char *v)
     {
-        v[0] &= 0x7f;
+        int i = Codec<unsigned int>::decode(v) & 0x7fffffff;
+        return (v[0] & 0x80) ? -i : i;
     }
     
-    this->write(v, 1, 4);
-}
+    static inline void
+    encode(int n, unsigned char *v)
+    {
+        unsigned int i = (n < 0) ? -n : n;
+        Codec<unsigned int>::encode((i & 0x7fffffff) | ((unsigned int)(n < 0) << 31), v);
+    }
+};
 
-void
-File::write_float(float f)
+template <>
+struct Codec<float>
 {
-    int sign_bit;
-    unsigned long int i;
-    unsigned char v[4];
+    static const size_t SIZE = 4;
     
-    if (f < 0)
+    static inline float
+    decode(const unsigned char *v)
     {
-        f *= -1;
-        sign_bit = 1;
+        float f = (float)(Codec<unsigned int>::decode(v) & 0x7fffffff) / 65535.0f;
+        return (v[0] & 0x80) ? -f : f;
     }
-    else
+    
+    static inline void
+    encode(float f, unsigned char *v)
     {
-        sign_bit = 0;
+        unsigned int i = (unsigned long int)(((f < 0) ? -f : f) * 65535.0f);
+        Codec<unsigned int>::encode((i & 0x7fffffff) | ((unsigned int)(f < 0) << 31), v);
     }
+};
+
+#define BULK_CHUNK_SIZE 4096
+
+template <class T>
+static void
+_read_array(File *file, T *dst, size_t count, size_t components, size_t stride)
+{
+    const size_t size  = Codec<T>::SIZE;
+    size_t       total = count * components;
     
-    i = f * 65535.0f;
-    v[0] = (i >> 24) & 0xff;
-    v[1] = (i >> 16) & 0xff;
-    v[2] = (i >> 8 ) & 0xff;
-    v[3] =  i        & 0xff;
-    
-    if (sign_bit)
+    if ((stride == 0 || stride == components * sizeof(T)) && size == sizeof(T))
     {
-        v[0] |= 0x80;
+        // Packed: read straight into the destination and convert in place
+        file->read(dst, size, total);
+        
+        const unsigned char *v = (const unsigned char *)dst;
+        for (size_t i = 0; i < total; ++i)
+        {
+            dst[i] = Codec<T>::decode(v + i * size);
+        }
+        return;
     }
-    else
+    
+    if (stride == 0)
+        stride = components * sizeof(T);
+    
+    unsigned char raw[BULK_CHUNK_SIZE];
+    char  *record    = (char *)dst;
+    size_t component = 0;
+    
+    while (total > 0)
     {
-        v[0] &= 0x7f;
+        size_t n = std::min(total, BULK_CHUNK_SIZE / size);
+        file->read(raw, size, n);
+        
+        for (size_t i = 0; i < n; ++i)
+        {
+            ((T *)record)[component] = Codec<T>::decode(raw + i * size);
+            if (++component == components)
+            {
+                component = 0;
+                record   += stride;
+            }
+        }
+        
+        total -= n;
     }
+}
+
+template <class T>
+static void
+_write_array(File *file, const T *src, size_t count, size_t components, size_t stride)
+{
+    const size_t size  = Codec<T>::SIZE;
+    size_t       total = count * components;
+    
+    if (stride == 0)
+        stride = components * sizeof(T);
     
+    unsigned char raw[BULK_CHUNK_SIZE];
+    const char *record    = (const char *)src;
+    size_t      component = 0;
+    
+    while (total > 0)
+    {
+        size_t n = std::min(total, BULK_CHUNK_SIZE / size);
+        
+        if (stride == components * sizeof(T))
+        {
+            const T *s = (const T *)record + component;
+            for (size_t i = 0; i < n; ++i)
+            {
+                Codec<T>::encode(s[i], raw + i * size);
+            }
+            
+            record   += ((component + n) / components) * stride;
+            component = (component + n) % components;
+        }
+        else
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                Codec<T>::encode(((const T *)record)[component], raw + i * size);
+                if (++component == components)
+                {
+                    component = 0;
+                    record   += stride;
+                }
+            }
+        }
+        
+        file->write(raw, size, n);
+        total -= n;
+    }
+}
+
+#define BULK_IO(T) \
+    template <> void \
+    File::read_array<T>(T *dst, size_t count, size_t components, size_t stride) \
+    { _read_array<T>(this, dst, count, components, stride); } \
+    \
+    template <> void \
+    File::write_array<T>(const T *src, size_t count, size_t components, size_t stride) \
+    { _write_array<T>(this, src, count, components, stride); }
+
+BULK_IO(unsigned char)
+BULK_IO(unsigned short)
+BULK_IO(unsigned int)
+BULK_IO(int)
+BULK_IO(float)
+
+#undef BULK_IO
+
+void
+File::write_uint8(unsigned int n)
+{
+    unsigned char v[1];
+    Codec<unsigned char>::encode(n, v);
+    this->write(v, 1, 1);
+}
+
+void
+File::write_uint16(unsigned int n)
+{
+    unsigned char v[2];
+    Codec<unsigned short>::encode(n, v);
+    this->write(v, 1, 2);
+}
+
+void
+File::write_uint32(unsigned long int n)
+{
+    unsigned char v[4];
+    Codec<unsigned int>::encode(n, v);
+    this->write(v, 1, 4);
+}
+
+void
+File::write_int(int n)
+{
+    unsigned char v[4];
+    Codec<int>::encode(n, v);
+    this->write(v, 1, 4);
+}
+
+void
+File::write_float(float f)
+{
+    unsigned char v[4];
+    Codec<float>::encode(f, v);
     this->write(v, 1, 4);
 }
 
@@ -780,70 +1214,41 @@ File::write_magic(const char *magic_word)
 unsigned int
 File::read_uint8(void)
 {
-    unsigned char v;
-    this->read(&v, 1, 1);
-    
-    return v;
+    unsigned char v[1] = { 0 };
+    this->read(v, 1, 1);
+    return Codec<unsigned char>::decode(v);
 }
 
 unsigned int
 File::read_uint16(void)
 {
-    unsigned char v[2];
+    unsigned char v[2] = { 0 };
     this->read(v, 1, 2);
-    return (v[0] << 8) | v[1];
+    return Codec<unsigned short>::decode(v);
 }
 
 unsigned long int
 File::read_uint32(void)
 {
-    unsigned char v[4];
+    unsigned char v[4] = { 0 };
     this->read(v, 1, 4);
-    return (v[0] << 24) | (v[1] << 16) | (v[2] << 8) | v[3];
+    return Codec<unsigned int>::decode(v);
 }
 
 int
 File::read_int(void)
 {
-    int sign_bit;
-    unsigned long int i;
-    unsigned char v[4];
-    
+    unsigned char v[4] = { 0 };
     this->read(v, 1, 4);
-    
-    sign_bit = (v[0] & 0x80);
-    
-    v[0] &= 0x7f; /* clear sign bit */
-    
-    i = ((unsigned long int)v[0] << 24)
-      | ((unsigned long int)v[1] << 16)
-      | ((unsigned long int)v[2] << 8 )
-      |  (unsigned long int)v[3];
-    
-    return (sign_bit) ? -((int)i) : (int)i;
+    return Codec<int>::decode(v);
 }
 
 float
 File::read_float(void)
 {
-    int sign_bit;
-    unsigned long int i;
-    unsigned char v[4];
-    
+    unsigned char v[4] = { 0 };
     this->read(v, 1, 4);
-    
-    sign_bit = (v[0] & 0x80);
-    
-    v[0] &= 0x7f; /* clear sign bit */
-    
-    i = ((unsigned long int)v[0] << 24)
-      | ((unsigned long int)v[1] << 16)
-      | ((unsigned long int)v[2] << 8 )
-      |  (unsigned long int)v[3];
-    
-    return (sign_bit)
-        ? (float)i / -65535.0f
-        : (float)i / 65535.0f;
+    return Codec<float>::decode(v);
 }
 
 char *
@@ -886,6 +1291,236 @@ File::test_magic(const char *magic_word)
     }
 }
 
+TextReader::TextReader(File *file):
+    line_number(mutable_line_number),
+    buffer(mutable_buffer),
+    size(mutable_size)
+{
+    this->mutable_buffer = (const char *)file->map(&this->mutable_size);
+    if (this->mutable_buffer == NULL)
+    {
+        this->mutable_buffer = "";
+        this->mutable_size   = 0;
+    }
+    
+    this->rewind();
+}
+
+TextReader::TextReader(const char *s, size_t length):
+    line_number(mutable_line_number),
+    buffer(mutable_buffer),
+    size(mutable_size)
+{
+    this->mutable_buffer = s;
+    this->mutable_size   = length;
+    
+    this->rewind();
+}
+
+void
+TextReader::rewind(void)
+{
+    this->pos                 = this->buffer;
+    this->mutable_line_number = 0;
+}
+
+bool
+TextReader::next_line(Token *line)
+{
+    const char *end = this->buffer + this->size;
+    if (this->pos >= end)
+    {
+        return false;
+    }
+    
+    const char *s = (const char *)memchr(this->pos, '\n', end - this->pos);
+    if (s == NULL)
+    {
+        s = end;
+    }
+    
+    line->s      = this->pos;
+    line->length = s - this->pos;
+    
+    // Ignore carriage return in Windows style line breaks
+    if (line->length > 0 && s[-1] == '\r')
+    {
+        line->length--;
+    }
+    
+    this->pos = s + 1;
+    this->mutable_line_number++;
+    
+    return true;
+}
+
+static inline bool
+_is_space(char c)
+{
+    return (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f');
+}
+
+bool
+TextReader::next_token(Token *rest, Token *token)
+{
+    if (rest->s == NULL)
+    {
+        return false;
+    }
+    
+    const char *s = rest->s, *end = rest->s + rest->length;
+    for (; s < end && _is_space(*s); ++s);
+    
+    const char *start = s;
+    for (; s < end && !_is_space(*s); ++s);
+    
+    if (s == start)
+    {
+        rest->s      = NULL;
+        rest->length = 0;
+        return false;
+    }
+    
+    token->s      = start;
+    token->length = s - start;
+    rest->s       = s;
+    rest->length  = end - s;
+    
+    return true;
+}
+
+bool
+TextReader::next_field(Token *rest, Token *field, char separator)
+{
+    if (rest->s == NULL)
+    {
+        return false;
+    }
+    
+    const char *s = (const char *)memchr(rest->s, separator, rest->length);
+    
+    field->s = rest->s;
+    if (s == NULL)
+    {
+        field->length = rest->length;
+        rest->s       = NULL;
+        rest->length  = 0;
+    }
+    else
+    {
+        field->length = s - rest->s;
+        rest->length -= field->length + 1;
+        rest->s       = s + 1;
+    }
+    
+    return true;
+}
+
+TextReader::Token
+TextReader::trim(Token token)
+{
+    if (token.s != NULL)
+    {
+        for (; token.length > 0 && _is_space(*token.s); ++token.s, --token.length);
+        for (; token.length > 0 && _is_space(token.s[token.length - 1]); --token.length);
+    }
+    
+    return token;
+}
+
+bool
+TextReader::equals(const Token &token, const char *s)
+{
+    return (token.s != NULL
+        && strncmp(token.s, s, token.length) == 0
+        && s[token.length] == '\0');
+}
+
+double
+TextReader::to_number(const Token &token, double fallback)
+{
+    // Mappings aren't NUL-terminated, so strtod() could run past the end
+    const char *s = token.s, *end = token.s + token.length;
+    if (s == NULL)
+    {
+        return fallback;
+    }
+    
+    for (; s < end && _is_space(*s); ++s);
+    
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+'))
+    {
+        negative = (*s++ == '-');
+    }
+    
+    // Collect all digits as an integer, then scale once
+    double n        = 0.0;
+    bool   digits   = false;
+    int    exponent = 0;
+    for (; s < end && *s >= '0' && *s <= '9'; ++s, digits = true)
+    {
+        n = n * 10.0 + (*s - '0');
+    }
+    
+    if (s < end && *s == '.')
+    {
+        for (++s; s < end && *s >= '0' && *s <= '9'; ++s, digits = true)
+        {
+            n = n * 10.0 + (*s - '0');
+            exponent--;
+        }
+    }
+    
+    if (!digits)
+    {
+        return fallback;
+    }
+    
+    if (s < end && (*s == 'e' || *s == 'E'))
+    {
+        bool negative_exponent = false;
+        if (++s < end && (*s == '-' || *s == '+'))
+        {
+            negative_exponent = (*s++ == '-');
+        }
+        
+        int e = 0;
+        for (; s < end && *s >= '0' && *s <= '9'; ++s)
+        {
+            e = (e < 10000) ? e * 10 + (*s - '0') : e;
+        }
+        exponent += (negative_exponent) ? -e : e;
+    }
+    
+    double scale = 1.0, power = 10.0;
+    for (int e = (exponent < 0) ? -exponent : exponent; e > 0; e >>= 1, power *= power)
+    {
+        if (e & 1)
+        {
+            scale *= power;
+        }
+    }
+    n = (exponent < 0) ? n / scale : n * scale;
+    
+    return (negative) ? -n : n;
+}
+
+char *
+TextReader::dup(const Token &token)
+{
+    if (token.s == NULL)
+    {
+        return core::str::empty();
+    }
+    
+    char *s = new char[token.length + 1];
+    memcpy(s, token.s, token.length);
+    s[token.length] = '\0';
+    
+    return s;
+}
+
 
 static bool _dir_delimiter[0xff + 1] = { // '/', '\\' and '\0'
 /*       00, 01, 02, 03, 04, 05, 06, 07, 08, 09, 0a, 0b, 0c, 0d, 0e, 0f, */
@@ -910,8 +1545,20 @@ static bool _dir_delimiter[0xff + 1] = { // '/', '\\' and '\0'
 char *
 core::str::normalize_path(const char *path, bool trailing_slash)
 {
+    int n = strlen(path) + 2;
+    return core::str::normalize_path(new char[n], n, path, trailing_slash);
+}
+
+char *
+core::str::normalize_path(char *buffer, int n, const char *path, bool trailing_slash)
+{
+    if (n < (int)strlen(path) + 2)
+    {
+        return NULL;
+    }
+
     char
-        *normalized = new char[strlen(path) + 2],
+        *normalized = buffer,
         *dst = normalized,
          c;
 
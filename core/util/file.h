@@ -16,6 +16,7 @@
         Read/write text and binary files in a portable format
         Test if a file exist
         Create, delete, copy and move files
+        Files missing from the disk are read from mounted packs (see pack.h)
 
         ------------------------------------------------------------------------
         core::File text("test.txt");
@@ -24,6 +25,22 @@
         data->write_uint16(42);
         data->rewind();
         int i = data->read_uint16();
+        data->write_array(&vertices[0].x, vertices.size(), 3, sizeof(math::Vec3));
+        float *heights = data->read_array<float>(n);
+        ------------------------------------------------------------------------
+
+
+    core::TextReader
+        Walks a memory-mapped text file line by line and token by token
+        without copying or allocating; tokens point into the mapping
+
+        ------------------------------------------------------------------------
+        core::File file("test.obj");
+        core::TextReader text(&file);
+        core::TextReader::Token line, token;
+        while (text.next_line(&line))
+            while (core::TextReader::next_token(&line, &token))
+                printf("%.*s\n", (int)token.length, token.s);
         ------------------------------------------------------------------------
 
 */
@@ -33,6 +50,7 @@
 
 #include <cstddef>
 #include "config.h"
+#include "string.h"
 
 #define DATA_DIRECTORY "../data/"
 
@@ -50,6 +68,11 @@ namespace core
         normalize_path(const char *path, bool trailing_slash = false);
         // Remove all redundant ./ and ../ directives
 
+        char *
+        normalize_path(char *buffer, int n, const char *path, bool trailing_slash = false);
+        // Same as above without allocating. Returns NULL if buffer holds
+        // less than len(path) + 2 characters.
+
         char *
         get_directory(const char *path);
         // Return directory path with a trailing slash with filename (or last directory) stripped
@@ -129,6 +152,14 @@ namespace core
         const char *
         get_contents(bool force_update = false);
         // Stays valid until object desctruction. Reads and buffers the file only upon first call, or if force_update is true.
+
+        const void *
+        map(size_t *size = NULL);
+        // Maps the whole file read-only, NULL if missing or empty.
+        // Stays valid until unmap(), writing to the file or object destruction.
+
+        void
+        unmap(void);
         
         bool   eof(void);
         bool   exists(void);
@@ -169,6 +200,16 @@ namespace core
         void              write_uint32 (unsigned long int n);
         void              write_string (const char *s); // 0...65534 characters or NULL.
 
+        /* BULK IO:       count records of `components` values each, records `stride` bytes apart (0 = packed).
+                          Values are encoded as by the matching single value functions above:
+                          unsigned char/short/int as uint8/16/32, int as int, float as float. */
+        template <class T>
+        void              read_array   (T *dst, size_t count, size_t components = 1, size_t stride = 0);
+        template <class T>
+        T *               read_array   (size_t count) { T *dst = new T[count]; this->read_array(dst, count); return dst; }
+        template <class T>
+        void              write_array  (const T *src, size_t count, size_t components = 1, size_t stride = 0);
+
         /* MAGIC WORDS:   Write/test for a matching string in the file. */
         void              write_magic  (const char *magic_word);
         void              test_magic   (const char *magic_word); // Throws an exception on mismatch.
@@ -179,11 +220,98 @@ namespace core
         char *contents, *mutable_filename, *mutable_ext;
         void *data;
 
+        void  *mapping;
+        size_t mapping_size;
+        bool   mapping_packed; // points into a pack, not to be unmapped
+
+        unsigned char       *stream_buffer; // read buffer, refilled in blocks
+        const unsigned char *stream;        // stream_buffer, or the whole file when packed
+        size_t               stream_pos, stream_end;
+        bool                 at_eof, packed;
+
         void
         set_filename(const char *filename);
 
         void
         set_mode(int mode); // opens or closes the file in appropriate mode if not done already
+
+        void
+        drop_stream(void); // forgets buffered data, the FILE position is left as is
+
+        void
+        unbuffer(void); // moves the FILE position back to the first unread byte
+
+        void
+        seek_packed(long int byte);
+
+        const void *
+        map_packed(size_t *size);
+    };
+
+    template <> void File::read_array <unsigned char >(unsigned char  *dst, size_t count, size_t components, size_t stride);
+    template <> void File::read_array <unsigned short>(unsigned short *dst, size_t count, size_t components, size_t stride);
+    template <> void File::read_array <unsigned int  >(unsigned int   *dst, size_t count, size_t components, size_t stride);
+    template <> void File::read_array <int           >(int            *dst, size_t count, size_t components, size_t stride);
+    template <> void File::read_array <float         >(float          *dst, size_t count, size_t components, size_t stride);
+
+    template <> void File::write_array<unsigned char >(const unsigned char  *src, size_t count, size_t components, size_t stride);
+    template <> void File::write_array<unsigned short>(const unsigned short *src, size_t count, size_t components, size_t stride);
+    template <> void File::write_array<unsigned int  >(const unsigned int   *src, size_t count, size_t components, size_t stride);
+    template <> void File::write_array<int           >(const int            *src, size_t count, size_t components, size_t stride);
+    template <> void File::write_array<float         >(const float          *src, size_t count, size_t components, size_t stride);
+
+    class TextReader
+    {
+    public:
+        typedef
+            str::View
+            Token;
+            // NULL when consumed
+
+        const int &line_number;
+
+        TextReader(File *file);
+        // Maps the file, which must outlive the reader. Missing files read as empty.
+
+        TextReader(const char *s, size_t length);
+
+        bool
+        next_line(Token *line);
+        // Returns the next line without its line break ("\n" or "\r\n"), false at the end
+
+        void
+        rewind(void);
+
+        const char * const &buffer;
+        const size_t       &size;
+
+        static bool
+        next_token(Token *rest, Token *token);
+        // Splits off the next whitespace separated token, false if none is left
+
+        static bool
+        next_field(Token *rest, Token *field, char separator);
+        // Splits off everything up to the next separator (possibly nothing),
+        // false once the last field has been returned
+
+        static Token
+        trim(Token token);
+
+        static bool
+        equals(const Token &token, const char *s);
+
+        static double
+        to_number(const Token &token, double fallback = 0.0);
+        // Parses a decimal number with an optional exponent, fallback if there is none
+
+        static char *
+        dup(const Token &token);
+        // Returns a NUL-terminated copy
+
+    protected:
+        const char *mutable_buffer, *pos;
+        size_t      mutable_size;
+        int         mutable_line_number;
     };
 }
 
@@ -0,0 +1,371 @@
+#include "pack.h"
+#include "config.h"
+#include "file.h"
+#include "string.h"
+
+#include <cstring> // memcpy, strcmp, strncmp, strlen
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+
+using namespace core;
+
+/*
+    Archive, little-endian 32-bit words, read in place:
+
+        "CPAK" version, entries (N), slots (S), name bytes (B)
+        S * { hash, entry + 1 }     open addressing on the path hash with
+                                    linear probing, 0 marks an empty slot
+        N * { name, offset, size }  name as an offset into the names,
+                                    offset from the start of the archive
+        B bytes of NUL-terminated names
+        file contents, each aligned to 16 bytes
+
+    Names are lower case, '/' separated and relative to DATA_DIRECTORY.
+*/
+#define PACK_MAGIC   "CPAK"
+#define PACK_VERSION 1
+#define PACK_ALIGN   16
+
+typedef
+    struct
+    {
+        char   magic[4];
+        Uint32 version, entries, slots, names;
+    }
+    _PackHeader;
+
+typedef
+    struct
+    {
+        Uint32 hash, entry;
+    }
+    _PackSlot;
+
+typedef
+    struct
+    {
+        Uint32 name, offset, size;
+    }
+    _PackEntry;
+
+typedef
+    struct
+    {
+        File             *file;
+        const char       *base;
+        const _PackSlot  *slot;
+        const _PackEntry *entry;
+        const char       *names;
+        Uint32            slots;
+    }
+    _Archive;
+
+static std::vector<_Archive *> _mounted;
+
+static char *
+_get_key(const char *path)
+// Name of path within a pack, NULL if it's not under DATA_DIRECTORY
+{
+    static const size_t prefix_length = strlen(DATA_DIRECTORY);
+
+    char *normalized = core::str::normalize_path(path);
+    for (char *s = normalized; *s != '\0'; ++s)
+    {
+        *s = (*s == '\\') ? '/' : core::str::lcase(*s);
+    }
+
+    char *key = (strncmp(normalized, DATA_DIRECTORY, prefix_length) == 0)
+        ? core::str::dup(normalized + prefix_length)
+        : NULL;
+
+    delete[] normalized;
+    return key;
+}
+
+bool
+pack::mount(const char *filename)
+{
+    File *file = new File(filename);
+
+    size_t      size;
+    const char *base = (const char *)file->map(&size);
+
+    if (base == NULL || size < sizeof(_PackHeader)
+        || strncmp(base, PACK_MAGIC, 4) != 0)
+    {
+        delete file;
+        return false;
+    }
+
+    const _PackHeader *header = (const _PackHeader *)base;
+    Uint32
+        entries = SDL_SwapLE32(header->entries),
+        slots   = SDL_SwapLE32(header->slots),
+        names   = SDL_SwapLE32(header->names);
+
+    _Archive *archive = new _Archive;
+    archive->file  = file;
+    archive->base  = base;
+    archive->slot  = (const _PackSlot *)(base + sizeof(_PackHeader));
+    archive->entry = (const _PackEntry *)(archive->slot + slots);
+    archive->names = (const char *)(archive->entry + entries);
+    archive->slots = slots;
+
+    // Check everything once, so that lookups can't run off the mapping.
+    // Fewer entries than slots guarantees that every probe ends.
+    bool valid = (SDL_SwapLE32(header->version) == PACK_VERSION
+        && slots > entries && (slots & (slots - 1)) == 0 && names >= 1
+        && slots   <= size / sizeof(_PackSlot)
+        && entries <= size / sizeof(_PackEntry)
+        && (size_t)(archive->names - base) + names <= size
+        && archive->names[names - 1] == '\0');
+
+    for (Uint32 e = 0; valid && e < entries; ++e)
+    {
+        const _PackEntry &entry = archive->entry[e];
+        Uint32
+            offset = SDL_SwapLE32(entry.offset),
+            length = SDL_SwapLE32(entry.size);
+
+        valid = (SDL_SwapLE32(entry.name) < names
+            && offset <= size && length <= size - offset);
+    }
+
+    for (Uint32 s = 0; valid && s < slots; ++s)
+    {
+        valid = (SDL_SwapLE32(archive->slot[s].entry) <= entries);
+    }
+
+    if (!valid)
+    {
+        delete archive;
+        delete file;
+        throw 666;
+    }
+
+    _mounted.push_back(archive);
+    return true;
+}
+
+void
+pack::unmount_all(void)
+{
+    for (size_t i = 0; i < _mounted.size(); ++i)
+    {
+        delete _mounted[i]->file;
+        delete _mounted[i];
+    }
+    _mounted.clear();
+}
+
+const void *
+pack::find(const char *path, size_t *size)
+{
+    if (_mounted.empty() || path == NULL)
+        return NULL;
+
+    char *key = _get_key(path);
+    if (key == NULL)
+        return NULL;
+
+    Uint32      hash   = Config::get_hash(key);
+    const void *result = NULL;
+
+    // Most recently mounted first
+    for (size_t i = _mounted.size(); result == NULL && i-- > 0;)
+    {
+        const _Archive *archive = _mounted[i];
+
+        for (Uint32 s = hash & (archive->slots - 1);; s = (s + 1) & (archive->slots - 1))
+        {
+            const _PackSlot &slot = archive->slot[s];
+            Uint32 entry = SDL_SwapLE32(slot.entry);
+            if (entry == 0)
+                break;
+
+            const _PackEntry &e = archive->entry[entry - 1];
+            if (SDL_SwapLE32(slot.hash) == hash
+                && strcmp(archive->names + SDL_SwapLE32(e.name), key) == 0)
+            {
+                result = archive->base + SDL_SwapLE32(e.offset);
+                if (size != NULL)
+                    *size = SDL_SwapLE32(e.size);
+
+                break;
+            }
+        }
+    }
+
+    delete[] key;
+    return result;
+}
+
+static void
+_collect(const char *directory, std::vector<char *> &paths)
+{
+    Dir files(directory, Dir::FILES | Dir::FULL_PATH | Dir::EXCLUDE_HIDDEN);
+    for (int i = 0; files[i] != NULL; ++i)
+    {
+        paths.push_back(core::str::dup(files[i]));
+    }
+
+    Dir subdirectories(directory, Dir::DIRECTORIES | Dir::FULL_PATH | Dir::EXCLUDE_HIDDEN);
+    for (int i = 0; subdirectories[i] != NULL; ++i)
+    {
+        _collect(subdirectories[i], paths);
+    }
+}
+
+int
+pack::build(const char *filename)
+{
+    pack::unmount_all();
+
+    std::vector<char *> paths;
+    _collect(DATA_DIRECTORY, paths);
+
+    // Case-insensitive duplicates can only be packed once
+    std::vector<char *>       keys;
+    std::vector<Uint32>       hashes;
+    std::vector<const char *> sources;
+    std::vector<_PackEntry>   entries;
+    std::string               names;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        char  *key  = _get_key(paths[i]);
+        Uint32 hash = (key != NULL) ? Config::get_hash(key) : 0;
+
+        bool duplicate = (key == NULL);
+        for (size_t k = 0; !duplicate && k < keys.size(); ++k)
+        {
+            duplicate = (hashes[k] == hash && strcmp(keys[k], key) == 0);
+        }
+
+        if (duplicate)
+        {
+            delete[] key;
+            continue;
+        }
+
+        _PackEntry entry;
+        entry.name   = names.size();
+        entry.offset = 0;
+        entry.size   = 0;
+        entries.push_back(entry);
+
+        names.append(key);
+        names.push_back('\0');
+
+        keys.push_back(key);
+        hashes.push_back(hash);
+        sources.push_back(paths[i] + strlen(DATA_DIRECTORY));
+    }
+    if (names.empty())
+    {
+        names.push_back('\0');
+    }
+
+    // At most half full
+    Uint32 slots = 16;
+    while (slots < 2 * entries.size())
+    {
+        slots <<= 1;
+    }
+
+    std::vector<_PackSlot> slot(slots);
+    for (Uint32 s = 0; s < slots; ++s)
+    {
+        slot[s].hash  = 0;
+        slot[s].entry = 0;
+    }
+    for (size_t e = 0; e < entries.size(); ++e)
+    {
+        Uint32 s = hashes[e] & (slots - 1);
+        while (slot[s].entry != 0)
+        {
+            s = (s + 1) & (slots - 1);
+        }
+
+        slot[s].hash  = SDL_SwapLE32(hashes[e]);
+        slot[s].entry = SDL_SwapLE32(e + 1);
+    }
+
+    // Contents follow the tables
+    size_t offset = sizeof(_PackHeader)
+        + slots * sizeof(_PackSlot)
+        + entries.size() * sizeof(_PackEntry)
+        + names.size();
+
+    for (size_t e = 0; e < entries.size(); ++e)
+    {
+        File source(sources[e]);
+
+        offset = (offset + PACK_ALIGN - 1) & ~(size_t)(PACK_ALIGN - 1);
+        entries[e].offset = offset;
+        entries[e].size   = source.get_size();
+        offset += entries[e].size;
+    }
+
+    _PackHeader header;
+    memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = SDL_SwapLE32(PACK_VERSION);
+    header.entries = SDL_SwapLE32(entries.size());
+    header.slots   = SDL_SwapLE32(slots);
+    header.names   = SDL_SwapLE32(names.size());
+
+    std::vector<_PackEntry> table(entries);
+    for (size_t e = 0; e < table.size(); ++e)
+    {
+        table[e].name   = SDL_SwapLE32(table[e].name);
+        table[e].offset = SDL_SwapLE32(table[e].offset);
+        table[e].size   = SDL_SwapLE32(table[e].size);
+    }
+
+    File file(filename);
+    file.empty();
+    file.write(&header, sizeof(header), 1);
+    file.write(&slot[0], sizeof(_PackSlot), slot.size());
+    if (!table.empty())
+        file.write(&table[0], sizeof(_PackEntry), table.size());
+    file.write(names.data(), 1, names.size());
+
+    static const char padding[PACK_ALIGN] = { 0 };
+    size_t position = sizeof(_PackHeader)
+        + slots * sizeof(_PackSlot)
+        + entries.size() * sizeof(_PackEntry)
+        + names.size();
+
+    for (size_t e = 0; e < entries.size(); ++e)
+    {
+        file.write(padding, 1, entries[e].offset - position);
+
+        if (entries[e].size > 0)
+        {
+            File        source(sources[e]);
+            size_t      size;
+            const void *contents = source.map(&size);
+
+            // A file that changed meanwhile must not shift the rest
+            if (contents == NULL || size != entries[e].size)
+            {
+                throw 666;
+            }
+
+            file.write(contents, 1, size);
+        }
+
+        position = entries[e].offset + entries[e].size;
+    }
+
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        delete[] paths[i];
+    }
+    for (size_t k = 0; k < keys.size(); ++k)
+    {
+        delete[] keys[k];
+    }
+
+    return entries.size();
+}
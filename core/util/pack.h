@@ -0,0 +1,48 @@
+/*
+    Asset pack.
+    The data directory as a single archive with a hashed table of contents,
+    memory-mapped on mount. core::File and gfx::Sprite::load fall back to the
+    mounted packs for any path that doesn't exist as a loose file, so loose
+    files override packed ones during development.
+
+        ------------------------------------------------------------------------
+        core::pack::build(PACK_FILENAME); // or run with --pack
+        core::pack::mount(PACK_FILENAME);
+
+        size_t size;
+        const void *png = core::pack::find("../data/video/sky.png", &size);
+        ------------------------------------------------------------------------
+
+    Mount before anything starts loading, lookups don't lock.
+*/
+
+#ifndef _CORE_UTIL_PACK_H
+#define _CORE_UTIL_PACK_H
+
+#include <cstddef>
+
+#define PACK_FILENAME "../data.pak" // relative to DATA_DIRECTORY, like any File
+
+namespace core
+{
+    namespace pack
+    {
+        bool
+        mount(const char *filename);
+        // Map an archive, false if there is none. Later mounts take precedence.
+
+        void
+        unmount_all(void);
+
+        const void *
+        find(const char *path, size_t *size = NULL);
+        // Contents of a packed file or NULL, path as it would be passed to fopen()
+
+        int
+        build(const char *filename);
+        // Pack every file under DATA_DIRECTORY, returns the number of files.
+        // Unmounts all packs first.
+    }
+}
+
+#endif
@@ -0,0 +1,179 @@
+#include "profiler.h"
+
+#ifdef PROFILING
+
+#include <SDL2/SDL.h>
+
+#include <cstdio>
+
+#define MAX_THREADS 32
+#define BUFFER_SIZE 65536 // zones per thread, must be a power of two
+
+using namespace core;
+
+typedef
+    struct
+    {
+        const char *name;
+        Uint64      start, end;
+    }
+    _Zone;
+
+typedef
+    struct
+    {
+        // Ring buffer, written only by the owning thread
+        _Zone        zone[BUFFER_SIZE];
+        SDL_atomic_t count;
+
+        SDL_threadID thread;
+        const char  *name;
+    }
+    _Buffer;
+
+static _Buffer      *_buffer[MAX_THREADS];
+static SDL_atomic_t  _buffer_count;
+
+static SDL_TLSID _tls   = SDL_TLSCreate();
+static Uint64    _epoch = SDL_GetPerformanceCounter();
+
+static _Buffer *
+_get_buffer(void)
+{
+    _Buffer *buffer = (_Buffer *)SDL_TLSGet(_tls);
+    if (buffer != NULL)
+    {
+        return buffer;
+    }
+
+    if (SDL_AtomicGet(&_buffer_count) >= MAX_THREADS)
+    {
+        return NULL;
+    }
+
+    int slot = SDL_AtomicAdd(&_buffer_count, 1);
+    if (slot >= MAX_THREADS)
+    {
+        return NULL;
+    }
+
+    buffer = new _Buffer;
+    buffer->thread = SDL_ThreadID();
+    buffer->name   = NULL;
+    SDL_AtomicSet(&buffer->count, 0);
+
+    SDL_AtomicSetPtr((void **)&_buffer[slot], buffer);
+    SDL_TLSSet(_tls, buffer, NULL);
+
+    return buffer;
+}
+
+static void
+_write_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+        {
+            fputc('\\', f);
+        }
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+void
+profiler::record(const char *name, Uint64 start, Uint64 end)
+{
+    _Buffer *buffer = _get_buffer();
+    if (buffer == NULL)
+    {
+        return;
+    }
+
+    int n = buffer->count.value;
+    _Zone *zone = &buffer->zone[n & (BUFFER_SIZE - 1)];
+
+    zone->name  = name;
+    zone->start = start;
+    zone->end   = end;
+
+    // Publish only after the zone has been written
+    SDL_AtomicSet(&buffer->count, n + 1);
+}
+
+void
+profiler::name_thread(const char *name)
+{
+    _Buffer *buffer = _get_buffer();
+    if (buffer != NULL)
+    {
+        buffer->name = name;
+    }
+}
+
+bool
+profiler::save(const char *filename)
+{
+    FILE *f = fopen(filename, "w");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    double to_usec = 1000000.0 / SDL_GetPerformanceFrequency();
+    const char *separator = "\n";
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    int threads = SDL_AtomicGet(&_buffer_count);
+    for (int t = 0; t < threads && t < MAX_THREADS; ++t)
+    {
+        _Buffer *buffer = (_Buffer *)SDL_AtomicGetPtr((void **)&_buffer[t]);
+        if (buffer == NULL)
+        {
+            continue;
+        }
+
+        unsigned long tid = (unsigned long)buffer->thread;
+
+        if (buffer->name != NULL)
+        {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":",
+                separator, tid);
+            _write_string(f, buffer->name);
+            fprintf(f, "}}");
+            separator = ",\n";
+        }
+
+        // The owner keeps recording meanwhile, so skip the oldest
+        // part of a full ring that may get overwritten while saving
+        unsigned int
+            last  = SDL_AtomicGet(&buffer->count),
+            first = (last > BUFFER_SIZE) ? last - BUFFER_SIZE + BUFFER_SIZE / 16 : 0;
+
+        for (unsigned int i = first; i != last; ++i)
+        {
+            const _Zone *zone = &buffer->zone[i & (BUFFER_SIZE - 1)];
+            if (zone->end < zone->start || zone->start < _epoch)
+            {
+                continue;
+            }
+
+            fprintf(f, "%s{\"name\":", separator);
+            _write_string(f, zone->name);
+            fprintf(f, ",\"cat\":\"zone\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+                tid,
+                (zone->start - _epoch) * to_usec,
+                (zone->end - zone->start) * to_usec);
+            separator = ",\n";
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+
+    return (fclose(f) == 0);
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+    Frame profiler.
+    Scoped zones are timed into per-thread buffers
+    and exported as Chrome trace event JSON
+    (open in chrome://tracing or ui.perfetto.dev).
+
+        ------------------------------------------------------------------------
+        void
+        Terrain::render(void)
+        {
+            PROFILE("Terrain::render");
+            ...
+        }
+        ------------------------------------------------------------------------
+
+    Everything expands to nothing unless PROFILING is defined.
+*/
+
+#ifndef _CORE_UTIL_PROFILER_H
+#define _CORE_UTIL_PROFILER_H
+
+#ifdef PROFILING
+
+#include <SDL2/SDL_timer.h>
+
+#define _PROFILE_JOIN(a, b) a ## b
+#define _PROFILE_ZONE(line) _PROFILE_JOIN(_profile_zone_, line)
+
+#define PROFILE(name)        core::profiler::Zone _PROFILE_ZONE(__LINE__)(name)
+#define PROFILE_THREAD(name) core::profiler::name_thread(name)
+
+namespace core
+{
+    namespace profiler
+    {
+        void
+        record(const char *name, Uint64 start, Uint64 end);
+        // Store a finished zone, name must outlive the profiler (string literal)
+
+        void
+        name_thread(const char *name);
+        // Label calling thread in exported traces
+
+        bool
+        save(const char *filename);
+        // Write all buffered zones as Chrome trace JSON
+
+        class Zone
+        {
+        public:
+            Zone(const char *name): name(name), start(SDL_GetPerformanceCounter()) {}
+            ~Zone() { record(this->name, this->start, SDL_GetPerformanceCounter()); }
+
+        private:
+            const char *name;
+            Uint64      start;
+        };
+    }
+}
+
+#else
+
+#define PROFILE(name)
+#define PROFILE_THREAD(name)
+
+#endif
+
+#endif
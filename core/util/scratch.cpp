@@ -0,0 +1,199 @@
+#include "scratch.h"
+#include "string.h"
+#include "file.h"
+
+#include <cstring>   // memcpy, strlen
+#include <cstdarg>
+#include <algorithm> // max
+#include <SDL2/SDL.h>
+
+using namespace core;
+
+#define BLOCK_SIZE 65536
+#define ALIGNMENT  8
+#define HEADER     ((sizeof(_Block) + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+
+typedef
+    struct _Block
+    {
+        struct _Block *next;
+        size_t         size, used;
+    }
+    _Block;
+
+typedef
+    struct
+    {
+        _Block *first, *current;
+        size_t  used; // Bytes in full blocks before current
+    }
+    _Arena;
+
+// Blocks are kept on reset, so that a thread reaching its usual peak
+// no longer touches the heap
+static SDL_TLSID    _tls  = 0;
+static SDL_SpinLock _lock = 0;
+
+static void
+_free_arena(void *data)
+{
+    _Arena *arena = (_Arena *)data;
+    for (_Block *block = arena->first, *next; block != NULL; block = next)
+    {
+        next = block->next;
+        delete[] (char *)block;
+    }
+
+    delete arena;
+}
+
+static _Arena *
+_get_arena(void)
+{
+    if (_tls == 0)
+    {
+        SDL_AtomicLock(&_lock);
+        if (_tls == 0)
+        {
+            _tls = SDL_TLSCreate();
+        }
+        SDL_AtomicUnlock(&_lock);
+    }
+
+    _Arena *arena = (_Arena *)SDL_TLSGet(_tls);
+    if (arena == NULL)
+    {
+        arena = new _Arena;
+        arena->first   = NULL;
+        arena->current = NULL;
+        arena->used    = 0;
+
+        SDL_TLSSet(_tls, arena, _free_arena);
+    }
+
+    return arena;
+}
+
+static _Block *
+_new_block(size_t size)
+{
+    _Block *block = (_Block *)new char[HEADER + size];
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+
+    return block;
+}
+
+void *
+scratch::alloc(size_t size)
+{
+    _Arena *arena = _get_arena();
+    _Block *block = arena->current;
+
+    size = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+
+    if (block == NULL)
+    {
+        block = arena->first = arena->current
+            = _new_block(std::max((size_t)BLOCK_SIZE, size));
+    }
+
+    // Move on to the next block that fits, appending one if none does
+    while (block->used + size > block->size)
+    {
+        arena->used += block->used;
+
+        if (block->next == NULL)
+        {
+            block->next = _new_block(std::max((size_t)BLOCK_SIZE, size));
+        }
+        block = arena->current = block->next;
+        block->used = 0;
+    }
+
+    // Everything handed out is a multiple of ALIGNMENT
+    void *p = (char *)block + HEADER + block->used;
+    block->used += size;
+
+    return p;
+}
+
+char *
+scratch::dup(const char *s)
+{
+    if (s == NULL)
+    {
+        s = "";
+    }
+
+    size_t len = strlen(s) + 1;
+    return (char *)memcpy(scratch::alloc(len), s, len);
+}
+
+char *
+scratch::cat(const char *s1, const char *s2)
+{
+    size_t
+        len1 = (s1 != NULL) ? strlen(s1) : 0,
+        len2 = (s2 != NULL) ? strlen(s2) : 0;
+
+    // memcpy() from NULL is undefined even when copying nothing
+    char *s = (char *)scratch::alloc(len1 + len2 + 1);
+    if (len1 > 0)
+    {
+        memcpy(s, s1, len1);
+    }
+    if (len2 > 0)
+    {
+        memcpy(s + len1, s2, len2);
+    }
+    s[len1 + len2] = '\0';
+
+    return s;
+}
+
+char *
+scratch::format(const char *format, ...)
+{
+    // Measure first, the arguments can only be walked once per va_start
+    va_list args;
+    va_start(args, format);
+    int n = str::nvformat(NULL, 0, format, args) + 1;
+    va_end(args);
+
+    char *s = (char *)scratch::alloc(n);
+    va_start(args, format);
+    str::nvformat(s, n, format, args);
+    va_end(args);
+
+    return s;
+}
+
+char *
+scratch::normalize_path(const char *path, bool trailing_slash)
+{
+    int n = strlen(path) + 2;
+    return str::normalize_path((char *)scratch::alloc(n), n, path, trailing_slash);
+}
+
+void
+scratch::reset(void)
+{
+    _Arena *arena = _get_arena();
+    if (arena->first != NULL)
+    {
+        arena->current       = arena->first;
+        arena->current->used = 0;
+        arena->used          = 0;
+    }
+}
+
+size_t
+scratch::used(void)
+{
+    _Arena *arena = _get_arena();
+    return (arena->current != NULL)
+        ? arena->used + arena->current->used
+        : 0;
+}
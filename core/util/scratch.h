@@ -0,0 +1,55 @@
+/*
+    Scratch memory.
+    Per-thread linear allocator for short-lived temporaries, mostly strings
+    built only to be looked up or passed on. Allocating bumps a pointer and
+    nothing is freed individually; the whole arena is rewound at once.
+
+        ------------------------------------------------------------------------
+        char *path = core::scratch::format("%s/%s.png", dir, name);
+        Sprite *sprite = cache[path];
+        // no delete[], path is gone by the next frame
+        ------------------------------------------------------------------------
+
+    On the main thread, allocations live until the end of the frame. On
+    worker threads, they live until the end of the job that made them.
+    Anything that must outlive that has to be copied with str::dup().
+*/
+
+#ifndef _CORE_UTIL_SCRATCH_H
+#define _CORE_UTIL_SCRATCH_H
+
+#include <cstddef>
+
+namespace core
+{
+    namespace scratch
+    {
+        void *
+        alloc(size_t size);
+        // Returns size bytes, aligned for any basic type
+
+        char *
+        dup(const char *s);
+
+        char *
+        cat(const char *s1, const char *s2);
+
+        char *
+        format(const char *format, ...);
+        // Same as str::format()
+
+        char *
+        normalize_path(const char *path, bool trailing_slash = false);
+        // Same as str::normalize_path()
+
+        void
+        reset(void);
+        // Releases everything this thread has allocated
+
+        size_t
+        used(void);
+        // Bytes this thread has allocated since the last reset
+    }
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <cstring>
 #include <cstdlib>
 #include <cstdarg>
+#include <algorithm> // min
 
 static unsigned char _lcase_table[0xff + 1] = {
     0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
@@ -128,6 +129,109 @@ core::str::dupn(const char *s, int n)
     return (char *)memcpy(dup, s, len);
 }
 
+typedef
+    struct
+    {
+        char   *buffer;
+        size_t  size,   // Bytes available in buffer
+                length; // Length of the whole result so far
+        bool    grow,   // Reallocate when full instead of truncating
+                heap;   // buffer was allocated with new[]
+    }
+    _Writer;
+
+static void
+_write(_Writer *w, const char *s, size_t len)
+{
+    if (w->grow && w->length + len >= w->size)
+    {
+        size_t size = w->size * 2;
+        for (; w->length + len >= size; size *= 2);
+
+        char *buffer = new char[size];
+        memcpy(buffer, w->buffer, w->length);
+        if (w->heap)
+        {
+            delete[] w->buffer;
+        }
+
+        w->buffer = buffer;
+        w->size   = size;
+        w->heap   = true;
+    }
+
+    if (w->length + 1 < w->size)
+    {
+        size_t room = w->size - 1 - w->length;
+        memcpy(w->buffer + w->length, s, (len < room) ? len : room);
+    }
+    w->length += len;
+}
+
+static void
+_vformat(_Writer *w, const char *format, va_list args)
+// Formats in a single pass, arguments are only read once
+{
+    char buf[128];
+    const char *s;
+
+    for (const char *p = format; *p != '\0'; ++p)
+    {
+        if (*p != '%')
+        {
+            for (s = p; p[1] != '\0' && p[1] != '%'; ++p);
+            _write(w, s, p - s + 1);
+            continue;
+        }
+
+        switch (*(++p))
+        {
+            case 's':
+                // NULL prints as nothing
+                if ((s = va_arg(args, char *)) != NULL)
+                {
+                    _write(w, s, strlen(s));
+                }
+                break;
+
+            case 'c':
+                buf[0] = (char)va_arg(args, int);
+                _write(w, buf, 1);
+                break;
+
+            case 'f':
+                _write(w, buf, sprintf(buf, "%f", va_arg(args, double)));
+                break;
+
+            case 'g':
+                _write(w, buf, sprintf(buf, "%g", va_arg(args, double)));
+                break;
+
+            case 'd':
+            case 'i':
+                _write(w, buf, sprintf(buf, "%i", va_arg(args, int)));
+                break;
+
+            case 'x':
+                _write(w, buf, sprintf(buf, "%x", va_arg(args, unsigned int)));
+                break;
+
+            case '\0':
+                // Trailing '%'
+                --p;
+                break;
+
+            default:
+                _write(w, p, 1);
+        }
+    }
+
+    if (w->size > 0)
+    {
+        w->buffer[(w->length < w->size) ? w->length : w->size - 1] = '\0';
+    }
+}
+
 char *
 core::str::format(const char *format, ...)
 {
@@ -142,86 +246,60 @@ core::str::format(const char *format, ...)
 char *
 core::str::vformat(const char *format, va_list args)
 {
-    char buf[128];
-    
-    size_t dup_len = 0, format_len = strlen(format) + 1;
-    char  *dup = new char[format_len];
-    dup[0] = '\0';
-    
-    char *cat;
-    
-    char c;
-    for (const char *p = format;; ++p)
+    // Short results are formatted on the stack and copied once
+    char    buffer[256];
+    _Writer w = { buffer, sizeof(buffer), 0, true, false };
+    _vformat(&w, format, args);
+
+    if (w.heap)
     {
-        c = *p;
-        if (c == '%')
-        {
-            c = *(++p);
-            switch (c)
-            {
-                case 's':
-                    cat = va_arg(args, char *);
-                    break;
-                    
-                case 'c':
-                    sprintf(buf, "%c", va_arg(args, int));
-                    cat = buf;
-                    break;
-                
-                case 'f':
-                    sprintf(buf, "%f", va_arg(args, double));
-                    cat = buf;
-                    break;
-                
-                case 'g':
-                    sprintf(buf, "%g", va_arg(args, double));
-                    cat = buf;
-                    break;
+        return w.buffer;
+    }
 
-                case 'd':
-                case 'i':
-                    sprintf(buf, "%i", va_arg(args, int));
-                    cat = buf;
-                    break;
-                    
-                case 'x':
-                    sprintf(buf, "%x", va_arg(args, unsigned int));
-                    cat = buf;
-                    break;
-                
-                default:
-                    cat = NULL;
-                    dup[dup_len++] = c;
-                    format_len--;
-            }
-            
-            if (cat != NULL)
-            {
-                size_t len = strlen(cat);
-                char *temp = new char[dup_len + len + format_len];
-                memcpy(temp, dup, dup_len);
-                memcpy(temp + dup_len, cat, len);
-                delete[] dup;
-                
-                dup_len += len;
-                dup      = temp;
-            }
+    char *dup = new char[w.length + 1];
+    return (char *)memcpy(dup, buffer, w.length + 1);
+}
 
-        }
-        else
-        {
-            dup[dup_len++] = c;
-            format_len--;
-        }
-        
-        
-        if (c == '\0')
-        {
-            break;
-        }
+int
+core::str::nformat(char *buffer, int n, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int length = core::str::nvformat(buffer, n, format, args);
+    va_end(args);
+
+    return length;
+}
+
+int
+core::str::nvformat(char *buffer, int n, const char *format, va_list args)
+{
+    _Writer w = { buffer, (size_t)n * (n > 0), 0, false, false };
+    _vformat(&w, format, args);
+
+    return (int)w.length;
+}
+
+char *
+core::str::ncat(char *buffer, int n, const char *s1, const char *s2)
+{
+    _Writer w = { buffer, (size_t)n * (n > 0), 0, false, false };
+    if (s1 != NULL)
+    {
+        _write(&w, s1, strlen(s1));
     }
-    
-    return dup;
+
+    if (s2 != NULL)
+    {
+        _write(&w, s2, strlen(s2));
+    }
+
+    if (n > 0)
+    {
+        buffer[(w.length < w.size) ? w.length : w.size - 1] = '\0';
+    }
+
+    return buffer;
 }
 
 char *
@@ -1087,3 +1165,135 @@ core::str::split_unescaped(const char *s, char delimiter)
     return list;
 }
 
+core::str::View
+core::str::view(const char *s)
+{
+    View v = { s, (s != NULL) ? strlen(s) : 0 };
+    return v;
+}
+
+core::str::View
+core::str::view(const char *start, const char *end)
+{
+    View v = { start, (size_t)(end - start) };
+    return v;
+}
+
+core::str::View
+core::str::substring(const View &v, size_t position, size_t length)
+{
+    if (position > v.length)
+    {
+        position = v.length;
+    }
+
+    View sub = { v.s + position, std::min(length, v.length - position) };
+    return sub;
+}
+
+core::str::View
+core::str::trim(View v)
+{
+    if (v.s != NULL)
+    {
+        for (; v.length > 0 && (unsigned char)*v.s <= ' '; ++v.s, --v.length);
+        for (; v.length > 0 && (unsigned char)v.s[v.length - 1] <= ' '; --v.length);
+    }
+
+    return v;
+}
+
+bool
+core::str::equals(const View &v, const char *s)
+{
+    return (v.s != NULL && s != NULL
+        && strncmp(v.s, s, v.length) == 0
+        && s[v.length] == '\0');
+}
+
+bool
+core::str::equals(const View &v1, const View &v2)
+{
+    return (v1.length == v2.length
+        && (v1.s == v2.s || memcmp(v1.s, v2.s, v1.length) == 0));
+}
+
+bool
+core::str::begins(const View &v, const char *prefix)
+{
+    size_t len = strlen(prefix);
+    return (len <= v.length && memcmp(v.s, prefix, len) == 0);
+}
+
+bool
+core::str::ends(const View &v, const char *suffix)
+{
+    size_t len = strlen(suffix);
+    return (len <= v.length && memcmp(v.s + v.length - len, suffix, len) == 0);
+}
+
+int
+core::str::find(const View &v, char c)
+{
+    const char *match = (v.length > 0)
+        ? (const char *)memchr(v.s, c, v.length)
+        : NULL;
+
+    return (match != NULL) ? match - v.s : -1;
+}
+
+int
+core::str::rfind(const View &v, char c)
+{
+    for (size_t i = v.length; i > 0; --i)
+    {
+        if (v.s[i - 1] == c)
+        {
+            return i - 1;
+        }
+    }
+
+    return -1;
+}
+
+unsigned int
+core::str::hash(const View &v)
+{
+    // Must match Config::get_hash()
+    Config::Hash hash = 0x00000000;
+    for (size_t i = 0; i < v.length; ++i)
+    {
+        hash += v.s[i];
+        hash += (hash << 10);
+        hash ^= (hash >> 6);
+    }
+
+    hash += (hash << 3);
+    hash ^= (hash >> 11);
+    hash += (hash << 15);
+
+    return hash;
+}
+
+char *
+core::str::copy(char *buffer, int n, const View &v)
+{
+    if (n > 0)
+    {
+        size_t len = std::min(v.length, (size_t)n - 1);
+        memcpy(buffer, v.s, len);
+        buffer[len] = '\0';
+    }
+
+    return buffer;
+}
+
+char *
+core::str::dup(const View &v)
+{
+    char *s = new char[v.length + 1];
+    memcpy(s, v.s, v.length);
+    s[v.length] = '\0';
+
+    return s;
+}
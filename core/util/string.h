@@ -2,6 +2,7 @@
 #define _CORE_UTIL_STRING_H
 
 #include <cstdarg>
+#include <cstddef>
 #include "config.h"
 
 namespace core
@@ -10,6 +11,16 @@ namespace core
     
     namespace str
     {
+        typedef
+            struct
+            {
+                const char *s; // Not NUL-terminated, NULL for no string
+                size_t      length;
+            }
+            View;
+            // Borrowed range of characters. The View functions below never
+            // allocate, except for dup().
+
         char *
         empty(void);
         // Returns an empty string with enough space reserved for the terminating NULL character only
@@ -36,6 +47,18 @@ namespace core
         vformat(const char *format, va_list args);
         // Modifiers not supported
 
+        int
+        nformat(char *buffer, int n, const char *format, ...);
+        // Formats into buffer, writing at most n characters including the
+        // terminating NULL. Returns the length of the untruncated result.
+
+        int
+        nvformat(char *buffer, int n, const char *format, va_list args);
+
+        char *
+        ncat(char *buffer, int n, const char *s1, const char *s2);
+        // Concats into buffer, truncating to n - 1 characters. Returns buffer.
+
         char *
         cat(char c1, char c2);
 
@@ -223,6 +246,52 @@ namespace core
         char *
         join(const Config *list, const char *delimiter = NULL, bool include_empty = false);
         // Concats all Config string values optionally separated with a delimiter string
+
+        View
+        view(const char *s);
+        // Views the whole string
+
+        View
+        view(const char *start, const char *end);
+        // Views from start up to, but not including, end
+
+        View
+        substring(const View &v, size_t position, size_t length);
+        // Clamped to v
+
+        View
+        trim(View v);
+
+        bool
+        equals(const View &v, const char *s);
+
+        bool
+        equals(const View &v1, const View &v2);
+
+        bool
+        begins(const View &v, const char *prefix);
+
+        bool
+        ends(const View &v, const char *suffix);
+
+        int
+        find(const View &v, char c);
+        // Returns the index of the first c, -1 if not found
+
+        int
+        rfind(const View &v, char c);
+        // Returns the index of the last c, -1 if not found
+
+        unsigned int
+        hash(const View &v);
+        // Same as Config::get_hash() on a NUL-terminated copy
+
+        char *
+        copy(char *buffer, int n, const View &v);
+        // NUL-terminated copy, truncated to n - 1 characters. Returns buffer.
+
+        char *
+        dup(const View &v);
     }
 }
 
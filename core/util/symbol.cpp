@@ -0,0 +1,219 @@
+#include "symbol.h"
+#include "config.h"
+
+#include <cstring> // memcpy, memset, strcmp, strlen
+#include <SDL2/SDL.h>
+
+using namespace core;
+
+#define SYMBOLS_PER_BLOCK 1024
+#define MAX_BLOCKS        1024 // a million symbols
+#define NAME_BLOCK_SIZE   4096
+
+typedef
+    struct
+    {
+        const char   *name;
+        unsigned int  hash;
+    }
+    _Symbol;
+
+/*
+    Symbols live in fixed blocks that never move, so that looking one up by
+    its id needs no lock. Interning probes an open-addressed table of ids on
+    the hash and compares names in full. Names are packed into shared blocks.
+    Zero-initialized, as static symbols may be interned before dynamic
+    initialization.
+*/
+static struct
+{
+    _Symbol      *block[MAX_BLOCKS];
+    unsigned int  count;    // Ids 1 ... count are taken
+
+    symbol::Id   *slot;     // NONE marks an empty slot
+    unsigned int  capacity; // Power of two
+
+    char         *names;    // Tail of the current name block
+    size_t        names_left;
+
+    SDL_SpinLock  lock;
+} _table;
+
+static inline _Symbol &
+_get(symbol::Id id)
+{
+    return _table.block[(id - 1) / SYMBOLS_PER_BLOCK][(id - 1) % SYMBOLS_PER_BLOCK];
+}
+
+static unsigned int
+_find(const char *s, unsigned int hash)
+// Slot holding s, or the empty slot where it would go
+{
+    unsigned int i;
+    for (i = hash & (_table.capacity - 1); _table.slot[i] != symbol::NONE;
+        i = (i + 1) & (_table.capacity - 1))
+    {
+        const _Symbol &symbol = _get(_table.slot[i]);
+        if (symbol.hash == hash && strcmp(symbol.name, s) == 0)
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+static void
+_grow(void)
+{
+    symbol::Id   *old_slot     = _table.slot;
+    unsigned int  old_capacity = _table.capacity;
+
+    _table.capacity = (old_capacity) ? old_capacity * 2 : 1024;
+    _table.slot     = new symbol::Id[_table.capacity];
+    memset(_table.slot, 0, _table.capacity * sizeof(symbol::Id));
+
+    for (unsigned int i = 0; i < old_capacity; ++i)
+    {
+        if (old_slot[i] != symbol::NONE)
+        {
+            unsigned int j = _get(old_slot[i]).hash & (_table.capacity - 1);
+            while (_table.slot[j] != symbol::NONE)
+            {
+                j = (j + 1) & (_table.capacity - 1);
+            }
+            _table.slot[j] = old_slot[i];
+        }
+    }
+
+    delete[] old_slot;
+}
+
+static const char *
+_copy(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *copy;
+    if (len > NAME_BLOCK_SIZE / 4)
+    {
+        copy = new char[len];
+    }
+    else
+    {
+        if (len > _table.names_left)
+        {
+            _table.names      = new char[NAME_BLOCK_SIZE];
+            _table.names_left = NAME_BLOCK_SIZE;
+        }
+        copy = _table.names;
+        _table.names      += len;
+        _table.names_left -= len;
+    }
+    memcpy(copy, s, len);
+
+    return copy;
+}
+
+symbol::Id
+symbol::intern(const char *s)
+{
+    if (s == NULL)
+    {
+        return symbol::NONE;
+    }
+
+    unsigned int hash = Config::get_hash(s);
+
+    SDL_AtomicLock(&_table.lock);
+
+    // Keep the table at most half full
+    if ((_table.count + 1) * 2 > _table.capacity)
+    {
+        _grow();
+    }
+
+    unsigned int i = _find(s, hash);
+    symbol::Id id = _table.slot[i];
+    if (id == symbol::NONE && _table.count < MAX_BLOCKS * SYMBOLS_PER_BLOCK)
+    {
+        id = ++_table.count;
+        if ((id - 1) % SYMBOLS_PER_BLOCK == 0)
+        {
+            _table.block[(id - 1) / SYMBOLS_PER_BLOCK] = new _Symbol[SYMBOLS_PER_BLOCK];
+        }
+
+        _Symbol &symbol = _get(id);
+        symbol.name = _copy(s);
+        symbol.hash = hash;
+
+        _table.slot[i] = id;
+    }
+
+    SDL_AtomicUnlock(&_table.lock);
+
+    return id;
+}
+
+symbol::Id
+symbol::find(const char *s)
+{
+    if (s == NULL)
+    {
+        return symbol::NONE;
+    }
+
+    unsigned int hash = Config::get_hash(s);
+    symbol::Id   id   = symbol::NONE;
+
+    SDL_AtomicLock(&_table.lock);
+    if (_table.capacity)
+    {
+        id = _table.slot[_find(s, hash)];
+    }
+    SDL_AtomicUnlock(&_table.lock);
+
+    return id;
+}
+
+symbol::Id
+symbol::find_hash(unsigned int hash)
+{
+    symbol::Id id = symbol::NONE;
+
+    SDL_AtomicLock(&_table.lock);
+    for (unsigned int i = hash & (_table.capacity - 1);
+        _table.capacity && _table.slot[i] != symbol::NONE;
+        i = (i + 1) & (_table.capacity - 1))
+    {
+        if (_get(_table.slot[i]).hash == hash)
+        {
+            id = _table.slot[i];
+            break;
+        }
+    }
+    SDL_AtomicUnlock(&_table.lock);
+
+    return id;
+}
+
+const char *
+symbol::name(symbol::Id id)
+{
+    return (id != symbol::NONE)
+        ? _get(id).name
+        : NULL;
+}
+
+unsigned int
+symbol::hash(symbol::Id id)
+{
+    return (id != symbol::NONE)
+        ? _get(id).hash
+        : 0;
+}
+
+unsigned int
+symbol::count(void)
+{
+    return _table.count;
+}
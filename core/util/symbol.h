@@ -0,0 +1,60 @@
+/*
+    Symbol table.
+    Interns strings into small integer ids, so that identifiers used over
+    and over (entity tags, sound effects, cache and config keys) are hashed
+    and compared once. Equal strings always get the same id, strings that
+    merely share a hash get different ones. Ids are dense, starting from 1,
+    and stay valid, as do their names, as long as the program runs.
+
+        ------------------------------------------------------------------------
+        static const core::symbol::Id _missile = core::symbol::intern("missile");
+
+        if (entity->has_tag(_missile))
+            core::engine.play_sound(core::symbol::intern("launch"));
+
+        printf("%s\n", core::symbol::name(_missile));
+        ------------------------------------------------------------------------
+
+    All calls are safe from any thread and during static initialization.
+*/
+
+#ifndef _CORE_UTIL_SYMBOL_H
+#define _CORE_UTIL_SYMBOL_H
+
+namespace core
+{
+    namespace symbol
+    {
+        typedef
+            unsigned int
+            Id;
+
+        static const Id
+            NONE = 0;
+
+        Id
+        intern(const char *s);
+        // Returns the id of s, adding it if needed. NONE for NULL.
+
+        Id
+        find(const char *s);
+        // Returns the id of s, NONE if it has never been interned
+
+        Id
+        find_hash(unsigned int hash);
+        // Returns the first symbol interned with the given hash, or NONE
+
+        const char *
+        name(Id id);
+        // NULL for NONE
+
+        unsigned int
+        hash(Id id);
+        // Config::get_hash(name(id)), computed once
+
+        unsigned int
+        count(void);
+    }
+}
+
+#endif
@@ -39,10 +39,10 @@ Entity::Entity(const Entity &entity):
     y(pos.y),
     z(pos.z)
 {
-    core::engine.log("Copying entity #%i (base at %x):", entity.id, &entity);
+    LOG(DEBUG, ENTITY)("Copying entity #%i (base at %x):", entity.id, &entity);
     this->init(static_uniq_id++);
 
-    this->flags          = entity.flags;
+    this->flags          = entity.flags & ~Entity::INTERPOLATE;
     this->conf           = NULL;
 
     this->pos            = entity.pos;
@@ -54,12 +54,12 @@ Entity::Entity(const Entity &entity):
     if (entity.physics != NULL)    this->attach(entity.physics->clone());
     if (entity.graphics != NULL)   this->attach(entity.graphics->clone());
 
-    core::engine.log("Entity #%i copied", entity.id);
+    LOG(DEBUG, ENTITY)("Entity #%i copied", entity.id);
 }
 void
 Entity::init(int id)
 {
-    core::engine.log("Creating entity #%i (base at %x)", id, this);
+    LOG(DEBUG, ENTITY)("Creating entity #%i (base at %x)", id, this);
     this->id_mutable = id;
     this->flags      = Entity::ACTIVE;
     this->conf       = NULL;
@@ -72,12 +72,12 @@ Entity::init(int id)
     this->graphics   = NULL; this->attach(new GraphicsComponent());
     this->physics    = NULL; this->attach(new PhysicsComponent());
 
-    core::engine.log("<(OK)");
+    LOG(DEBUG, ENTITY)("<(OK)");
 }
 
 Entity::~Entity()
 {
-    core::engine.log("Deleting entity #%i (base at %x)", this->id, this);
+    LOG(DEBUG, ENTITY)("Deleting entity #%i (base at %x)", this->id, this);
     
     delete this->activation;
     delete this->ai;
@@ -86,7 +86,7 @@ Entity::~Entity()
 
     delete this->conf;
 
-    core::engine.log("<(OK)");
+    LOG(DEBUG, ENTITY)("<(OK)");
 }
 
 Entity *
@@ -129,7 +129,7 @@ void
 Entity::destroy(void)
 {
     this->flags |= Entity::DELETED;
-    core::engine.log("Requested entity #%i deletion", this->id);
+    LOG(DEBUG, ENTITY)("Requested entity #%i deletion", this->id);
 }
 
 void
@@ -164,25 +164,76 @@ Entity::update(void)
     this->physics->update();
 }
 
+void
+Entity::store_state(void)
+{
+    this->previous.pos = this->pos;
+    this->previous.rot = this->rot;
+    this->flags       |= Entity::INTERPOLATE;
+}
+
+math::Vec3
+Entity::render_pos(void)
+const
+{
+    if (!(this->flags & Entity::INTERPOLATE))
+    {
+        return this->pos;
+    }
+
+    float alpha = core::engine.tick_alpha;
+    return this->previous.pos * (1.0f - alpha) + this->pos * alpha;
+}
+
+math::Quat
+Entity::render_rot(void)
+const
+{
+    if (!(this->flags & Entity::INTERPOLATE))
+    {
+        return this->rot;
+    }
+
+    return math::Quat::lerp(this->previous.rot, this->rot, core::engine.tick_alpha);
+}
+
 void
 Entity::add_tag(const char *tag)
 {
-    core::Config::Hash hash = core::Config::get_hash(tag);
+    this->add_tag(core::symbol::intern(tag));
+}
+
+void
+Entity::remove_tag(const char *tag)
+{
+    this->remove_tag(core::symbol::find(tag));
+}
+
+bool
+Entity::has_tag(const char *tag)
+const
+{
+    // A tag never interned can't have been added
+    return this->has_tag(core::symbol::find(tag));
+}
+
+void
+Entity::add_tag(core::symbol::Id tag)
+{
     TagContainer::iterator t
-        = std::find(this->tags.begin(), this->tags.end(), hash);
+        = std::find(this->tags.begin(), this->tags.end(), tag);
 
     if (t == this->tags.end())
     {
-        this->tags.push_back(hash);
+        this->tags.push_back(tag);
     }
 }
 
 void
-Entity::remove_tag(const char *tag)
+Entity::remove_tag(core::symbol::Id tag)
 {
-    core::Config::Hash hash = core::Config::get_hash(tag);
     TagContainer::iterator t
-        = std::find(this->tags.begin(), this->tags.end(), hash);
+        = std::find(this->tags.begin(), this->tags.end(), tag);
 
     if (t != this->tags.end())
     {
@@ -191,12 +242,12 @@ Entity::remove_tag(const char *tag)
 }
 
 bool
-Entity::has_tag(const char *tag)
+Entity::has_tag(core::symbol::Id tag)
 const
 {
-    core::Config::Hash hash = core::Config::get_hash(tag);
-    return (std::find(this->tags.begin(), this->tags.end(), hash)
-        != this->tags.end());
+    return (tag != core::symbol::NONE
+        && std::find(this->tags.begin(), this->tags.end(), tag)
+            != this->tags.end());
 }
 
 void
@@ -29,11 +29,18 @@ namespace game
             static const Flags
                 ACTIVE      = (0x00000001 << 0),
                 TRANSLUCENT = (0x00000001 << 1),
+                INTERPOLATE = (0x00000001 << 2),
                 DELETED     = (0x00000001 << 31),
 
                 AUTO        = 0;
             
             Flags flags;
+
+            struct
+            {
+                math::Vec3 pos;
+                math::Quat rot;
+            } previous; // State before the latest tick
             
             unsigned long int
                 creation_ticks;
@@ -66,10 +73,27 @@ namespace game
             void
             update(void);
             // Run per-frame tasks
+
+            void
+            store_state(void);
+            // Remember current position and rotation before a tick
+
+            math::Vec3
+            render_pos(void) const;
+            // Position interpolated between the last two ticks
+
+            math::Quat
+            render_rot(void) const;
+            // Rotation interpolated between the last two ticks
         
             void add_tag(const char *tag);
             void remove_tag(const char *tag);
             bool has_tag(const char *tag) const;
+
+            void add_tag(core::symbol::Id tag);
+            void remove_tag(core::symbol::Id tag);
+            bool has_tag(core::symbol::Id tag) const;
+            // Same as above with a pre-interned tag, for checks done every tick
         
             void
             destroy(void);
@@ -83,7 +107,7 @@ namespace game
             core::Config *conf;
             
             typedef
-                std::vector<core::Config::Hash>
+                std::vector<core::symbol::Id>
                 TagContainer;
 
             TagContainer
@@ -10,9 +10,11 @@
 
 using namespace game;
 
+static const core::symbol::Id _launch_sound = core::symbol::intern("launch");
+
 MissileAI::MissileAI()
 {
-    core::engine.play_sound("launch");
+    core::engine.play_sound(_launch_sound);
 }
 
 void
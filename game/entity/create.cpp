@@ -1,7 +1,6 @@
 #include "create.h"
 
 #include "../../core/engine.h"
-#include "../../core/util/string.h"
 #include "../../math/util.h"
 #include "ai/spawner.h"
 #include "physics/dynamic.h"
@@ -11,6 +10,13 @@
 
 using namespace game;
 
+static const core::symbol::Id
+    _splash_sound       = core::symbol::intern("splash"),
+    _explosion_sound[2] = {
+        core::symbol::intern("explosion_0"),
+        core::symbol::intern("explosion_1"),
+    };
+
 Entity *
 game::create::explosion(const math::Vec3 &pos, float strength)
 {
@@ -19,7 +25,7 @@ game::create::explosion(const math::Vec3 &pos, float strength)
     
     if (terrain.height < 1.0f)
     {
-        core::engine.play_sound_at("splash", dist, strength);
+        core::engine.play_sound_at(_splash_sound, dist, strength);
         for (int i = 0; i <= strength * 10; ++i)
         {
             // Smoke
@@ -50,9 +56,8 @@ game::create::explosion(const math::Vec3 &pos, float strength)
         create::fire(pos + math::Vec3(0.0f, 0.0f, 0.0f));
     }
 
-    char *sfx = core::str::format("explosion_%i", (int)math::min((int)dist / 1000, 1));
-    core::engine.play_sound_at(sfx, dist, strength * 40.0f);
-    delete[] sfx;
+    core::engine.play_sound_at(_explosion_sound[(int)math::min((int)dist / 1000, 1)],
+        dist, strength * 40.0f);
     
     // Flash
     Entity *entity = new Entity();
@@ -15,8 +15,8 @@ DynamicGraphics::render(void)
         }
 
         math::Mat4 modelview =
-            (math::Mat4(this->entity->transformation) * this->entity->rot)
-            .translate(this->entity->pos)
+            (math::Mat4(this->entity->transformation) * this->entity->render_rot())
+            .translate(this->entity->render_pos())
             * screen.scene->matrix.camera;
 
         screen.scene->matrix.mv = modelview;
@@ -57,6 +57,14 @@ DynamicGraphics::~DynamicGraphics()
     }
 }
 
+DynamicGraphics *
+DynamicGraphics::clone(void)
+{
+    // Both copies unload the model
+    gfx::Model::acquire(this->model);
+    return new DynamicGraphics(*this);
+}
+
 int
 DynamicGraphics::make_dynamic(const char *mesh_name, int id, bool dynamic)
 {
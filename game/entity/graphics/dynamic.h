@@ -37,7 +37,7 @@ namespace game
             render(void);
             
             virtual DynamicGraphics *
-            clone(void) { return new DynamicGraphics(*this); }
+            clone(void);
 
         protected:
             typedef
@@ -10,8 +10,8 @@ RigidGraphics::render(void)
     if (this->visible)
     {
         screen.scene->matrix.mv =
-            (math::Mat4(this->entity->transformation) * this->entity->rot)
-            .translate(this->entity->pos)
+            (math::Mat4(this->entity->transformation) * this->entity->render_rot())
+            .translate(this->entity->render_pos())
             * screen.scene->matrix.camera;
 
         this->model->render();
@@ -31,3 +31,11 @@ RigidGraphics::~RigidGraphics()
         this->model->unload();
     }
 }
+
+RigidGraphics *
+RigidGraphics::clone(void)
+{
+    // Both copies unload the model
+    gfx::Model::acquire(this->model);
+    return new RigidGraphics(*this);
+}
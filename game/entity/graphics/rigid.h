@@ -16,7 +16,7 @@ namespace game
         render(void);
 
         virtual RigidGraphics *
-        clone(void) { return new RigidGraphics(*this); }
+        clone(void);
     };
 }
 
@@ -7,6 +7,8 @@
 
 using namespace game;
 
+static const core::symbol::Id _crash_sound = core::symbol::intern("wilhelm_scream");
+
 void
 DynamicPhysics::update(void)
 {
@@ -41,7 +43,7 @@ DynamicPhysics::update(void)
         {
             this->entity->y += 2.0f - terrain;
             this->entity->rot = math::Quat::slerp(this->entity->rot, math::Quat::facing(math::Vec3::up()), .5f);
-            core::engine.play_sound("wilhelm_scream");
+            core::engine.play_sound(_crash_sound);
             this->accel *= .8f;
             this->velocity = math::Vec3(
                 this->velocity.x * .5,
@@ -15,10 +15,18 @@ using namespace core;
 #include "terrain.h"
 
 #include "../core/util/string.h"
+#include "../core/util/profiler.h"
 #include "menu.h"
 
 static game::Menu *menu = NULL;
 static game::DynamicGraphics *player_meshes = NULL;
+
+static const symbol::Id
+    _missile_tag  = symbol::intern("missile"),
+    _alert_sound  = symbol::intern("alert"),
+    _select_sound = symbol::intern("select"),
+    _normal_font  = symbol::intern("normal"),
+    _small_font   = symbol::intern("small");
 // static bool sonar = false, old_sonar = false;
 // static unsigned long next_surf = 0;
 // (!) FIXME: find a better way ^
@@ -28,11 +36,13 @@ static game::DynamicGraphics *player_meshes = NULL;
 static void
 _update_mfd(void)
 {
+    PROFILE("_update_mfd");
+
     gfx::Texture *framebuffer = gfx::Texture::framebuffer("MFD");
 
     gfx::Font
-        *header = gfx::Font::get("normal"),
-        *text   = gfx::Font::get("small");
+        *header = gfx::Font::get(_normal_font),
+        *text   = gfx::Font::get(_small_font);
 
     framebuffer->target();
     glClearColor(0.01, 0.02, 0.03, 1.0);
@@ -47,7 +57,7 @@ _update_mfd(void)
         e = screen.scene->entities.begin();
         e != screen.scene->entities.end(); ++e)
     {
-        if (((*e)->flags & game::Entity::ACTIVE) && (*e)->has_tag("missile"))
+        if (((*e)->flags & game::Entity::ACTIVE) && (*e)->has_tag(_missile_tag))
         {
             long dist = (*e)->pos.dist_sq(screen.scene->player->pos);
             if (dist > furthest)
@@ -222,7 +232,7 @@ _update_mfd(void)
 
         if (((screen.scene->frame * 10) % core::engine.frames_per_second) == 0)
         {
-            core::engine.play_sound("alert", 0, .5f);
+            core::engine.play_sound(_alert_sound, 0, .5f);
         }
     }
     
@@ -339,6 +349,27 @@ GameLogic::update_tick(void)
         + 0.000005f * (input[Input::WEAPON_PREV] - input[Input::WEAPON_NEXT]),
         0.00000f, 0.00050f);
     
+    // Fire ze missiles! Fire our shit!
+    // (on ticks, so that recorded flights replay the same salvos)
+    if (input[Input::WEAPON_FIRE1])
+    {
+        static int missile_side = 0;
+        game::Entity *missile = screen.scene->add(new game::Entity());
+        missile->add_tag(_missile_tag);
+        missile->attach(new game::DynamicPhysics());
+        missile->attach(new game::RigidGraphics());
+        missile->attach(new game::MissileAI());
+        missile->attach(new game::TimedDeactivation(10000));
+        missile->graphics->model = gfx::Model::load_async("ordnance/sidewinder/sidewinder.obj");
+        missile->pos = screen.scene->player->pos
+            + math::Vec3(-6.0f + 12.0f * missile_side, -0.5, 2.0f)
+            * (math::Mat4::identity() * screen.scene->player->rot);
+        missile_side = (missile_side + 1) % 2;
+        missile->rot = screen.scene->player->rot;
+        missile->physics->velocity = screen.scene->player->physics->velocity;
+        missile->physics->collision_detection = false; // (!) FIXME
+    }
+
     // Accelerate
     
     screen.scene->player->physics->accel.z
@@ -439,26 +470,6 @@ GameLogic::update_frame()
         &subject = *screen.scene->player;
 
  
-    // Fire ze missiles! Fire our shit!
-    if (input[Input::WEAPON_FIRE1])
-    {
-        static int missile_side = 0;
-        game::Entity *missile = screen.scene->add(new game::Entity());
-        missile->add_tag("missile");
-        missile->attach(new game::DynamicPhysics());
-        missile->attach(new game::RigidGraphics());
-        missile->attach(new game::MissileAI());
-        missile->attach(new game::TimedDeactivation(10000));
-        missile->graphics->model = gfx::Model::load("ordnance/sidewinder/sidewinder.obj");
-        missile->pos = screen.scene->player->pos
-            + math::Vec3(-6.0f + 12.0f * missile_side, -0.5, 2.0f)
-            * (math::Mat4::identity() * screen.scene->player->rot);
-        missile_side = (missile_side + 1) % 2;
-        missile->rot = screen.scene->player->rot;
-        missile->physics->velocity = screen.scene->player->physics->velocity;
-        missile->physics->collision_detection = false; // (!) FIXME
-    }
-
     // Change views (F1 - Fn)
     int old_view = view_index;
     for (int i = 0; i < MAX_VIEWS; ++i)
@@ -489,9 +500,13 @@ GameLogic::update_frame()
     {
         // Center view
         look_offset = math::Vec3();
-        core::engine.play_sound("select", 0, .2f);
+        core::engine.play_sound(_select_sound, 0, .2f);
     }
 
+    // Follow the interpolated pose so the camera stays in sync with rendering
+    math::Vec3 subject_pos = subject.render_pos();
+    math::Quat subject_rot = subject.render_rot();
+
     math::Vec3 v;
     switch (view_index)
     {
@@ -499,12 +514,12 @@ GameLogic::update_frame()
             // Nose camera
             subject.graphics->visible = true;
 
-            camera.pos = subject.pos
+            camera.pos = subject_pos
                 + math::Vec3() * (math::Mat4::identity()
                     .translate(0.0f, 1.5f, subject.graphics->model->radius())
-                    * subject.rot);
+                    * subject_rot);
             camera.rot = math::Quat::rotation_y(-math::PI)
-                    * subject.rot;
+                    * subject_rot;
 
             break;
 
@@ -515,15 +530,15 @@ GameLogic::update_frame()
             
             subject.graphics->visible = false;
             
-            camera.pos = subject.pos
+            camera.pos = subject_pos
                 + math::Vec3() * (math::Mat4::identity()
                     .translate(0.0f, 1.1f, 7.47f) // note: this should the correct cockpit position
-                    * subject.rot);
+                    * subject_rot);
 
             // Rotate with player
             camera.rot.slerp(mouselook
                 * (math::Quat::rotation_y(math::PI)
-                * subject.rot),
+                * subject_rot),
                 .15f);
             
             // Limit view
@@ -537,7 +552,7 @@ GameLogic::update_frame()
 
             camera.rot.slerp(math::Quat::rotation_y(
                     subject.physics->yaw() + math::HALF_PI), .1);
-            camera.pos = subject.pos
+            camera.pos = subject_pos
                 + math::Vec3() * (math::Mat4::identity()
                     .translate(0.0f, 7.5f, subject.graphics->model->radius() + 20.0f)
                     * camera.rot);
@@ -550,7 +565,7 @@ GameLogic::update_frame()
 
             camera.rot = mouselook
                 * math::Quat::rotation_y(5.5f + subject.physics->yaw());
-            camera.pos = subject.pos
+            camera.pos = subject_pos
                 + math::Vec3(0.0f, 6.0f, 40.0f)
                 * camera.rot.mat4();
             break;
@@ -565,7 +580,7 @@ GameLogic::update_frame()
                 * math::Quat::rotation_y(core::engine.ticks / 5000.0f),
                 .05f);
 
-            camera.pos = subject.pos
+            camera.pos = subject_pos
                 + math::Vec3(0.0f, 0.0f, 70.0f)
                 * camera.rot.mat4();
             break;
@@ -578,15 +593,15 @@ GameLogic::update_frame()
             if (view_index != old_view)
             {
                 // Start static camera
-                camera.pos = subject.pos
+                camera.pos = subject_pos
                     + math::Vec3(0.0f, math::vary(-50.0f, 100.0f), 50 + 2 * subject.physics->accel.z)
-                    * subject.rot.mat4().rotY(math::vary(.2f));
+                    * subject_rot.mat4().rotY(math::vary(.2f));
             }
 
             camera.rot.smooth_slerp(
                 -math::Quat::facing(
                     camera.pos,
-                    subject.pos),
+                    subject_pos),
                 .2f
             );
             break;
@@ -601,7 +616,7 @@ GameLogic::update_frame()
             v.normalize();
             v *= 200.0f;
             v.y = 500.0f;
-            camera.pos = subject.pos + v;
+            camera.pos = subject_pos + v;
             camera.rot = math::Quat::rotation_x(math::HALF_PI)
                 * math::Quat::rotation_y(
                     subject.physics->yaw() + math::HALF_PI);
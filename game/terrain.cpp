@@ -5,29 +5,34 @@
 #include "../core/engine.h"
 #include "../core/util/string.h"
 #include "../core/util/file.h"
+#include "../core/util/profiler.h"
 #include "../math/vec4.h"
 #include "../math/util.h"
 #include "../gfx/sprite.h"
 #include "../gfx/3d/scenery/all.h"
 
 #include <cmath>
-#include <cstdlib>   // rand
 #include <algorithm> // min, max
 
+static core::Config::Handle
+    _view_range(core::engine.config, "video/detail/view_range");
+
 using namespace game;
 
 Terrain game::terrain;
 
 Terrain::Terrain():
     w(w_mutable),
-    h(h_mutable)
+    h(h_mutable),
+    seed(seed_mutable)
 {
     this->init();
 }
 
 Terrain::Terrain(const char *filename):
     w(w_mutable),
-    h(h_mutable)
+    h(h_mutable),
+    seed(seed_mutable)
 {
     this->init();
     this->load(filename);
@@ -43,6 +48,7 @@ Terrain::init(void)
     this->music          = NULL;
     this->w_mutable      = 0;
     this->h_mutable      = 0;
+    this->seed_mutable   = 0;
     this->cached_minimap = NULL;
     
     for (int i = 0; i < 4; ++i)
@@ -327,20 +333,16 @@ Terrain::minimap(int w, int h)
 //     core::File *file = new core::File(path);
 //     delete[] path;
 
-//     file->write_magic("rMAP1.0");
+//     file->write_magic("rMAP1.1");
 //     file->write_uint16(this->w);
 //     file->write_uint16(this->h);
 //     file->write_string(this->name);
 //     file->write_string(this->author);
 //     file->write_string(this->music);
 
-//     TerrainNode *end = this->data + this->w * this->h;
-//     for (TerrainNode *c = this->data; c < end; ++c)
-//     {
-//         file->write_float(c->height);
-//         file->write_uint16(c->texture);
-//         file->write_uint16(c->object);
-//     }
+//     // height, vegetation and texture[] of every node in one go
+//     file->write_array(&this->data->height, this->w * this->h,
+//         2 + TerrainNode::TEXTURES, sizeof(TerrainNode));
 
 //     delete file;
 // }
@@ -357,20 +359,15 @@ Terrain::minimap(int w, int h)
 //         throw 666;
 //     }
 
-//     file->test_magic("rMAP1.0");
+//     file->test_magic("rMAP1.1");
 //     this->resize(file->read_uint16(), file->read_uint16());
 
 //     core::str::set(this->name, file->read_string());
 //     core::str::set(this->author, file->read_string());
 //     core::str::set(this->music, file->read_string());
 
-//     TerrainNode *end = this->data + this->w * this->h;
-//     for (TerrainNode *c = this->data; c < end; ++c)
-//     {
-//         c->height  = file->read_float();
-//         c->texture = file->read_uint16();
-//         c->object  = file->read_uint16();
-//     }
+//     file->read_array(&this->data->height, this->w * this->h,
+//         2 + TerrainNode::TEXTURES, sizeof(TerrainNode));
 
 //     delete file;
 // }
@@ -422,6 +419,24 @@ Terrain::at(float x, float z)
     return result;
 }
 
+typedef
+    struct
+    {
+        const char  *path[6];
+        gfx::Sprite *sprite[6];
+    }
+    _SpriteBatch;
+
+static void
+_load_sprites(int first, int last, void *data)
+{
+    _SpriteBatch *batch = (_SpriteBatch *)data;
+    for (int i = first; i < last; ++i)
+    {
+        batch->sprite[i] = new gfx::Sprite(batch->path[i]);
+    }
+}
+
 void
 Terrain::load(const char *filename)
 {
@@ -438,9 +453,48 @@ Terrain::load(const char *filename)
         *heightmap_path  = core::str::format("%s/terrain.%s", dir, ext),
         *vegetation_path = core::str::format("%s/vegetation.%s", dir, ext);
 
+    static const char *tileset[] = {
+        // Surface terrain textures
+        "video/textures/city.jpg",
+        "video/textures/field_3.jpg",
+        "video/textures/forest.jpg",
+        "video/textures/grey_stone4-512x512.jpg"
+    };
+
+    _SpriteBatch batch;
+    batch.path[0] = heightmap_path;
+    batch.path[1] = vegetation_path;
+
+    int  files        = 2;
+    bool load_tileset = (this->material.shader == NULL);
+    if (load_tileset)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            this->texture[i].name
+                = core::str::cat(DATA_DIRECTORY, tileset[i]);
+
+            core::str::set(this->texture[i].name,
+                core::str::normalize_path(this->texture[i].name));
+
+            batch.path[files++] = this->texture[i].name;
+        }
+    }
+
+    // Decode all images at once on the workers, uploads stay on this thread
+    core::engine.parallel_for(files, _load_sprites, &batch);
+
     gfx::Sprite
-        *heightmap     = new gfx::Sprite(heightmap_path),
-        *vegetation    = new gfx::Sprite(vegetation_path);
+        *heightmap     = batch.sprite[0],
+        *vegetation    = batch.sprite[1];
+
+    if (load_tileset)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            this->texture[i].image = batch.sprite[2 + i];
+        }
+    }
     
     if (heightmap->data == NULL)
     {
@@ -532,31 +586,14 @@ Terrain::load(const char *filename)
             }
         }
 
-        if (this->material.shader == NULL)
+        if (load_tileset)
         {
             this->material.shader
                 = gfx::Program::get("terrain", "terrain fog");
 
-            static const char *tileset[] = {
-                // Surface terrain textures
-                "video/textures/city.jpg",
-                "video/textures/field_3.jpg",
-                "video/textures/forest.jpg",
-                "video/textures/grey_stone4-512x512.jpg"
-            };
-
             for (int i = 0; i < 4; ++i)
             {
                 core::engine.log("Loading %s", tileset[i]);
-                this->texture[i].name
-                    = core::str::cat(DATA_DIRECTORY, tileset[i]);
-                
-                core::str::set(this->texture[i].name,
-                    core::str::normalize_path(this->texture[i].name));
-
-                this->texture[i].image
-                    = new gfx::Sprite(this->texture[i].name);
-                    
                 if (this->texture[i].image->data == NULL)
                 {
                     core::engine.log(
@@ -584,6 +621,7 @@ Terrain::load(const char *filename)
     delete heightmap;
     delete vegetation;
     
+    this->seed_mutable = math::Random::local().next();
     this->preload_props();
 }
 
@@ -606,20 +644,27 @@ Terrain::preload_props(void)
 {
     using namespace gfx::scenery;
     
-    int seed = rand();
+    // The generators draw from this thread's generator, which is set to
+    // the same stream before each detail level so that they only differ
+    // in detail, and put back afterwards
+    math::Random &random = math::Random::local();
+    unsigned int  seed   = random.next();
+    math::Random  saved  = random;
+    math::Random  styles(seed);
     
     core::engine.log("Generating scenery prop models");
     for (int i = 0; i < 15; ++i)
     {
         PropType    type;
-        char        style = 'a' + math::rnd(5);
+        char        style = 'a' + math::rnd(styles, 5);
         math::Vec3  size;
         int         wings;
         gfx::Model *roof;
         
         for (int t = 0; t < 3; ++t)
         {
-            srand(seed);
+            math::Random stream(seed, i, t);
+            random = stream;
             switch (t)
             {
                 case 0:
@@ -670,21 +715,21 @@ Terrain::preload_props(void)
                     building::roof::flat(style), style, 0.0f));
 
             // medium detail
-            srand(seed);
+            random = stream;
             this->prop_models[type].push_back(
                 building::house(size, wings,
                     building::roof::pyramid(style), style, 0.0f));
             
             // best detail
-            srand(seed);
+            random = stream;
             this->prop_models[type].push_back(
                 building::house(size, wings, roof, style));
-            
-            seed++;
         }
     }
     
-    srand(time(NULL));
+    // Carry on as if only the seed was drawn, so recorded runs stay
+    // reproducible
+    random = saved;
 
     // this->prop_models[TREE].push_back(tree::stump(5.0f));
     // this->prop_models[TREE].push_back(tree::stump(5.0f));
@@ -702,14 +747,14 @@ Terrain::preload_props(void)
 }
 
 bool
-Terrain::get_prop(gfx::Model **dst, PropType type)
+Terrain::get_prop(gfx::Model **dst, PropType type, math::Random &random)
 {
     if (this->prop_models[type].empty())
     {
         return false;
     }
     
-    int src = rand() % this->prop_models[type].size();
+    int src = random.next() % this->prop_models[type].size();
     src = (int)(src / TerrainChunk::LOD_LEVELS) * TerrainChunk::LOD_LEVELS;
     
     for (int i = 0; i < TerrainChunk::LOD_LEVELS; ++i)
@@ -822,6 +867,8 @@ Terrain::is_cached(int x, int z)
 void
 Terrain::render(void)
 {
+    PROFILE("Terrain::render");
+
     math::Vec3 camera(screen.scene->matrix.camera.inverse());
     
     float offset_x = fmod(camera.x, TerrainChunk::SIZE) / TerrainChunk::SIZE;
@@ -830,9 +877,7 @@ Terrain::render(void)
     math::Mat4 mv = screen.scene->matrix.camera
         * screen.scene->matrix.projection;
     
-    int visible_chunks = core::engine.config
-        ["video"]["detail"]["view_range"]
-        .integer(6000) / TerrainChunk::SIZE;
+    int visible_chunks = _view_range.integer(6000) / TerrainChunk::SIZE;
 
     for (int grid_z = -visible_chunks; grid_z <= visible_chunks; ++grid_z)
     {
@@ -7,6 +7,7 @@
 #include "../gfx/3d/material.h"
 #include "../gfx/3d/texture.h"
 #include "../gfx/sprite.h"
+#include "../math/random.h"
 
 #include <vector>
 
@@ -25,6 +26,7 @@ namespace game
             BUILDING_STEM  = 5; // extra floors generated for buildings to account for possibly sloping terrain
         
         const int &w, &h;
+        const unsigned int &seed; // Chunks draw from streams keyed off this
         char *name;
         char *author;
         char *music;
@@ -114,7 +116,7 @@ namespace game
             PropType;
         
         bool
-        get_prop(gfx::Model **dst, PropType type);
+        get_prop(gfx::Model **dst, PropType type, math::Random &random);
         // Returns an array of models, from lowest to highest LOD level
         // Returns false if no models of that type are cached
 
@@ -122,6 +124,9 @@ namespace game
         int
             w_mutable,
             h_mutable;
+
+        unsigned int
+            seed_mutable;
         
         TerrainNode
             *data;
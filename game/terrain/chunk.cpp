@@ -9,11 +9,16 @@
 #include "../../math/vec3.h"
 #include "../../core/engine.h"
 #include "../../core/util/string.h"
+#include "../../core/util/profiler.h"
 #include "../../math/util.h"
 
-#include <cstdlib> // rand
 #include <cmath>   // sqrt
 
+static core::Config::Handle
+    _terrain_detail(core::engine.config, "video/detail/terrain"),
+    _city_detail(core::engine.config, "video/detail/cities"),
+    _vegetation_detail(core::engine.config, "video/detail/vegetation");
+
 using namespace game;
 
 static int
@@ -77,6 +82,10 @@ TerrainChunk::~TerrainChunk()
 
     for (int lod = 0; lod < TerrainChunk::VEGETATION_LOD; ++lod)
     {
+        if (this->trees[lod] != NULL)
+        {
+            gfx::Material::release(this->trees[lod]->material);
+        }
         delete this->trees[lod];
     }
     
@@ -94,10 +103,12 @@ TerrainChunk::Prop::Prop()
 void
 TerrainChunk::generate(int x, int z)
 {
+    PROFILE("TerrainChunk::generate");
+
     delete this->mesh;
     this->mesh = new gfx::Mesh();
     
-    int subdiv = core::engine.config["video"]["detail"]["terrain"].integer(5);
+    int subdiv = _terrain_detail.integer(5);
     int cells  = subdiv * subdiv;
     this->mesh->vertices.reserve(cells * 4);
     this->mesh->indices.reserve(cells * 6);
@@ -173,10 +184,14 @@ TerrainChunk::generate(int x, int z)
         v->uv = math::Vec2(v->pos.x, v->pos.z) * .005f;
     }
 
-    for (int prop_count = core::engine.config["video"]["detail"]["cities"].integer(50); prop_count > 0; --prop_count)
+    // The same chunk gets the same props, whenever and on whichever
+    // thread it is generated
+    math::Random random(game::terrain.seed, x, z);
+
+    for (int prop_count = _city_detail.integer(50); prop_count > 0; --prop_count)
     {
-        math::Vec3 pos(x + rand() % TerrainChunk::SIZE, 0.0f,
-            z + rand() % TerrainChunk::SIZE);
+        math::Vec3 pos(x + (int)(random.next() % TerrainChunk::SIZE), 0.0f,
+            z + (int)(random.next() % TerrainChunk::SIZE));
 
         game::TerrainNode node = game::terrain.at(pos);
         pos.y = node.height;
@@ -191,20 +206,21 @@ TerrainChunk::generate(int x, int z)
         else if (node.vegetation < .1f)
         {
             
-            if (node.vegetation || node.height > 80.0f || math::probability(.3f))
+            if (node.vegetation || node.height > 80.0f || math::probability(random, .3f))
             {
-                if (math::probability(.8f + .0003f * node.height))
+                if (math::probability(random, .8f + .0003f * node.height))
                 {
                     continue;
                 }
-                exists = game::terrain.get_prop(model, Terrain::HOUSE);
+                exists = game::terrain.get_prop(model, Terrain::HOUSE, random);
             }
             else
             {
                 exists = game::terrain.get_prop(model,
-                    (math::probability(.05f))
+                    (math::probability(random, .05f))
                         ? Terrain::HIGHRISE
-                        : Terrain::TOWNHOUSE);
+                        : Terrain::TOWNHOUSE,
+                    random);
             }
             
             pos.y -= Terrain::BUILDING_STEM * 3.2f;
@@ -242,7 +258,7 @@ TerrainChunk::generate(int x, int z)
         float radius = sqrt(size.x * size.x + size.z * size.z);
         
         prop->transformation = math::Mat4::identity()
-            .rotY(math::rnd(math::PI))
+            .rotY(math::rnd(random, math::PI))
             .translate(pos.x, pos.y, pos.z);
         
         prop->scaled = math::Mat4::scaling(radius, size.y, radius)
@@ -262,13 +278,18 @@ TerrainChunk::generate_forest(int x, int z)
 {
     for (int lod = 0; lod < TerrainChunk::VEGETATION_LOD; ++lod)
     {
+        if (this->trees[lod] != NULL)
+        {
+            gfx::Material::release(this->trees[lod]->material);
+        }
         delete this->trees[lod];
         this->trees[lod] = NULL;
         
+        // Apart from the props' stream and from the other levels
+        math::Random random = math::Random(game::terrain.seed, x, z).split(lod);
+        
         int
-            trees = (lod + 1) * core::engine.config
-                ["video"]["detail"]["vegetation"]
-                .integer(128),
+            trees = (lod + 1) * _vegetation_detail.integer(128),
             total = 0;
         
         GLuint
@@ -280,17 +301,17 @@ TerrainChunk::generate_forest(int x, int z)
         
         while (trees-- > 0)
         {
-            math::Vec3 v(x + rand() % TerrainChunk::SIZE, 0.0f,
-                z + rand() % TerrainChunk::SIZE);
+            math::Vec3 v(x + (int)(random.next() % TerrainChunk::SIZE), 0.0f,
+                z + (int)(random.next() % TerrainChunk::SIZE));
             
             float
-                height = math::rnd(10, 20),
+                height = math::rnd(random, 10, 20),
                 radius = height / 2.0f;
 
             game::TerrainNode node = game::terrain.at(v);
             v.y = node.height;
             
-            if (v.y < 10.0f || math::probability(1.0f - node.vegetation))
+            if (v.y < 10.0f || math::probability(random, 1.0f - node.vegetation))
             {
                 continue;
             }
@@ -298,11 +319,11 @@ TerrainChunk::generate_forest(int x, int z)
             radius *= 1.0f + node.vegetation;
             
             float
-                left_edge = .25f * (int)math::rnd(4),
+                left_edge = .25f * (int)math::rnd(random, 4),
                 right_edge = left_edge + .25f;
             
             float
-                a = math::rnd(math::HALF_PI),
+                a = math::rnd(random, math::HALF_PI),
                 w = cos(a) * radius,
                 h = sin(a) * radius;
             
@@ -355,13 +376,13 @@ TerrainChunk::generate_forest(int x, int z)
         {
             gfx::Mesh *mesh = new gfx::Mesh();
             
-            const char *texture = (math::probability(.5f))
+            const char *texture = (math::probability(random, .5f))
                 ? "video/textures/scenery/trees/deciduous.png"
                 : "video/textures/scenery/trees/coniferous.png";
 
             mesh->material            = gfx::Material::add(texture);
             mesh->material->shader    = gfx::Program::get("forest", "forest");
-            mesh->material->color_map = gfx::Texture::get(texture);
+            mesh->material->color_map = gfx::Texture::get_async(texture);
 
             glGenBuffers(1, &mesh->attr.index);
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->attr.index);
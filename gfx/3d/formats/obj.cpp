@@ -12,89 +12,121 @@
 using namespace gfx;
 using namespace core::str;
 
-class OBJ_File:
-    public core::File
+class OBJ_File
 {
 public:
     // Property name (v, usemtl, map_Kd, ...)
-    char * const &property;
+    const core::TextReader::Token &property;
     
-    // Parameters as a single string
-    char * const &value;
+    // Parameters as a single token
+    const core::TextReader::Token &parameters;
     
     // Float vector containing up to 3 float parameters
     const math::Vec3 &vector;
 
     OBJ_File(const char *filename) :
-        core::File(filename),
         property(property_mutable),
-        value(value_mutable),
-        vector(vector_mutable)
+        parameters(parameters_mutable),
+        vector(vector_mutable),
+        file(filename),
+        text(&file)
     {
-        this->property_mutable = NULL;
+        this->property_mutable.s   = NULL;
+        this->parameters_mutable.s = NULL;
+        this->value_mutable        = NULL;
     }
     
     ~OBJ_File()
     {
-        delete[] this->property_mutable;
+        delete[] this->value_mutable;
+    }
+    
+    bool
+    exists(void)
+    {
+        return this->file.exists();
     }
     
     bool
     operator==(const char *s)
     {
-        return (cmp(this->property, s) == 0);
+        return core::TextReader::equals(this->property, s);
+    }
+    
+    const char *
+    value(void)
+    // Parameters as a string, valid until the next line
+    {
+        if (this->value_mutable == NULL)
+        {
+            this->value_mutable = core::TextReader::dup(this->parameters);
+        }
+        
+        return this->value_mutable;
     }
     
     bool
     get_line(void)
     // Get the next meaningful line or return false
     {
+        core::TextReader::Token line;
+        
+        set(this->value_mutable, NULL);
         for (;;)
         {
-            if (this->eof())
+            if (!this->text.next_line(&line))
             {
-                core::str::empty(this->property_mutable);
+                this->property_mutable.s        = NULL;
+                this->property_mutable.length   = 0;
+                this->parameters_mutable.s      = NULL;
+                this->parameters_mutable.length = 0;
                 return false;
             }
             
-            char *s = this->read();
-            set(this->property_mutable, ltrim(s));
-            this->value_mutable = find(this->property, ' ');
-
             // Skip comments and lines with no parameters
-            if (*this->property != '#' && this->value != NULL)
+            if (core::TextReader::next_token(&line, &this->property_mutable)
+                && *this->property.s != '#')
             {
-                break;
+                this->parameters_mutable = core::TextReader::trim(line);
+                if (this->parameters.length > 0)
+                {
+                    break;
+                }
             }
         }
 
-        // NULL-terminate property name
-        *this->value_mutable = '\0';
-        
-        // Move value pointer to the beginning of the actual data
-        this->value_mutable  = ltrim(this->value + 1);
-        
-        if (is_numeric(*this->value))
+        if (is_numeric(*this->parameters.s))
         {
             // Update the float vector for convenience
-            sscanf(this->value, "%f %f %f",
+            core::TextReader::Token rest = this->parameters, n;
+            float *v[] = {
                 &this->vector_mutable.x,
                 &this->vector_mutable.y,
                 &this->vector_mutable.z
-            );
+            };
+            
+            for (int i = 0; i < 3; ++i)
+            {
+                *v[i] = (core::TextReader::next_token(&rest, &n))
+                    ? (float)core::TextReader::to_number(n)
+                    : 0.0f;
+            }
         }
 
         return true;
     }
 
 protected:
-    char *property_mutable;
+    core::File       file;
+    core::TextReader text;
+    
+    core::TextReader::Token property_mutable, parameters_mutable;
     char *value_mutable;
     math::Vec3 vector_mutable;
 };
 
 Model *
-io::load_OBJ(const char *filename)
+io::load_OBJ(const char *filename, bool defer_upload)
 {
     typedef
         std::vector<math::Vec3>
@@ -116,6 +148,10 @@ io::load_OBJ(const char *filename)
     char  *name         = empty();
     char  *mtllib       = empty();
     int    index_offset = 0;
+
+    // Held until the end, so that the cache can't evict them before
+    // a usemtl line gets to them
+    std::vector<Material *> materials;
     
     IndBuf *face[3] = { &vertex.i, &uv.i, &normal.i };
 #   define VERTEX_BUFFER_SIZE 5000
@@ -148,7 +184,7 @@ io::load_OBJ(const char *filename)
         if (obj == "o" || last_line)
         {
             set(mesh->name, name);
-            name = dup(obj.value);
+            name = dup(obj.value());
 
             form_mesh = true;
         }
@@ -157,16 +193,17 @@ io::load_OBJ(const char *filename)
         else if (obj == "mtllib")
         {
             // Load from relative path
-            set(mtllib, cat(path, obj.value));
+            set(mtllib, cat(path, obj.value()));
             set(mtllib, normalize_path(mtllib));
             // (!) FIXME: TODO: cache mtl files
-            Material::load(mtllib);
+            io::load_MTL(mtllib, defer_upload, &materials);
         }
 
         // Switch material (+ begin next mesh)
         else if (obj == "usemtl")
         {
-            char *s = cat(mtllib, obj.value);
+            char *s = cat(mtllib, obj.value());
+            Material::release(mesh->material);
             mesh->material = Material::get(s);
             delete[] s;
             
@@ -200,15 +237,24 @@ io::load_OBJ(const char *filename)
             // delete[] data;
             
             // TODO: Triangulate
-            core::Config *token = split(replace(obj.value, ' ', '/'), '/', true);
-            if (token->count() == 9)
+            // Triangles as v/vt/vn, vt and vn may be left empty
+            core::TextReader::Token rest = obj.parameters, corner, index;
+            int indices[10], n = 0;
+            while (n < 10 && core::TextReader::next_token(&rest, &corner))
+            {
+                while (n < 10 && core::TextReader::next_field(&corner, &index, '/'))
+                {
+                    indices[n++] = (int)core::TextReader::to_number(index) - 1;
+                }
+            }
+            
+            if (n == 9)
             {
                 for (int i = 0; i < 9; ++i)
                 {
-                    face[i % 3]->push_back((*token)[i].integer() - 1);
+                    face[i % 3]->push_back(indices[i]);
                 }
             }
-            delete token;
         }
         
         // Vertex attributes
@@ -266,10 +312,17 @@ i = mesh->vertices.end();
                 }
             }
             
+            // Every mesh holds a reference to its material,
+            // an empty one hands its own over to the next
+            Material *material = mesh->material;
             if (mesh->indices.size() > 0)
             {
-                mesh->compose();
+                if (!defer_upload)
+                {
+                    mesh->compose();
+                }
                 model->add(mesh);
+                Material::acquire(material);
             }
             else
             {
@@ -278,16 +331,22 @@ i = mesh->vertices.end();
             
             if (last_line)
             {
+                Material::release(material);
                 break;
             }
 
-            Material *material = mesh->material;
             mesh               = new Mesh();
             mesh->material     = material;
             index_offset       = vertex.i.size();
         }
     }
     core::engine.log("%s ready", filename);
+
+    for (std::vector<Material *>::const_iterator material = materials.begin();
+        material != materials.end(); ++material)
+    {
+        Material::release(*material);
+    }
     
     delete[] path;
     delete[] name;
@@ -296,13 +355,49 @@ i = mesh->vertices.end();
     return model;
 }
 
+static void
+_hand_over(Material *material, std::vector<Material *> *materials)
+{
+    if (materials == NULL)
+    {
+        Material::release(material);
+    }
+    else if (material != NULL)
+    {
+        materials->push_back(material);
+    }
+}
+
+static void
+_publish(Material *&material, char *&name, bool defer_upload, std::vector<Material *> *materials)
+{
+    if (material != NULL)
+    {
+        if (!defer_upload)
+        {
+            material->compose();
+        }
+        _hand_over(Material::store(name, material), materials);
+    }
+
+    material = NULL;
+    set(name, NULL);
+}
+
 int
-io::load_MTL(const char *filename)
+io::load_MTL(const char *filename, bool defer_upload, std::vector<Material *> *materials)
 {
+    Texture *(*get_texture)(const char *, Texture::Flags, int) = (defer_upload)
+        ? Texture::get_async
+        : Texture::get;
+    
+
     int materials_loaded = 0;
     
-    // Dummy material to hold potential illegal values
-    gfx::Material *material;
+    // Built privately and only cached once complete, as whatever is
+    // cached may already be in use on the main thread
+    gfx::Material *material = NULL;
+    char          *name     = NULL;
     
     core::engine.log("Loading mtllib %s", filename);
 
@@ -314,127 +409,159 @@ io::load_MTL(const char *filename)
     
     char *path = core::str::get_directory(filename);
     
-    while (mtl.get_line())
+    try
     {
+        while (mtl.get_line())
+        {
+            if (mtl == "newmtl")
+            { // New material
+                _publish(material, name, defer_upload, materials);
+
+                bool loading;
+                char *s = cat(filename, mtl.value());
+                Material *cached = Material::reserve(s, &loading);
+                if (loading)
+                {
+                    material = new Material();
+                    name     = s;
+                    materials_loaded++;
+                }
+                else
+                {
+                    _hand_over(cached, materials);
+                    delete[] s;
+                }
+            }
 
-        if (mtl == "newmtl")
-        { // New material
-            if (materials_loaded)
+            // Already cached, or no newmtl yet
+            else if (material == NULL)
             {
-                material->compose();
+                continue;
             }
-            char *s  = cat(filename, mtl.value);
-            material = Material::add(s);
-            materials_loaded++;
-            delete[] s;
-        }
         
-        // Transparency and reflections
-        else if (mtl == "d")
-        { // Dissolution
-            material->transparency = true;
-            material->alpha        = mtl.vector.x;
-        }
-        else if (mtl == "Tr")
-        { // Transparency
-            material->transparency = true;
-            material->alpha        = 1.0f - mtl.vector.x;
-        }
-        else if (mtl == "Ni")
-        { // Refractive index
-            material->refractions      = true;
-            material->refractive_index = mtl.vector.x;
-        }
-        else if (mtl == "illum")
-        { // Illumination model (used to turn reflections on and off)
-            switch ((int)mtl.vector.x)
-            {
-                case 3:
-                case 8:
-                case 9:
-                    material->reflections = true;
-                    break;
+            // Transparency and reflections
+            else if (mtl == "d")
+            { // Dissolution
+                material->transparency = true;
+                material->alpha        = mtl.vector.x;
+            }
+            else if (mtl == "Tr")
+            { // Transparency
+                material->transparency = true;
+                material->alpha        = 1.0f - mtl.vector.x;
+            }
+            else if (mtl == "Ni")
+            { // Refractive index
+                material->refractions      = true;
+                material->refractive_index = mtl.vector.x;
+            }
+            else if (mtl == "illum")
+            { // Illumination model (used to turn reflections on and off)
+                switch ((int)mtl.vector.x)
+                {
+                    case 3:
+                    case 8:
+                    case 9:
+                        material->reflections = true;
+                        break;
                 
-                default:
-                    material->reflections = false;
-                    break;
+                    default:
+                        material->reflections = false;
+                        break;
+                }
             }
-        }
         
-        // Colors
-        else if (mtl == "Ka")
-        { // Ambient color
-            material->ambient_color = mtl.vector;
-        }
-        else if (mtl == "Kd")
-        { // Diffuse color
-            material->diffuse_color = mtl.vector;
-        }
-        else if (mtl == "Ks")
-        { // Specular color
-            material->specular_color = mtl.vector;
-        }
-        else if (mtl == "Ns")
-        { // Specular exponent
-            material->specular_exponent = mtl.vector.x;
-            continue;
-        }
+            // Colors
+            else if (mtl == "Ka")
+            { // Ambient color
+                material->ambient_color = mtl.vector;
+            }
+            else if (mtl == "Kd")
+            { // Diffuse color
+                material->diffuse_color = mtl.vector;
+            }
+            else if (mtl == "Ks")
+            { // Specular color
+                material->specular_color = mtl.vector;
+            }
+            else if (mtl == "Ns")
+            { // Specular exponent
+                material->specular_exponent = mtl.vector.x;
+                continue;
+            }
         
-        // Textures
-        else if (mtl == "map_Kd")
-        { // Diffuse texture
-            char *s = cat(path, mtl.value);
-            material->color_map = Texture::get(s, Texture::AUTO, 0);
-            delete[] s;
-            continue;
-        }
-        else if (mtl == "bump" || mtl == "map_Bump")
-        { // Bumpmap texture
-            char *s = cat(path, mtl.value);
-            material->bump_map = Texture::get(s, Texture::AUTO, 1);
-            delete[] s;
-            continue;
-        }
-        else if (mtl == "norm" || mtl == "map_Norm")
-        { // Normal map
-            char *s = cat(path, mtl.value);
-            material->normal_map = Texture::get(s, Texture::AUTO, 2);
-            delete[] s;
-            continue;
-        }
-        else if (mtl == "map_Ks")
-        { // Specular texture
-            char *s = cat(path, mtl.value);
-            material->specular_map = Texture::get(s, Texture::AUTO, 3);
-            delete[] s;
-            continue;
-        }
-        else if (mtl == "decal" || mtl == "map_Decal")
-        { // Stencil texture
-            char *s = cat(path, mtl.value);
-            material->decal_map = Texture::get(s, Texture::AUTO, 4);
-            delete[] s;
-            continue;
+            // Textures
+            else if (mtl == "map_Kd")
+            { // Diffuse texture
+                char *s = cat(path, mtl.value());
+                Texture::release(material->color_map);
+                material->color_map = get_texture(s, Texture::AUTO, 0);
+                delete[] s;
+                continue;
+            }
+            else if (mtl == "bump" || mtl == "map_Bump")
+            { // Bumpmap texture
+                char *s = cat(path, mtl.value());
+                Texture::release(material->bump_map);
+                material->bump_map = get_texture(s, Texture::AUTO, 1);
+                delete[] s;
+                continue;
+            }
+            else if (mtl == "norm" || mtl == "map_Norm")
+            { // Normal map
+                char *s = cat(path, mtl.value());
+                Texture::release(material->normal_map);
+                material->normal_map = get_texture(s, Texture::AUTO, 2);
+                delete[] s;
+                continue;
+            }
+            else if (mtl == "map_Ks")
+            { // Specular texture
+                char *s = cat(path, mtl.value());
+                Texture::release(material->specular_map);
+                material->specular_map = get_texture(s, Texture::AUTO, 3);
+                delete[] s;
+                continue;
+            }
+            else if (mtl == "decal" || mtl == "map_Decal")
+            { // Stencil texture
+                char *s = cat(path, mtl.value());
+                Texture::release(material->decal_map);
+                material->decal_map = get_texture(s, Texture::AUTO, 4);
+                delete[] s;
+                continue;
+            }
+            else if (mtl == "ao" || mtl == "map_Ao")
+            { // Ambient occlusion texture
+                char *s = cat(path, mtl.value());
+                Texture::release(material->ambient_occlusion_map);
+                material->ambient_occlusion_map = get_texture(s, Texture::AUTO, 5);
+                delete[] s;
+                continue;
+            }
         }
-        else if (mtl == "ao" || mtl == "map_Ao")
-        { // Ambient occlusion texture
-            char *s = cat(path, mtl.value);
-            material->ambient_occlusion_map = Texture::get(s, Texture::AUTO, 5);
-            delete[] s;
-            continue;
+    }
+    catch (...)
+    {
+        // Others asking for the material would wait on it forever
+        if (material != NULL)
+        {
+            Material::drop(name);
+            delete material;
+            delete[] name;
         }
+        delete[] path;
+        throw;
     }
     
     delete[] path;
 
-    if (materials_loaded)
-    {
-        material->compose();
-    }
+    _publish(material, name, defer_upload, materials);
+
     core::engine.log(
         (materials_loaded == 1)
-            ? "%i material found"
-            : "%i materials found",
+            ? "%i new material found"
+            : "%i new materials found",
         materials_loaded);
 
     return materials_loaded;
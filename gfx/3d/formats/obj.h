@@ -3,15 +3,25 @@
 
 #include "../model.h"
 
+#include <vector>
+
 namespace gfx
 {
     namespace io
     {
         Model *
-        load_OBJ(const char *filename);
+        load_OBJ(const char *filename, bool defer_upload = false);
+        // With defer_upload, nothing touches the GL context: textures load
+        // asynchronously and meshes and materials are left for the caller
+        // to compose. Safe on worker threads then.
         
         int
-        load_MTL(const char *filename);
+        load_MTL(const char *filename, bool defer_upload = false,
+            std::vector<Material *> *materials = NULL);
+        // Returns the number of new materials cached, those already cached
+        // are left as they are. If materials is given, every material of
+        // the file is appended to it with a reference held for the caller
+        // to release, otherwise they may be evicted right away.
     }
 }
 
@@ -52,12 +52,13 @@ Material::Material(const Material &material) :
     this->refractive_index      = material.refractive_index;
     this->alpha                 = material.alpha;
             
-    this->color_map             = material.color_map;
-    this->bump_map              = material.bump_map;
-    this->normal_map            = material.normal_map;
-    this->specular_map          = material.specular_map;
-    this->decal_map             = material.decal_map;
-    this->ambient_occlusion_map = material.ambient_occlusion_map;
+    // Each copy holds its own texture references
+    this->color_map             = Texture::acquire(material.color_map);
+    this->bump_map              = Texture::acquire(material.bump_map);
+    this->normal_map            = Texture::acquire(material.normal_map);
+    this->specular_map          = Texture::acquire(material.specular_map);
+    this->decal_map             = Texture::acquire(material.decal_map);
+    this->ambient_occlusion_map = Texture::acquire(material.ambient_occlusion_map);
             
     this->transparency          = material.transparency;
     this->reflections           = material.reflections;
@@ -69,6 +70,15 @@ Material::Material(const Material &material) :
 
 Material::~Material()
 {
+    global_cache.drop(this, false);
+
+    Texture::release(this->color_map);
+    Texture::release(this->bump_map);
+    Texture::release(this->normal_map);
+    Texture::release(this->specular_map);
+    Texture::release(this->decal_map);
+    Texture::release(this->ambient_occlusion_map);
+
     delete[] this->name_mutable;
 }
 
@@ -147,9 +157,9 @@ Material::use(void)
 }
 
 int
-Material::load(const char *filename)
+Material::load(const char *filename, bool defer_upload)
 {
-    return io::load_MTL(filename);
+    return io::load_MTL(filename, defer_upload);
 }
 
 void
@@ -257,15 +267,34 @@ Material::compose(Flags flags)
 Material *
 Material::add(const char *name)
 {
-    if (global_cache.contains(name))
+    bool loading;
+    Material *material = Material::reserve(name, &loading);
+    if (!loading)
     {
-        return global_cache[name];
+        return material;
     }
 
-    Material *material = new Material();
+    return Material::store(name, new Material());
+}
+
+Material *
+Material::reserve(const char *name, bool *loading)
+{
+    return global_cache.reserve(name, loading);
+}
+
+Material *
+Material::store(const char *name, Material *material)
+{
     core::str::set(material->name_mutable, core::str::dup(name));
 
-    return global_cache.store(name, material);
+    return global_cache.store(name, material, sizeof(Material));
+}
+
+void
+Material::drop(const char *name)
+{
+    global_cache.drop(name, false);
 }
 
 Material *
@@ -275,18 +304,33 @@ Material::get(const char *name, Flags flags)
         ? core::str::format("%s::%x", name, flags)
         : core::str::dup(name);
 
-    Material *material = global_cache[s];
-    if (flags && material == NULL)
+    Material *material;
+    bool      loading = false;
+    if (flags)
+    {
+        material = global_cache.reserve(s, &loading);
+    }
+    else
+    {
+        material = global_cache.acquire(s);
+    }
+    
+    if (loading)
     {
         // Search for base material if requested variant hasn't been cached
-        material = global_cache[name];
-        if (material != NULL)
+        Material *base = global_cache.acquire(name);
+        if (base != NULL)
         {
             // Create new variant
-            material = new Material(*material);
+            material = new Material(*base);
             material->decompose();
             material->compose(flags);
-            material = global_cache.store(s, material);
+            material = global_cache.store(s, material, sizeof(Material));
+            global_cache.release(base);
+        }
+        else
+        {
+            global_cache.drop(s, false);
         }
     }
     
@@ -300,6 +344,31 @@ Material::get(const Material *material, Flags flags)
     return Material::get(material->name, flags);
 }
 
+Material *
+Material::acquire(Material *material)
+{
+    return global_cache.acquire(material);
+}
+
+void
+Material::release(const Material *material)
+{
+    global_cache.release(material);
+}
+
+void
+Material::trim_cache(void)
+{
+    // Cheap to rebuild, but keep their textures resident while they exist
+    unsigned int evicted = global_cache.trim(0);
+    if (evicted > 0)
+    {
+        const core::Cache<Material>::Stats &stats = global_cache.get_stats();
+        LOG(INFO, VIDEO)("Evicted %u materials, %u remain (%lu evicted in total)",
+            evicted, stats.entries, stats.evictions);
+    }
+}
+
 void
 Material::flush_cache(void)
 {
@@ -53,16 +53,49 @@ namespace gfx
 
             static Material *
             get(const char *name, Flags flags = 0);
+            // Returns a cached material or its variant, or NULL if unknown.
+            // Like add(), each call holds a reference until released.
 
             static Material *
             get(const Material *material, Flags flags = 0);
 
             static Material *
             add(const char *name);
+            // Returns the cached material, or a new default one. Either
+            // way it is shared, only fill it in on the main thread.
+
+            static Material *
+            reserve(const char *name, bool *loading);
+            // Returns the cached material, or with *loading set reserves
+            // the name for a material the caller builds privately and then
+            // store()s. Others asking for it meanwhile wait.
+
+            static Material *
+            store(const char *name, Material *material);
+            // Completes a reservation, returns the cached material
+
+            static void
+            drop(const char *name);
+            // Gives up a reservation that won't be stored after all
 
             static int
-            load(const char *filename);
-            // Loads an MTL file, returns the number of new materials cached
+            load(const char *filename, bool defer_upload = false);
+            // Loads an MTL file, returns the number of new materials cached.
+            // Materials already cached are left as they are.
+            // See io::load_MTL for defer_upload.
+
+            static Material *
+            acquire(Material *material);
+            // Takes another reference to a cached material
+
+            static void
+            release(const Material *material);
+            // Returns a reference, letting the material be evicted once
+            // unused and its textures with it
+
+            static void
+            trim_cache(void);
+            // Evicts all unreferenced materials
 
             static void
             flush_cache(void);
@@ -7,11 +7,24 @@
 #include "mesh.h"
 #include "../../core/engine.h" // screen
 #include "../../core/math.h"   // randomness
+#include "../../math/kernels.h"
 
 #include <cmath>     // abs, sqrt
 
 using namespace gfx;
 
+static void
+_transform(Mesh::Vertices &vertices, size_t first, const math::Mat4 &transformation)
+// Positions of vertices from first on, all at once
+{
+    if (first < vertices.size())
+    {
+        float *pos = &vertices[first].pos.x;
+        math::kernels::transform_points(pos, pos, vertices.size() - first,
+            sizeof(Mesh::Vertex), transformation.data);
+    }
+}
+
 Mesh::Mesh()
 {
     this->attr.index     = 0;
@@ -145,7 +158,8 @@ const
     glVertexAttribPointer(shader->attr.t_weight, 4, GL_FLOAT, GL_FALSE, 0, NULL);
     
     screen.scene->matrix.mv.to(shader->unif.modelview);
-    screen.scene->matrix.mv.transpose().inverse().to(shader->unif.normal);
+    screen.scene->update_normal_matrix();
+    screen.scene->matrix.normal.to(shader->unif.normal);
     
     // Render
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->attr.index);
@@ -240,14 +254,10 @@ Mesh &
 Mesh::add(const Mesh &mesh, const math::Mat4 &transformation)
 {
     size_t offset = this->vertices.size();
-    this->vertices.reserve(offset + mesh.vertices.size());
     this->indices.reserve(this->indices.size() + mesh.vertices.size());
-    for (Mesh::Vertices::const_iterator v = mesh.vertices.begin();
-        v != mesh.vertices.end(); ++v)
-    {
-        this->vertices.push_back(*v);
-        this->vertices[this->vertices.size() - 1].pos *= transformation;
-    }
+    this->vertices.insert(this->vertices.end(),
+        mesh.vertices.begin(), mesh.vertices.end());
+    _transform(this->vertices, offset, transformation);
 
     for (Mesh::Indices::const_iterator i = mesh.indices.begin();
         i != mesh.indices.end(); ++i)
@@ -301,14 +311,10 @@ Mesh &
 Mesh::add(Mesh *mesh, const math::Mat4 &transformation)
 {
     size_t offset = this->vertices.size();
-    this->vertices.reserve(offset + mesh->vertices.size());
     this->indices.reserve(this->indices.size() + mesh->vertices.size());
-    for (Mesh::Vertices::const_iterator v = mesh->vertices.begin();
-        v != mesh->vertices.end(); ++v)
-    {
-        this->vertices.push_back(*v);
-        this->vertices[this->vertices.size() - 1].pos *= transformation;
-    }
+    this->vertices.insert(this->vertices.end(),
+        mesh->vertices.begin(), mesh->vertices.end());
+    _transform(this->vertices, offset, transformation);
     
     for (Mesh::Indices::const_iterator i = mesh->indices.begin();
         i != mesh->indices.end(); ++i)
@@ -339,26 +345,18 @@ Mesh::add(Mesh *mesh, float x, float y, float z, float scale)
 Mesh &
 Mesh::transform(const math::Mat4 &transformation, bool transform_uv)
 {
+    _transform(this->vertices, 0, transformation);
+
     if (transform_uv)
     {
-        math::Mat4 inverse = transformation.inverse();
+        math::Vec3 foo(1.0f); foo *= transformation.inverse();
         for (Mesh::Vertices::iterator v = this->vertices.begin();
             v != this->vertices.end(); ++v)
         {
-            v->pos *= transformation;
-            math::Vec3 foo(1.0f); foo *= inverse;
             v->uv.x *= foo.x;
             v->uv.y *= foo.z;
         }
     }
-    else
-    {
-        for (Mesh::Vertices::iterator v = this->vertices.begin();
-            v != this->vertices.end(); ++v)
-        {
-            v->pos *= transformation;
-        }
-    }
     
     return *this;
 }
@@ -7,22 +7,46 @@
 #include "formats/obj.h"
 #include "../../core/util/cache.h"
 #include "../../core/util/string.h"
-#include "../../core/util/file.h"   // normalize_path
+#include "../../core/util/scratch.h"
+#include "../../core/engine.h"
 
 using namespace gfx;
 
 static core::Cache<Model> global_cache;
 
+static size_t
+_get_size(const Model *model)
+{
+    // Vertex data is kept in memory besides the GPU buffers
+    size_t size = sizeof(Model);
+    for (Model::Meshes::const_iterator mesh = model->meshes.begin();
+        mesh != model->meshes.end(); ++mesh)
+    {
+        size += sizeof(Mesh)
+            + (*mesh)->vertices.size() * sizeof(Mesh::Vertex)
+            + (*mesh)->indices.size()  * sizeof(int)
+            + (*mesh)->faces.size()    * sizeof(Mesh::Face);
+    }
+
+    return size;
+}
+
 Model::Model() :
-    filename(filename_mutable)
+    filename(filename_mutable),
+    ready(ready_mutable)
 {
     this->filename_mutable = NULL;
+    this->ready_mutable    = true;
+    this->pending          = 0;
 }
 
 Model::Model(Mesh *primitive) :
-    filename(filename_mutable)
+    filename(filename_mutable),
+    ready(ready_mutable)
 {
     this->filename_mutable = NULL;
+    this->ready_mutable    = true;
+    this->pending          = 0;
     
     if (primitive != NULL)
     {
@@ -37,6 +61,8 @@ Model::~Model()
     for (Model::Meshes::iterator mesh = this->meshes.begin();
         mesh != this->meshes.end(); ++mesh)
     {
+        // Meshes hold a reference to their material
+        Material::release((*mesh)->material);
         delete *mesh;
     }
     
@@ -212,14 +238,12 @@ const
 Model *
 Model::load(const char *filename)
 {
-    char *s = core::str::normalize_path(filename);
-    Model *model;
-
-    if (global_cache.contains(s))
-    {
-        model = global_cache[s];
-    }
-    else
+    char *s = core::scratch::normalize_path(filename);
+    
+    // Concurrent requests for the same file wait for the first one
+    bool loading;
+    Model *model = global_cache.reserve(s, &loading);
+    if (loading)
     {
         model = gfx::io::load_OBJ(s);
         
@@ -229,19 +253,149 @@ Model::load(const char *filename)
             model->compose();
         }
 
-        global_cache.store(
+        model = global_cache.store(
             s,
-            model);
+            model,
+            (model != NULL) ? _get_size(model) : 0);
+    }
+    else if (model != NULL)
+    {
+        // Asynchronous load still in progress, its job may be resubmitted
+        while (!model->ready)
+        {
+            core::engine.wait(model->pending);
+        }
     }
     
-    delete[] s;
     return model;
 }
 
+typedef
+    struct
+    {
+        Model *model, *loaded;
+        size_t composed; // meshes uploaded so far
+    }
+    _AsyncModel;
+
+Model *
+Model::load_async(const char *filename)
+{
+    // Without workers the loading would wait for someone to wait on it
+    if (core::engine.worker_count() <= 1)
+    {
+        return Model::load(filename);
+    }
+
+    char *s = core::scratch::normalize_path(filename);
+
+    bool loading;
+    Model *model = global_cache.reserve(s, &loading);
+    if (loading)
+    {
+        // Size 0 until composed, so that it can't be evicted meanwhile
+        model = new Model();
+        model->ready_mutable = false;
+        core::str::set(model->filename_mutable, core::str::dup(s));
+        model = global_cache.store(s, model);
+
+        _AsyncModel *job = new _AsyncModel;
+        job->model    = model;
+        job->loaded   = NULL;
+        job->composed = 0;
+
+        model->pending = core::engine.submit_main(Model::compose_job, job,
+            core::engine.submit(Model::load_job, job));
+    }
+
+    return model;
+}
+
+void
+Model::load_job(void *data)
+{
+    _AsyncModel *job = (_AsyncModel *)data;
+    job->loaded = gfx::io::load_OBJ(job->model->filename, true);
+}
+
+static unsigned long
+_pending_texture(const Material *material)
+// An upload job that the material still waits for, or NO_JOB
+{
+    const Texture *texture[] = {
+        material->color_map,
+        material->bump_map,
+        material->normal_map,
+        material->specular_map,
+        material->decal_map,
+        material->ambient_occlusion_map
+    };
+
+    for (int i = 0; i < 6; ++i)
+    {
+        if (texture[i] != NULL && !core::engine.is_done(texture[i]->pending))
+        {
+            return texture[i]->pending;
+        }
+    }
+
+    return core::JobEngine::NO_JOB;
+}
+
+void
+Model::compose_job(void *data)
+{
+    _AsyncModel *job   = (_AsyncModel *)data;
+    Model       *model = job->model;
+    Meshes      &loaded = job->loaded->meshes;
+
+    if (job->composed < loaded.size())
+    {
+        // One mesh per job, so that the frame budget can split a model up
+        Mesh *mesh = loaded[job->composed];
+        core::JobEngine::Job texture = (mesh->material != NULL)
+            ? _pending_texture(mesh->material)
+            : core::JobEngine::NO_JOB;
+
+        if (texture == core::JobEngine::NO_JOB)
+        {
+            // Translucency is known once the textures are in
+            if (mesh->material != NULL)
+            {
+                mesh->material->compose();
+            }
+            mesh->compose();
+            job->composed++;
+        }
+
+        model->pending = core::engine.submit_main(Model::compose_job, job, texture);
+        return;
+    }
+
+    model->meshes.swap(loaded);
+    model->compose();
+    model->ready_mutable = true;
+    global_cache.set_size(model, _get_size(model));
+    core::engine.log("%s ready", model->filename);
+
+    delete job->loaded;
+    delete job;
+}
+
+Model *
+Model::acquire(Model *model)
+{
+    return global_cache.acquire(model);
+}
+
 void
 Model::unload(void)
 {
-    if (!global_cache.contains(this))
+    if (global_cache.contains(this))
+    {
+        global_cache.release(this);
+    }
+    else
     {
         delete this;
     }
@@ -260,7 +414,7 @@ Model::add(const Model *model)
         mesh != model->meshes.end(); ++mesh)
     {
         Mesh *copy = new Mesh();
-        copy->material = (*mesh)->material;
+        copy->material = Material::acquire((*mesh)->material);
         
         for (Mesh::Vertices::const_iterator v = (*mesh)->vertices.begin();
             v != (*mesh)->vertices.end(); ++v)
@@ -286,23 +440,8 @@ Model::add(const Model *model, const math::Mat4 &transformation)
         mesh != model->meshes.end(); ++mesh)
     {
         Mesh *copy = new Mesh();
-        copy->material = (*mesh)->material;
-        
-        for (Mesh::Vertices::const_iterator v = (*mesh)->vertices.begin();
-            v != (*mesh)->vertices.end(); ++v)
-        {
-            Mesh::Vertex translated = *v;
-            translated.pos *= transformation;
-            
-            copy->add(translated);
-        }
-
-        for (Mesh::Indices::const_iterator i = (*mesh)->indices.begin();
-            i != (*mesh)->indices.end(); ++i)
-        {
-            copy->indices.push_back(*i);
-        }
-        
+        copy->material = Material::acquire((*mesh)->material);
+        copy->add(**mesh, transformation);
         copy->compose();
         this->add(copy);
     }
@@ -337,6 +476,19 @@ Model::add(const Model *model, const math::Vec3 &pos, const math::Vec3 &rot)
         .translate(pos));
 }
 
+void
+Model::trim_cache(size_t budget)
+{
+    unsigned int evicted = global_cache.trim(budget);
+    if (evicted > 0)
+    {
+        const core::Cache<Model>::Stats &stats = global_cache.get_stats();
+        LOG(INFO, VIDEO)("Evicted %u models, %lu kB in %u remain (%lu evicted, %lu kB in total)",
+            evicted, (unsigned long)(stats.bytes >> 10), stats.entries,
+            stats.evictions, (unsigned long)(stats.evicted_bytes >> 10));
+    }
+}
+
 void
 Model::flush_cache(void)
 {
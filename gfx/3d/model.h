@@ -20,13 +20,37 @@ namespace gfx
             
             Meshes meshes;
             char * const &filename;
+            const bool   &ready;
+
+            unsigned long
+                pending; // core::JobEngine::Job that finishes an asynchronous load
 
             static Model *
             load(const char *filename);
+            // Returns a cached model, loading it if needed.
+            // Each call holds a reference until unloaded.
+            // Callers on other threads wait for a load in progress.
+
+            static Model *
+            load_async(const char *filename);
+            // Same as load(), but returns an empty placeholder right away.
+            // The file and its textures are decoded on worker threads, and
+            // the meshes appear once the main thread has uploaded them one
+            // per job (see JobEngine::update_frame). load() on a pending
+            // model waits for it.
+
+            static Model *
+            acquire(Model *model);
+            // Takes another reference to a cached model
 
             void
             unload(void);
-            // Safely deletes model
+            // Safely deletes model, or releases a reference to a cached one
+
+            static void
+            trim_cache(size_t budget);
+            // Evicts least recently used unreferenced models
+            // while they take more than budget bytes
 
             static void
             flush_cache(void);
@@ -65,14 +89,14 @@ namespace gfx
             
             void
             add(Mesh *mesh);
-            // Binds a mesh to this model
+            // Binds a mesh to this model, which releases its material when deleted
 
             void add(const Model *model);
             void add(const Model *model, float x, float y, float z, float rot_y = 0.0f);
             void add(const Model *model, const math::Vec3 &pos, float rot_y = 0.0f);
             void add(const Model *model, const math::Vec3 &pos, const math::Vec3 &rot);
             void add(const Model *model, const math::Mat4 &transformation);
-            // Copy another model as a submodel
+            // Copy another model as a submodel, taking references to its materials
 
             Mesh *
             get(const char *name);
@@ -81,6 +105,13 @@ namespace gfx
         protected:
             Meshes opaque_meshes, transparent_meshes;
             char *filename_mutable;
+            bool  ready_mutable;
+
+            static void
+            load_job(void *data);
+
+            static void
+            compose_job(void *data);
     };
 }
 
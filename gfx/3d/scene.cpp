@@ -9,8 +9,10 @@
 
 #include <algorithm> // min, max, find
 #include <cmath>     // pow
+#include <cstring>   // memcmp
 
 #include "../../core/util/string.h"
+#include "../../core/util/profiler.h"
 
 #include "model.h"
 #include "mesh.h"
@@ -23,6 +25,10 @@
 #include "../../game/entity.h"
 #include "../../game/terrain.h"
 
+static core::Config::Handle
+    _view_range(core::engine.config, "video/detail/view_range"),
+    _horizon_detail(core::engine.config, "video/detail/horizon");
+
 using namespace gfx;
 
 
@@ -147,10 +153,10 @@ _sort_clouds(_CloudSprite *a, _CloudSprite *b)
 static void
 _render_sky(void)
 {
+    PROFILE("_render_sky");
+
     float
-        view_range  = 2.0f * core::engine.config
-            ["video"]["detail"]["view_range"]
-            .real(6000.0f),
+        view_range  = 2.0f * _view_range.real(6000.0f),
         view_range2 = view_range * view_range;
     
     typedef
@@ -284,6 +290,7 @@ Scene::Scene():
     this->matrix.mv     = math::Mat4::identity();
     this->matrix.camera = math::Mat4::identity();
     this->matrix.normal = math::Mat4::identity();
+    this->normal_source = this->matrix.mv;
     
     this->sunlight  = math::Vec4(
         math::Vec3(0.1f, 5.0f, 1.0f).normalize(),
@@ -293,9 +300,7 @@ Scene::Scene():
 
     float
         ocean_scale   = 64.0f,
-        ocean_horizon = core::engine.config
-            ["video"]["detail"]["view_range"]
-            .real(6000.0f) - game::TerrainChunk::SIZE / 2.0f;
+        ocean_horizon = _view_range.real(6000.0f) - game::TerrainChunk::SIZE / 2.0f;
 
     this->waves = primitive::grid(1.5f * ocean_horizon / ocean_scale);
 
@@ -365,6 +370,8 @@ _sort_post_render(_PostRender a, _PostRender b)
 void
 Scene::render(void)
 {
+    PROFILE("Scene::render");
+
     if (!game::terrain.w)
     {
         return;
@@ -391,10 +398,7 @@ Scene::render(void)
     // Planar horizon
     this->render_ground_plane();
 
-    this->clip(2.0f,
-        2.0f * core::engine.config
-            ["video"]["detail"]["view_range"]
-            .real(6000.0f));
+    this->clip(2.0f, 2.0f * _view_range.real(6000.0f));
 
     // Terrain
     glEnable(GL_DEPTH_TEST);
@@ -464,6 +468,16 @@ Scene::clip(float near, float far)
     }
 }
 
+void
+Scene::update_normal_matrix(void)
+{
+    if (memcmp(this->matrix.mv.data, this->normal_source.data, sizeof(this->normal_source.data)) != 0)
+    {
+        this->normal_source = this->matrix.mv;
+        this->matrix.normal = this->matrix.mv.inverse_transpose();
+    }
+}
+
 void
 Scene::update_projection(void)
 {
@@ -497,6 +511,7 @@ Scene::update(void)
     for (EntityContainer::iterator entity = update_queue.begin();
         entity != update_queue.end(); ++entity)
     {
+        (*entity)->store_state();
         (*entity)->update();
         
         if ((*entity)->flags & game::Entity::DELETED)
@@ -533,9 +548,7 @@ Scene::build_ground_plane(void)
         .transform_uv(math::Mat4::translation(-0.5f, -0.5f).scale(x, z));
     
     int
-        size = core::engine.config
-            ["video"]["detail"]["horizon"]
-            .integer(512);
+        size = _horizon_detail.integer(512);
     
     this->ground_plane->compose();
     this->ground_plane->material         = gfx::Material::add("ground_plane");
@@ -552,10 +565,7 @@ Scene::render_ground_plane(void)
     glDisable(GL_DEPTH_TEST);
     math::Vec3 camera_pos_backup = this->camera.pos;
 
-    this->clip(.3f
-        * core::engine.config
-            ["video"]["detail"]["view_range"]
-            .real(6000.0f),
+    this->clip(.3f * _view_range.real(6000.0f),
         game::Terrain::MAX_VISIBILITY);
 
     this->matrix.mv
@@ -90,6 +90,11 @@ namespace gfx
             void
             clip(float near, float far);
 
+            void
+            update_normal_matrix(void);
+            // Recomputes matrix.normal only if matrix.mv has changed since
+            // the last call, as meshes drawn in a row often share one
+
             void
             render(void);
             
@@ -123,6 +128,9 @@ namespace gfx
             bool
                 perspective_mutable;
 
+            math::Mat4
+                normal_source; // matrix.mv that matrix.normal belongs to
+
             void
             update_projection(void);
     };
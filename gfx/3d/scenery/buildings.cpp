@@ -163,17 +163,15 @@ scenery::building::house(const math::Vec3 &size, int wings, Model *roof, char st
         r != roof->meshes.end(); ++r)
     {
         mesh = new Mesh();
-        mesh->material = (*r)->material;
+        mesh->material = Material::acquire((*r)->material);
         mesh->vertices = (*r)->vertices;
         mesh->indices  = (*r)->indices;
+        mesh->transform(math::Mat4::translation(0.0f, y, 0.0f)
+            .scale(size.x / 2.0f, 1.0f, size.z / 2.0f));
         
         for (Mesh::Vertices::iterator v = mesh->vertices.begin();
             v != mesh->vertices.end(); ++v)
         {
-            v->pos.x *= size.x / 2.0f;
-            v->pos.y += y;
-            v->pos.z *= size.z / 2.0f;
-
             if (r == roof->meshes.begin())
             {
                 v->uv.x = v->pos.z / 2.0f;
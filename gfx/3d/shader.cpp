@@ -13,6 +13,8 @@
 #include "../../core/util/cache.h"
 #include "../../core/util/config.h"
 
+#include <string>
+
 using namespace gfx;
 
 static core::Cache<Shader> global_cache;
@@ -87,6 +89,32 @@ Shader::get(const char *filename)
     return global_cache[filename];
 }
 
+static void
+_append_glsl_line(std::string &out, const core::TextReader::Token &line, const char *main)
+{
+    // Collapse runs of spaces and rename "void main" to the given function name
+    static const char    pattern[] = "void main";
+    static const size_t  length    = sizeof(pattern) - 1;
+
+    for (size_t i = 0; i < line.length; ++i)
+    {
+        char c = line.s[i];
+        if (c == ' ' && !out.empty() && out[out.size() - 1] == ' ')
+        {
+            continue;
+        }
+
+        out += c;
+        if (c == 'n' && out.size() >= length
+            && out.compare(out.size() - length, length, pattern) == 0)
+        {
+            out.replace(out.size() - length, length, main);
+        }
+    }
+
+    out += '\n';
+}
+
 static char *
 _compose_glsl(const char *directory, const char *file)
 {
@@ -99,7 +127,7 @@ _compose_glsl(const char *directory, const char *file)
     core::Config shader_statements;
     
     // Load shader files (filenames separated by spaces)
-    char *source = core::str::empty();
+    std::string composed;
     for (core::Config::Value::iterator i = shader_filenames->begin();
         i != shader_filenames->end(); ++i)
     {
@@ -119,16 +147,16 @@ _compose_glsl(const char *directory, const char *file)
         {
             char *main = core::str::get_filename(filename);
             shader_functions[core::Config::NEXT] = main;
-            
-            char *s = core::str::strip_duplicate(
-                core::str::dup(glsl.get_contents()),
-                ' ');
-
             core::str::set(main, core::str::cat("void _", main));
-            core::str::set(s, core::str::replace(s, "void main", main));
-            
-            core::str::set(source, core::str::cat(source, s));
-            delete[] s;
+
+            // Read straight from the mapping, copying each line only once
+            core::TextReader text(&glsl);
+            core::TextReader::Token line;
+            while (text.next_line(&line))
+            {
+                _append_glsl_line(composed, line, main);
+            }
+
             delete[] main;
         }
         else
@@ -136,6 +164,8 @@ _compose_glsl(const char *directory, const char *file)
             core::engine.log("(!) File not found: %s", glsl.filename);
         }
     }
+
+    char *source = core::str::dup(composed.c_str());
     
     char *version = NULL;
     
@@ -15,6 +15,7 @@
 #include "../../core/util/string.h"
 #include "../../core/util/cache.h"
 #include "../../core/util/file.h"
+#include "../../core/util/scratch.h"
 #include "../../core/engine.h"
 #include "../../math/util.h"
 
@@ -22,6 +23,21 @@ using namespace gfx;
 
 static core::Cache<Texture> global_cache;
 
+static size_t
+_get_size(const Texture *texture)
+{
+    // RGBA, plus a third for the mipmap chain
+    size_t size = (size_t)texture->w * texture->h * 4;
+    if (!(texture->flags & Texture::NO_MIPMAP))
+    {
+        size += size / 3;
+    }
+
+    return (texture->flags & Texture::CUBEMAP)
+        ? 6 * size
+        : size;
+}
+
 Texture::Texture() :
     w(w_mutable),
     h(h_mutable),
@@ -32,8 +48,10 @@ Texture::Texture() :
     this->flags               = 0;
     this->framebuffer_id      = 0;
     this->depthbuffer_id      = 0;
+    this->pending             = 0;
     this->w_mutable           = 0;
     this->h_mutable           = 0;
+    this->ready_mutable       = false;
     this->translucent_mutable = false;
 }
 
@@ -77,76 +95,82 @@ Texture::target(bool render_to_texture)
     }
 }
 
+static char *
+_get_key(const char *filename, Texture::Flags flags, char **normalized)
+// Both strings are scratch memory
+{
+    *normalized = core::scratch::normalize_path(
+        core::scratch::cat(DATA_DIRECTORY, filename));
+
+    return core::scratch::format("%s::%x", *normalized, flags);
+}
+
+static bool
+_load_sprites(const char *normalized, Texture::Flags flags, Sprite **sprite, int *files, char **path)
+// Loads the image, or the six cubemap sides, *path names the last one tried
+{
+    bool success;
+    if (!(flags & Texture::CUBEMAP))
+    {
+        core::str::set(*path, core::str::dup(normalized));
+        sprite[0] = new gfx::Sprite();
+        success   = sprite[0]->load(*path);
+        *files    = 1;
+
+        return success;
+    }
+
+    const char *cubemap_sides[] = {
+        "right",  // GL_TEXTURE_CUBE_MAP_POSITIVE_X
+        "left",   // GL_TEXTURE_CUBE_MAP_NEGATIVE_X
+        "bottom", // GL_TEXTURE_CUBE_MAP_POSITIVE_Y
+        "top",    // GL_TEXTURE_CUBE_MAP_NEGATIVE_Y
+        "back",   // GL_TEXTURE_CUBE_MAP_POSITIVE_Z
+        "front"   // GL_TEXTURE_CUBE_MAP_NEGATIVE_Z
+    };
+
+    char *dir, *ext;
+    core::str::get_path_components(normalized, path, &dir, &ext);
+    core::str::set(dir, core::str::cat(*path, dir));
+
+    for (*files = 0, success = true; success && *files < 6; ++*files)
+    {
+        core::str::set(*path, core::str::format("%s/%s.%s",
+            dir, cubemap_sides[*files], ext));
+
+        sprite[*files] = new gfx::Sprite();
+        success &= sprite[*files]->load(*path);
+    }
+    delete[] dir;
+    delete[] ext;
+
+    return success;
+}
+
 Texture *
 Texture::get(const char *filename, Texture::Flags flags, int index)
 {
     Texture *result;
 
-    char *normalized = core::str::cat(DATA_DIRECTORY, filename);
-    core::str::set(normalized, core::str::normalize_path(normalized));
-    
-    char *key  = core::str::format("%s::%x", normalized, flags);
+    char *normalized;
+    char *key = _get_key(filename, flags, &normalized);
     
-    if (global_cache.contains(key))
+    // Concurrent requests for the same file wait for the first one
+    bool loading;
+    result = global_cache.reserve(key, &loading);
+    if (loading)
     {
-        result = global_cache[key];
-    }
-    else
-    {
-        GLenum type = (flags & Texture::CUBEMAP)
-            ? GL_TEXTURE_CUBE_MAP
-            : GL_TEXTURE_2D;
-        
+        core::engine.log((flags & Texture::CUBEMAP)
+            ? "Loading cubemap %s"
+            : "Loading %s", normalized);
+
         int   files;
-        bool  success;
-        char *path = NULL, *dir, *ext;
+        char *path = NULL;
         gfx::Sprite *sprite[6];
-        switch (type)
-        {
-            case GL_TEXTURE_2D:
-                core::engine.log("Loading %s", normalized);
-                core::str::set(path, core::str::dup(normalized));
-                sprite[0] = new gfx::Sprite();
-                success   = sprite[0]->load(path);
-                files     = 1;
-
-                break;
-
-            
-            case GL_TEXTURE_CUBE_MAP:
-                const char *cubemap_sides[] = {
-                    "right",  // GL_TEXTURE_CUBE_MAP_POSITIVE_X
-                    "left",   // GL_TEXTURE_CUBE_MAP_NEGATIVE_X
-                    "bottom", // GL_TEXTURE_CUBE_MAP_POSITIVE_Y
-                    "top",    // GL_TEXTURE_CUBE_MAP_NEGATIVE_Y
-                    "back",   // GL_TEXTURE_CUBE_MAP_POSITIVE_Z
-                    "front"   // GL_TEXTURE_CUBE_MAP_NEGATIVE_Z
-                };
-
-                core::str::get_path_components(normalized,
-                    &path, &dir, &ext);
-                
-                core::str::set(dir, core::str::cat(path, dir));
-
-                core::engine.log("Loading %s/*.%s", dir, ext);
-                for (files = 0, success = true; success && files < 6; ++files)
-                {
-                    core::str::set(path, core::str::format("%s/%s.%s",
-                        dir, cubemap_sides[files], ext));
-                    
-                    sprite[files] = new gfx::Sprite();
-                    success &= sprite[files]->load(path);
-                }
-                delete[] dir;
-                delete[] ext;
-
-                break;
-        }
-        
-        if (success)
+        if (_load_sprites(normalized, flags, sprite, &files, &path))
         {
-            result = global_cache.store(key, Texture::load(
-                (const gfx::Sprite **)sprite, flags, index));
+            result = Texture::load((const gfx::Sprite **)sprite, flags, index);
+            result = global_cache.store(key, result, _get_size(result));
             core::engine.log("<(OK)");
         }
         else
@@ -161,27 +185,147 @@ Texture::get(const char *filename, Texture::Flags flags, int index)
             delete sprite[i];
         }
     }
+    else if (result != NULL && !result->ready)
+    {
+        // Asynchronous load still in progress
+        core::engine.wait(result->pending);
+    }
 
-    delete[] normalized;
-    delete[] key;
     return result;
 }
 
+typedef
+    struct
+    {
+        Texture       *texture;
+        char          *path;
+        int            index, faces, w, h;
+        bool           success, translucent;
+        unsigned char *pixels[6];
+    }
+    _AsyncTexture;
+
+Texture *
+Texture::get_async(const char *filename, Texture::Flags flags, int index)
+{
+    // Without workers the decoding would wait for someone to wait on it
+    if (core::engine.worker_count() <= 1)
+    {
+        return Texture::get(filename, flags, index);
+    }
+
+    char *normalized;
+    char *key = _get_key(filename, flags, &normalized);
+
+    bool loading;
+    Texture *result = global_cache.reserve(key, &loading);
+    if (loading)
+    {
+        result        = new Texture();
+        result->flags = flags;
+        result->type  = (flags & Texture::CUBEMAP)
+            ? GL_TEXTURE_CUBE_MAP
+            : GL_TEXTURE_2D;
+
+        // Size 0 until uploaded, so that it can't be evicted meanwhile
+        result = global_cache.store(key, result);
+
+        _AsyncTexture *job = new _AsyncTexture;
+        job->texture = result;
+        job->path    = core::str::dup(normalized);
+        job->index   = index;
+        job->faces   = 0;
+
+        result->pending = core::engine.submit_main(Texture::upload_job, job,
+            core::engine.submit(Texture::decode_job, job));
+    }
+
+    return result;
+}
+
+void
+Texture::decode_job(void *data)
+{
+    _AsyncTexture *job = (_AsyncTexture *)data;
+
+    int   files;
+    char *path = NULL;
+    gfx::Sprite *sprite[6];
+    job->success     = _load_sprites(job->path, job->texture->flags, sprite, &files, &path);
+    job->translucent = false;
+
+    if (job->success)
+    {
+        for (job->faces = 0; job->faces < files; ++job->faces)
+        {
+            bool translucent;
+            job->pixels[job->faces] = Texture::prepare(sprite[job->faces],
+                job->texture->flags, &job->w, &job->h, &translucent);
+            job->translucent |= translucent;
+        }
+    }
+    else
+    {
+        core::engine.log("(!) Failed to load %s", path);
+    }
+
+    delete[] path;
+    for (int i = 0; i < files; ++i)
+    {
+        delete sprite[i];
+    }
+}
+
+void
+Texture::upload_job(void *data)
+{
+    _AsyncTexture *job     = (_AsyncTexture *)data;
+    Texture       *texture = job->texture;
+
+    if (job->success)
+    {
+        texture->setup(job->index);
+        for (int i = 0; i < job->faces; ++i)
+        {
+            texture->upload(job->pixels[i], job->w, job->h, job->translucent,
+                (texture->flags & Texture::CUBEMAP)
+                    ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + i
+                    : texture->type);
+        }
+        texture->finish();
+
+        global_cache.set_size(texture, _get_size(texture));
+        core::engine.log("Loaded %s (%i x %i)", job->path, texture->w, texture->h);
+    }
+
+    for (int i = 0; i < job->faces; ++i)
+    {
+        delete[] job->pixels[i];
+    }
+    delete[] job->path;
+    delete job;
+}
+
 Texture *
 Texture::framebuffer(const char *name, int w, int h, bool alpha, unsigned int depth_bits)
 {
-    if (global_cache.contains(name))
+    bool loading;
+    Texture *texture = global_cache.reserve(name, &loading);
+    if (!loading)
     {
-        return global_cache[name];
+        // Pinned by the creator's reference, lookups don't hold one
+        global_cache.release(texture);
+        return texture;
     }
 
     core::engine.log("New render buffer \"%s\" (%i x %i)", name, w, h);
 
-    Texture *texture   = new Texture();
+    texture            = new Texture();
     texture->type      = GL_TEXTURE_2D;
-    texture->w_mutable = w;
-    texture->h_mutable = h;
-    texture->flags     = Texture::FRAMEBUFFER
+    texture->w_mutable     = w;
+    texture->h_mutable     = h;
+    texture->ready_mutable = true;
+    texture->flags         = Texture::FRAMEBUFFER
         | (Texture::DEPTHBUFFER * (depth_bits > 0));
 
     glGenFramebuffers(1, &texture->framebuffer_id);
@@ -237,7 +381,7 @@ Texture::framebuffer(const char *name, int w, int h, bool alpha, unsigned int de
         // glDrawBuffers(1, &texture->depthbuffer_id);
     }
     
-    texture = global_cache.store(name, texture);
+    texture = global_cache.store(name, texture, (size_t)w * h * 4);
     
     core::engine.log("<(OK)");
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -248,77 +392,107 @@ Texture::framebuffer(const char *name, int w, int h, bool alpha, unsigned int de
 Texture *
 Texture::load(const Sprite **sprite, Texture::Flags flags, int index)
 {
-    glActiveTexture(GL_TEXTURE0 + index);
-
     Texture *texture = new Texture();
     texture->flags   = flags;
     texture->type    = (flags & Texture::CUBEMAP)
         ? GL_TEXTURE_CUBE_MAP
         : GL_TEXTURE_2D;
     
-    glGenTextures(1, &texture->id);
-    glBindTexture(texture->type, texture->id);
+    texture->setup(index);
+
+    if (texture->flags & Texture::CUBEMAP)
+    {
+        for (int i = 0; i < 6; ++i)
+        {
+            texture->attach(sprite[i],
+                texture->flags, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i);
+        }
+    }
+    else
+    {
+        texture->attach(sprite[0], texture->flags, texture->type);
+    }
+
+    texture->finish();
+
+    return texture;
+}
+
+void
+Texture::setup(int index)
+{
+    glActiveTexture(GL_TEXTURE0 + index);
+
+    glGenTextures(1, &this->id);
+    glBindTexture(this->type, this->id);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
     // Minification filter
-    if (texture->flags & Texture::NO_MIPMAP)
+    if (this->flags & Texture::NO_MIPMAP)
     {
-        glTexParameteri(texture->type, GL_TEXTURE_MIN_FILTER,
-            (texture->flags & Texture::NEAREST)
+        glTexParameteri(this->type, GL_TEXTURE_MIN_FILTER,
+            (this->flags & Texture::NEAREST)
                 ? GL_NEAREST
                 : GL_LINEAR);
     }
     else
     {
-        glTexParameteri(texture->type, GL_TEXTURE_MIN_FILTER,
-            (texture->flags & Texture::NEAREST)
+        glTexParameteri(this->type, GL_TEXTURE_MIN_FILTER,
+            (this->flags & Texture::NEAREST)
                 ? GL_NEAREST_MIPMAP_NEAREST
                 : GL_LINEAR_MIPMAP_LINEAR);
     }
     
     // Magnification filter
-    glTexParameteri(texture->type, GL_TEXTURE_MAG_FILTER,
-        (texture->flags & Texture::NEAREST)
+    glTexParameteri(this->type, GL_TEXTURE_MAG_FILTER,
+        (this->flags & Texture::NEAREST)
             ? GL_NEAREST
             : GL_LINEAR);
 
     // Wrapping
-    glTexParameteri(texture->type, GL_TEXTURE_WRAP_S,
-        (texture->flags & (Texture::CLAMP_X | Texture::CUBEMAP))
+    glTexParameteri(this->type, GL_TEXTURE_WRAP_S,
+        (this->flags & (Texture::CLAMP_X | Texture::CUBEMAP))
             ? GL_CLAMP_TO_EDGE
             : GL_REPEAT);
 
-    glTexParameteri(texture->type, GL_TEXTURE_WRAP_T,
-        (texture->flags & (Texture::CLAMP_Y | Texture::CUBEMAP))
+    glTexParameteri(this->type, GL_TEXTURE_WRAP_T,
+        (this->flags & (Texture::CLAMP_Y | Texture::CUBEMAP))
             ? GL_CLAMP_TO_EDGE
             : GL_REPEAT);
+}
 
-    if (texture->flags & Texture::CUBEMAP)
-    {
-        for (int i = 0; i < 6; ++i)
-        {
-            texture->attach(sprite[i],
-                texture->flags, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i);
-        }
-    }
-    else
+void
+Texture::finish(void)
+{
+    if (!(this->flags & Texture::NO_MIPMAP))
     {
-        texture->attach(sprite[0], texture->flags, texture->type);
+        glGenerateMipmap(this->type);
     }
 
-    if (!(texture->flags & Texture::NO_MIPMAP))
+    glBindTexture(this->type, 0);
+    this->ready_mutable = true;
+}
+
+bool
+Texture::attach(const Sprite *sprite, Texture::Flags flags, GLenum target)
+{
+    int  w, h;
+    bool translucent;
+    unsigned char *data = Texture::prepare(sprite, flags, &w, &h, &translucent);
+
+    if (sprite->w != w || sprite->h != h)
     {
-        glGenerateMipmap(texture->type);
+        core::engine.log("<(%i x %i resized to %i x %i)", sprite->w, sprite->h, w, h);
     }
 
-    glBindTexture(texture->type, 0);
-
+    this->upload(data, w, h, translucent, target);
+    delete[] data;
 
-    return texture;
+    return true;
 }
 
-bool
-Texture::attach(const Sprite *sprite, Texture::Flags flags, GLenum target)
+unsigned char *
+Texture::prepare(const Sprite *sprite, Texture::Flags flags, int *w_out, int *h_out, bool *translucent)
 {
     int
         w = std::max(MIN_TEXTURE_SIZE,
@@ -333,16 +507,15 @@ Texture::attach(const Sprite *sprite, Texture::Flags flags, GLenum target)
     // stretch to nearest power of two if needed
     if (sprite->w != w || sprite->h != h)
     {
-        core::engine.log("<(%i x %i", sprite->w, sprite->h);
     // (!) FIXME: TODO: fix bilinear and use sprite->scale() instead
         scaled = sprite->scale_nearest(w, h);
-        core::engine.log("<resized to %i x %i)", w, h);
         sprite = scaled;
     }
 
     // Rebuild bitmap upside down for OpenGL
     unsigned char *data = new unsigned char[w * h * 4];
     int i = 0;
+    *translucent = false;
     for (int y = h - 1; y >= 0; --y)
     {
         const gfx::Component *src = (flags & Texture::FLIP_Y)
@@ -367,21 +540,52 @@ Texture::attach(const Sprite *sprite, Texture::Flags flags, GLenum target)
             data[i++] = src[0];
             data[i++] = src[3];
             
-            this->translucent_mutable |= src[3] != 0xff;
+            *translucent |= src[3] != 0xff;
             src += src_step;
         }
     }
     delete scaled;
 
-    this->w_mutable = w;
-    this->h_mutable = h;
+    *w_out = w;
+    *h_out = h;
+
+    return data;
+}
+
+void
+Texture::upload(const unsigned char *data, int w, int h, bool translucent, GLenum target)
+{
+    this->w_mutable            = w;
+    this->h_mutable            = h;
+    this->translucent_mutable |= translucent;
 
-    glTexImage2D(target, 0, GL_RGBA, sprite->w, sprite->h, 0, GL_RGBA,
+    glTexImage2D(target, 0, GL_RGBA, w, h, 0, GL_RGBA,
         GL_UNSIGNED_BYTE, data);
+}
 
-    delete[] data;
+Texture *
+Texture::acquire(Texture *texture)
+{
+    return global_cache.acquire(texture);
+}
 
-    return true;
+void
+Texture::release(const Texture *texture)
+{
+    global_cache.release(texture);
+}
+
+void
+Texture::trim_cache(size_t budget)
+{
+    unsigned int evicted = global_cache.trim(budget);
+    if (evicted > 0)
+    {
+        const core::Cache<Texture>::Stats &stats = global_cache.get_stats();
+        LOG(INFO, VIDEO)("Evicted %u textures, %lu kB in %u remain (%lu evicted, %lu kB in total)",
+            evicted, (unsigned long)(stats.bytes >> 10), stats.entries,
+            stats.evictions, (unsigned long)(stats.evicted_bytes >> 10));
+    }
 }
 
 void
@@ -2,6 +2,7 @@
 #define _GFX_3D_TEXTURE_H
 
 #include <GL/gl.h>
+#include <cstddef> // size_t
 #include "../sprite.h"
 
 namespace gfx
@@ -43,11 +44,25 @@ namespace gfx
                 framebuffer_id,
                 depthbuffer_id;
 
+            unsigned long
+                pending; // core::JobEngine::Job that finishes an asynchronous load
+
             Texture();
             ~Texture();
 
             static Texture *
             get(const char *filename, Flags flags = AUTO, int index = 0);
+            // Returns a cached texture, loading it if needed.
+            // Each call holds a reference until released.
+            // Callers on other threads wait for a load in progress,
+            // though loading itself needs the GL context.
+
+            static Texture *
+            get_async(const char *filename, Flags flags = AUTO, int index = 0);
+            // Same as get(), but returns a placeholder right away and decodes
+            // the file on a worker thread. The placeholder binds as no texture
+            // until the main thread has uploaded it (see JobEngine::update_frame)
+            // and it becomes ready. get() on a pending texture waits for it.
 
             static Texture *
             load(const Sprite *sprite, Flags flags = AUTO, int index = 0) { return load(&sprite, flags, index); }
@@ -75,7 +90,26 @@ namespace gfx
 
             bool
             attach(const Sprite *sprite, Flags flags, GLenum target);
+
+            static unsigned char *
+            prepare(const Sprite *sprite, Flags flags, int *w, int *h, bool *translucent);
+            // The CPU side of attach(): RGBA rows scaled to a power of two,
+            // bottom row first. Safe on any thread, delete[] when done.
         
+            static Texture *
+            acquire(Texture *texture);
+            // Takes another reference to a cached texture
+
+            static void
+            release(const Texture *texture);
+            // Returns a reference taken by get(), letting the texture be
+            // evicted once unused
+
+            static void
+            trim_cache(size_t budget);
+            // Evicts least recently used unreferenced textures
+            // while their estimated GPU memory exceeds budget bytes
+
             static void
             flush_cache(void);
             
@@ -93,6 +127,23 @@ namespace gfx
             bool
                 ready_mutable,
                 translucent_mutable;
+
+            void
+            setup(int index);
+            // Creates and binds the GL texture and sets its parameters
+
+            void
+            upload(const unsigned char *data, int w, int h, bool translucent, GLenum target);
+
+            void
+            finish(void);
+            // Builds mipmaps, unbinds and marks the texture ready
+
+            static void
+            decode_job(void *data);
+
+            static void
+            upload_job(void *data);
     };
 }
 
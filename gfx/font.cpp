@@ -504,30 +504,32 @@ const
 Font *
 Font::get(const char *name, float size, Color stroke, Color background, Color effect)
 {
-    if (name == NULL)
-    {
-        name = "normal";
-    }
-    
-    char *path = core::str::format(FONT_DIRECTORY "%s.png", name);
-    core::str::set(path, core::str::normalize_path(path));
+    return Font::get(core::symbol::intern((name) ? name : "normal"),
+        size, stroke, background, effect);
+}
 
+Font *
+Font::get(core::symbol::Id name, float size, Color stroke, Color background, Color effect)
+{
     Font *font = new Font();
 
-    if (global_cache.contains(path))
+    if (global_cache.contains(name))
     {
-        *font = *global_cache[path];
+        *font = *global_cache[name];
     }
     else
     {
+        char *path = core::str::format(FONT_DIRECTORY "%s.png", core::symbol::name(name));
+        core::str::set(path, core::str::normalize_path(path));
+
         Font *base_font = new Font();
-        core::engine.log("Loading %s font", name);
+        core::engine.log("Loading %s font", core::symbol::name(name));
         base_font->load(path);
         
-        *font = *global_cache.store(path, base_font);
-    }
+        *font = *global_cache.store(name, base_font);
 
-    delete[] path;
+        delete[] path;
+    }
 
     font->size             = size;
     font->color.stroke     = stroke;
@@ -5,6 +5,7 @@
 
 // #include "3d/texture.h"
 #include "sprite.h"
+#include "../core/util/symbol.h"
 
 namespace gfx
 {
@@ -17,6 +18,10 @@ namespace gfx
         // Returns a font instance. Loads font bitmap if not loaded yet.
         // Caller must delete returned instance.
 
+        static Font *
+        get(core::symbol::Id name, float size = 8.0f, gfx::Color stroke = 0xffffffff, gfx::Color background = 0x00000000, gfx::Color effect = 0xff808080);
+        // Same as above, for fonts fetched every frame
+
         float
             x, y,
             size;
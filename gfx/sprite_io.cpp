@@ -1,9 +1,21 @@
 #include <SDL2/SDL_image.h>
+#include "../core/util/pack.h"
 
 bool
 Sprite::load(const char *filename)
 {
     SDL_Surface *surface = IMG_Load(filename);
+    if (surface == NULL)
+    {
+        // Loose files override packed ones
+        size_t      size;
+        const void *packed = core::pack::find(filename, &size);
+        if (packed != NULL)
+        {
+            surface = IMG_Load_RW(SDL_RWFromConstMem(packed, size), 1);
+        }
+    }
+    
     if (surface == NULL)
     {
         return false;
@@ -1,13 +1,23 @@
 #include "main.h"
 #include "core/engine.h"
 #include "core/engines/input.h"
+#include "core/util/pack.h"
 
 #include <cstdio>
+#include <cstring>
 int
 main(int argc, char *argv[])
 {
     try
     {
+        // Build the asset pack from the data directory instead of running
+        if (argc > 1 && strcmp(argv[1], "--pack") == 0)
+        {
+            int files = core::pack::build(PACK_FILENAME);
+            core::engine.log("Packed %i files into " PACK_FILENAME, files);
+            return 0;
+        }
+
         for (
             core::engine.start();
             core::engine.run() && !input[core::Input::QUIT];
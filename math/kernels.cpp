@@ -0,0 +1,516 @@
+#include "kernels.h"
+
+#include <cstring> // memcpy
+
+#ifdef MATH_SSE
+#   include <xmmintrin.h>
+#endif
+
+using namespace math;
+
+void
+kernels::mat4_multiply(float *dst, const float *A, const float *B)
+{
+#   ifdef MATH_SSE
+    kernels::mat4_multiply_sse(dst, A, B);
+#   else
+    kernels::mat4_multiply_scalar(dst, A, B);
+#   endif
+}
+
+void
+kernels::mat4_transpose(float *dst, const float *M)
+{
+#   ifdef MATH_SSE
+    kernels::mat4_transpose_sse(dst, M);
+#   else
+    kernels::mat4_transpose_scalar(dst, M);
+#   endif
+}
+
+void
+kernels::mat4_inverse(float *dst, const float *M)
+{
+#   ifdef MATH_SSE
+    kernels::mat4_inverse_sse(dst, M);
+#   else
+    kernels::mat4_inverse_scalar(dst, M);
+#   endif
+}
+
+void
+kernels::quat_mat4(float *dst, const float *q)
+{
+#   ifdef MATH_SSE
+    kernels::quat_mat4_sse(dst, q);
+#   else
+    kernels::quat_mat4_scalar(dst, q);
+#   endif
+}
+
+void
+kernels::transform_points(float *dst, const float *src, size_t count, size_t stride, const float *M)
+{
+#   ifdef MATH_SSE
+    kernels::transform_points_sse(dst, src, count, stride, M);
+#   else
+    kernels::transform_points_scalar(dst, src, count, stride, M);
+#   endif
+}
+
+void
+kernels::transform_vectors(float *dst, const float *src, size_t count, size_t stride, const float *M)
+{
+#   ifdef MATH_SSE
+    kernels::transform_vectors_sse(dst, src, count, stride, M);
+#   else
+    kernels::transform_vectors_scalar(dst, src, count, stride, M);
+#   endif
+}
+
+void
+kernels::mat4_multiply_array(float *dst, const float *A, size_t count, const float *M)
+{
+#   ifdef MATH_SSE
+    kernels::mat4_multiply_array_sse(dst, A, count, M);
+#   else
+    kernels::mat4_multiply_array_scalar(dst, A, count, M);
+#   endif
+}
+
+const char *
+kernels::instruction_set(void)
+{
+#   ifdef MATH_SSE
+    return "SSE";
+#   else
+    return "scalar";
+#   endif
+}
+
+/*
+    Scalar reference versions
+*/
+
+void
+kernels::mat4_multiply_scalar(float *dst, const float *A, const float *B)
+{
+    float T[16];
+    
+    T[ 0] = A[ 0] * B[ 0] + A[ 1] * B[ 4] + A[ 2] * B[ 8] + A[ 3] * B[12];
+    T[ 1] = A[ 0] * B[ 1] + A[ 1] * B[ 5] + A[ 2] * B[ 9] + A[ 3] * B[13];
+    T[ 2] = A[ 0] * B[ 2] + A[ 1] * B[ 6] + A[ 2] * B[10] + A[ 3] * B[14];
+    T[ 3] = A[ 0] * B[ 3] + A[ 1] * B[ 7] + A[ 2] * B[11] + A[ 3] * B[15];
+
+    T[ 4] = A[ 4] * B[ 0] + A[ 5] * B[ 4] + A[ 6] * B[ 8] + A[ 7] * B[12];
+    T[ 5] = A[ 4] * B[ 1] + A[ 5] * B[ 5] + A[ 6] * B[ 9] + A[ 7] * B[13];
+    T[ 6] = A[ 4] * B[ 2] + A[ 5] * B[ 6] + A[ 6] * B[10] + A[ 7] * B[14];
+    T[ 7] = A[ 4] * B[ 3] + A[ 5] * B[ 7] + A[ 6] * B[11] + A[ 7] * B[15];
+
+    T[ 8] = A[ 8] * B[ 0] + A[ 9] * B[ 4] + A[10] * B[ 8] + A[11] * B[12];
+    T[ 9] = A[ 8] * B[ 1] + A[ 9] * B[ 5] + A[10] * B[ 9] + A[11] * B[13];
+    T[10] = A[ 8] * B[ 2] + A[ 9] * B[ 6] + A[10] * B[10] + A[11] * B[14];
+    T[11] = A[ 8] * B[ 3] + A[ 9] * B[ 7] + A[10] * B[11] + A[11] * B[15];
+
+    T[12] = A[12] * B[ 0] + A[13] * B[ 4] + A[14] * B[ 8] + A[15] * B[12];
+    T[13] = A[12] * B[ 1] + A[13] * B[ 5] + A[14] * B[ 9] + A[15] * B[13];
+    T[14] = A[12] * B[ 2] + A[13] * B[ 6] + A[14] * B[10] + A[15] * B[14];
+    T[15] = A[12] * B[ 3] + A[13] * B[ 7] + A[14] * B[11] + A[15] * B[15];
+
+    memcpy(dst, T, sizeof(T));
+}
+
+void
+kernels::mat4_transpose_scalar(float *dst, const float *M)
+{
+    float T[16];
+    
+    T[ 0] = M[ 0]; T[ 1] = M[ 4]; T[ 2] = M[ 8]; T[ 3] = M[12];
+    T[ 4] = M[ 1]; T[ 5] = M[ 5]; T[ 6] = M[ 9]; T[ 7] = M[13];
+    T[ 8] = M[ 2]; T[ 9] = M[ 6]; T[10] = M[10]; T[11] = M[14];
+    T[12] = M[ 3]; T[13] = M[ 7]; T[14] = M[11]; T[15] = M[15];
+    
+    memcpy(dst, T, sizeof(T));
+}
+
+void
+kernels::mat4_inverse_scalar(float *dst, const float *M)
+{
+    float T[16];
+    
+    T[0] =
+          M[ 5] * M[10] * M[15] - M[ 5] * M[11] * M[14]
+        - M[ 9] * M[ 6] * M[15] + M[ 9] * M[ 7] * M[14]
+        + M[13] * M[ 6] * M[11] - M[13] * M[ 7] * M[10];
+        
+    T[1] =
+        - M[ 1] * M[10] * M[15] + M[ 1] * M[11] * M[14]
+        + M[ 9] * M[ 2] * M[15] - M[ 9] * M[ 3] * M[14]
+        - M[13] * M[ 2] * M[11] + M[13] * M[ 3] * M[10];
+        
+    T[2] =
+          M[ 1] * M[ 6] * M[15] - M[ 1] * M[ 7] * M[14]
+        - M[ 5] * M[ 2] * M[15] + M[ 5] * M[ 3] * M[14]
+        + M[13] * M[ 2] * M[ 7] - M[13] * M[ 3] * M[ 6];
+        
+    T[3] =
+        - M[ 1] * M[ 6] * M[11] + M[ 1] * M[ 7] * M[10]
+        + M[ 5] * M[ 2] * M[11] - M[ 5] * M[ 3] * M[10]
+        - M[ 9] * M[ 2] * M[ 7] + M[ 9] * M[ 3] * M[ 6];
+        
+    T[4] =
+        - M[ 4] * M[10] * M[15] + M[ 4] * M[11] * M[14]
+        + M[ 8] * M[ 6] * M[15] - M[ 8] * M[ 7] * M[14]
+        - M[12] * M[ 6] * M[11] + M[12] * M[ 7] * M[10];
+        
+    T[5] =
+          M[ 0] * M[10] * M[15] - M[ 0] * M[11] * M[14]
+        - M[ 8] * M[ 2] * M[15] + M[ 8] * M[ 3] * M[14]
+        + M[12] * M[ 2] * M[11] - M[12] * M[ 3] * M[10];
+        
+    T[6] =
+        - M[ 0] * M[ 6] * M[15] + M[ 0] * M[ 7] * M[14]
+        + M[ 4] * M[ 2] * M[15] - M[ 4] * M[ 3] * M[14]
+        - M[12] * M[ 2] * M[ 7] + M[12] * M[ 3] * M[ 6];
+        
+    T[7] =
+          M[ 0] * M[ 6] * M[11] - M[ 0] * M[ 7] * M[10]
+        - M[ 4] * M[ 2] * M[11] + M[ 4] * M[ 3] * M[10]
+        + M[ 8] * M[ 2] * M[ 7] - M[ 8] * M[ 3] * M[ 6];
+        
+    T[8] =
+          M[ 4] * M[ 9] * M[15] - M[ 4] * M[11] * M[13]
+        - M[ 8] * M[ 5] * M[15] + M[ 8] * M[ 7] * M[13]
+        + M[12] * M[ 5] * M[11] - M[12] * M[ 7] * M[ 9];
+        
+    T[9] =
+        - M[ 0] * M[ 9] * M[15] + M[ 0] * M[11] * M[13]
+        + M[ 8] * M[ 1] * M[15] - M[ 8] * M[ 3] * M[13]
+        - M[12] * M[ 1] * M[11] + M[12] * M[ 3] * M[ 9];
+        
+    T[10] =
+          M[ 0] * M[ 5] * M[15] - M[ 0] * M[ 7] * M[13]
+        - M[ 4] * M[ 1] * M[15] + M[ 4] * M[ 3] * M[13]
+        + M[12] * M[ 1] * M[ 7] - M[12] * M[ 3] * M[ 5];
+        
+    T[11] =
+        - M[ 0] * M[ 5] * M[11] + M[ 0] * M[ 7] * M[ 9]
+        + M[ 4] * M[ 1] * M[11] - M[ 4] * M[ 3] * M[ 9]
+        - M[ 8] * M[ 1] * M[ 7] + M[ 8] * M[ 3] * M[ 5];
+        
+    T[12] =
+        - M[ 4] * M[ 9] * M[14] + M[ 4] * M[10] * M[13]
+        + M[ 8] * M[ 5] * M[14] - M[ 8] * M[ 6] * M[13]
+        - M[12] * M[ 5] * M[10] + M[12] * M[ 6] * M[ 9];
+        
+    T[13] =
+          M[ 0] * M[ 9] * M[14] - M[ 0] * M[10] * M[13]
+        - M[ 8] * M[ 1] * M[14] + M[ 8] * M[ 2] * M[13]
+        + M[12] * M[ 1] * M[10] - M[12] * M[ 2] * M[ 9];
+        
+    T[14] =
+        - M[ 0] * M[ 5] * M[14] + M[ 0] * M[ 6] * M[13]
+        + M[ 4] * M[ 1] * M[14] - M[ 4] * M[ 2] * M[13]
+        - M[12] * M[ 1] * M[ 6] + M[12] * M[ 2] * M[ 5];
+        
+    T[15] =
+          M[ 0] * M[ 5] * M[10] - M[ 0] * M[ 6] * M[ 9]
+        - M[ 4] * M[ 1] * M[10] + M[ 4] * M[ 2] * M[ 9]
+        + M[ 8] * M[ 1] * M[ 6] - M[ 8] * M[ 2] * M[ 5];
+
+    float determinant = 1.0f / (
+          M[0] * T[0]
+        + M[1] * T[4]
+        + M[2] * T[8]
+        + M[3] * T[12]
+    );
+
+    for (int i = 0; i < 16; ++i)
+    {
+        dst[i] = T[i] * determinant;
+    }
+}
+
+void
+kernels::quat_mat4_scalar(float *dst, const float *q)
+{
+    float x = q[0], y = q[1], z = q[2], w = q[3];
+
+    dst[ 0] = 1.0f - 2.0f * y * y - 2.0f * z * z;
+    dst[ 1] = 2.0f * x * y - 2.0f * w * z;
+    dst[ 2] = 2.0f * x * z + 2.0f * w * y;
+    dst[ 3] = 0.0f;
+
+    dst[ 4] = 2.0f * x * y + 2.0f * w * z;
+    dst[ 5] = 1.0f - 2.0f * x * x - 2.0f * z * z;
+    dst[ 6] = 2.0f * y * z - 2.0f * w * x;
+    dst[ 7] = 0.0f;
+
+    dst[ 8] = 2.0f * x * z - 2.0f * w * y;
+    dst[ 9] = 2.0f * y * z + 2.0f * w * x;
+    dst[10] = 1.0f - 2.0f * x * x - 2.0f * y * y;
+    dst[11] = 0.0f;
+
+    dst[12] = 0.0f;
+    dst[13] = 0.0f;
+    dst[14] = 0.0f;
+    dst[15] = 1.0f;
+}
+
+// Element i of a strided array
+#define _AT(p, i, stride) ((float *)((char *)(p) + (i) * (stride)))
+#define _CONST_AT(p, i, stride) ((const float *)((const char *)(p) + (i) * (stride)))
+
+void
+kernels::transform_points_scalar(float *dst, const float *src, size_t count, size_t stride, const float *M)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float *v = _CONST_AT(src, i, stride);
+        float
+            x = M[ 0] * v[0] + M[ 4] * v[1] + M[ 8] * v[2] + M[12],
+            y = M[ 1] * v[0] + M[ 5] * v[1] + M[ 9] * v[2] + M[13],
+            z = M[ 2] * v[0] + M[ 6] * v[1] + M[10] * v[2] + M[14];
+
+        float *d = _AT(dst, i, stride);
+        d[0] = x;
+        d[1] = y;
+        d[2] = z;
+    }
+}
+
+void
+kernels::transform_vectors_scalar(float *dst, const float *src, size_t count, size_t stride, const float *M)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float *v = _CONST_AT(src, i, stride);
+        float
+            x = M[ 0] * v[0] + M[ 4] * v[1] + M[ 8] * v[2],
+            y = M[ 1] * v[0] + M[ 5] * v[1] + M[ 9] * v[2],
+            z = M[ 2] * v[0] + M[ 6] * v[1] + M[10] * v[2];
+
+        float *d = _AT(dst, i, stride);
+        d[0] = x;
+        d[1] = y;
+        d[2] = z;
+    }
+}
+
+void
+kernels::mat4_multiply_array_scalar(float *dst, const float *A, size_t count, const float *M)
+{
+    for (size_t i = 0; i < count * 16; i += 16)
+    {
+        kernels::mat4_multiply_scalar(dst + i, A + i, M);
+    }
+}
+
+#ifdef MATH_SSE
+/*
+    SSE versions. Each lane computes one element exactly the way the scalar
+    code above does: products in the same order, sums left to right, and
+    subtractions as additions of negated terms only where that is exact.
+*/
+
+// Lanes listed from 0 to 3
+#define _SHUFFLE(v, a, b, c, d) _mm_shuffle_ps(v, v, _MM_SHUFFLE(d, c, b, a))
+#define _LANES(a, b, c, d)      _mm_set_ps(d, c, b, a)
+
+void
+kernels::mat4_multiply_sse(float *dst, const float *A, const float *B)
+{
+    __m128
+        b0 = _mm_loadu_ps(B),
+        b1 = _mm_loadu_ps(B + 4),
+        b2 = _mm_loadu_ps(B + 8),
+        b3 = _mm_loadu_ps(B + 12);
+
+    // Row i of A is read before row i of dst is written
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128 row = _mm_mul_ps(_mm_set1_ps(A[i]), b0);
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(A[i + 1]), b1));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(A[i + 2]), b2));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(A[i + 3]), b3));
+        _mm_storeu_ps(dst + i, row);
+    }
+}
+
+void
+kernels::mat4_transpose_sse(float *dst, const float *M)
+{
+    __m128
+        r0 = _mm_loadu_ps(M),
+        r1 = _mm_loadu_ps(M + 4),
+        r2 = _mm_loadu_ps(M + 8),
+        r3 = _mm_loadu_ps(M + 12);
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    _mm_storeu_ps(dst,      r0);
+    _mm_storeu_ps(dst + 4,  r1);
+    _mm_storeu_ps(dst + 8,  r2);
+    _mm_storeu_ps(dst + 12, r3);
+}
+
+static inline __m128
+_cofactors(__m128 a, __m128 b, __m128 c)
+// One row of the adjugate from the three other columns, signs alternating
+// from + in lane 0. Matches the scalar expressions term by term.
+{
+    __m128
+        a1 = _SHUFFLE(a, 1, 0, 0, 0), a2 = _SHUFFLE(a, 2, 2, 1, 1), a3 = _SHUFFLE(a, 3, 3, 3, 2),
+        b1 = _SHUFFLE(b, 1, 0, 0, 0), b2 = _SHUFFLE(b, 2, 2, 1, 1), b3 = _SHUFFLE(b, 3, 3, 3, 2),
+        c1 = _SHUFFLE(c, 1, 0, 0, 0), c2 = _SHUFFLE(c, 2, 2, 1, 1), c3 = _SHUFFLE(c, 3, 3, 3, 2);
+
+    __m128 sum = _mm_mul_ps(_mm_mul_ps(a1, b2), c3);
+    sum = _mm_sub_ps(sum, _mm_mul_ps(_mm_mul_ps(a1, c2), b3));
+    sum = _mm_sub_ps(sum, _mm_mul_ps(_mm_mul_ps(a2, b1), c3));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_mul_ps(a2, c1), b3));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_mul_ps(a3, b1), c2));
+    sum = _mm_sub_ps(sum, _mm_mul_ps(_mm_mul_ps(a3, c1), b2));
+
+    // Flip lanes 1 and 3, exact as rounding is symmetric
+    return _mm_xor_ps(sum, _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f));
+}
+
+void
+kernels::mat4_inverse_sse(float *dst, const float *M)
+{
+    __m128
+        c0 = _mm_loadu_ps(M),
+        c1 = _mm_loadu_ps(M + 4),
+        c2 = _mm_loadu_ps(M + 8),
+        c3 = _mm_loadu_ps(M + 12);
+
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    // Odd rows start with a negative term
+    __m128
+        negate = _mm_set1_ps(-0.0f),
+        i0 = _cofactors(c1, c2, c3),
+        i1 = _mm_xor_ps(_cofactors(c0, c2, c3), negate),
+        i2 = _cofactors(c0, c1, c3),
+        i3 = _mm_xor_ps(_cofactors(c0, c1, c2), negate);
+
+    float determinant = 1.0f / (
+          M[0] * _mm_cvtss_f32(i0)
+        + M[1] * _mm_cvtss_f32(i1)
+        + M[2] * _mm_cvtss_f32(i2)
+        + M[3] * _mm_cvtss_f32(i3)
+    );
+
+    __m128 d = _mm_set1_ps(determinant);
+    _mm_storeu_ps(dst,      _mm_mul_ps(i0, d));
+    _mm_storeu_ps(dst + 4,  _mm_mul_ps(i1, d));
+    _mm_storeu_ps(dst + 8,  _mm_mul_ps(i2, d));
+    _mm_storeu_ps(dst + 12, _mm_mul_ps(i3, d));
+}
+
+void
+kernels::quat_mat4_sse(float *dst, const float *q)
+{
+    // Every element is (base + a1 * b1) + a2 * b2. Off-diagonal elements
+    // start from -0, as -0 + t == t for any t, and subtracted terms are
+    // added with a1 or a2 negated.
+    __m128
+        v  = _mm_loadu_ps(q),  //  x,  y,  z,  w
+        v2 = _mm_add_ps(v, v), // 2x, 2y, 2z, 2w
+        row;
+
+    row = _mm_add_ps(
+        _mm_add_ps(_LANES(1.0f, -0.0f, -0.0f, 0.0f),
+            _mm_mul_ps(_mm_xor_ps(_SHUFFLE(v2, 1, 0, 0, 3), _LANES(-0.0f, 0.0f, 0.0f, 0.0f)), _SHUFFLE(v, 1, 1, 2, 3))),
+            _mm_mul_ps(_mm_xor_ps(_SHUFFLE(v2, 2, 3, 3, 3), _LANES(-0.0f, -0.0f, 0.0f, 0.0f)), _SHUFFLE(v, 2, 2, 1, 3)));
+    _mm_storeu_ps(dst, row);
+
+    row = _mm_add_ps(
+        _mm_add_ps(_LANES(-0.0f, 1.0f, -0.0f, 0.0f),
+            _mm_mul_ps(_mm_xor_ps(_SHUFFLE(v2, 0, 0, 1, 3), _LANES(0.0f, -0.0f, 0.0f, 0.0f)), _SHUFFLE(v, 1, 0, 2, 3))),
+            _mm_mul_ps(_mm_xor_ps(_SHUFFLE(v2, 3, 2, 3, 3), _LANES(0.0f, -0.0f, -0.0f, 0.0f)), _SHUFFLE(v, 2, 2, 0, 3)));
+    _mm_storeu_ps(dst + 4, row);
+
+    row = _mm_add_ps(
+        _mm_add_ps(_LANES(-0.0f, -0.0f, 1.0f, 0.0f),
+            _mm_mul_ps(_mm_xor_ps(_SHUFFLE(v2, 0, 1, 0, 3), _LANES(0.0f, 0.0f, -0.0f, 0.0f)), _SHUFFLE(v, 2, 2, 0, 3))),
+            _mm_mul_ps(_mm_xor_ps(_SHUFFLE(v2, 3, 3, 1, 3), _LANES(-0.0f, 0.0f, -0.0f, 0.0f)), _SHUFFLE(v, 1, 0, 1, 3)));
+    _mm_storeu_ps(dst + 8, row);
+
+    // The fourth lanes are junk
+    dst[ 3] = 0.0f;
+    dst[ 7] = 0.0f;
+    dst[11] = 0.0f;
+    dst[12] = 0.0f;
+    dst[13] = 0.0f;
+    dst[14] = 0.0f;
+    dst[15] = 1.0f;
+}
+
+static inline void
+_store3(float *dst, __m128 v)
+// Lanes 0 to 2 only, as whatever follows may be another attribute
+{
+    _mm_storel_pi((__m64 *)dst, v);
+    _mm_store_ss(dst + 2, _mm_movehl_ps(v, v));
+}
+
+void
+kernels::transform_points_sse(float *dst, const float *src, size_t count, size_t stride, const float *M)
+{
+    __m128
+        c0 = _mm_loadu_ps(M),
+        c1 = _mm_loadu_ps(M + 4),
+        c2 = _mm_loadu_ps(M + 8),
+        c3 = _mm_loadu_ps(M + 12);
+
+    // Components are broadcast one by one, so nothing past v[2] is read
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float *v = _CONST_AT(src, i, stride);
+        __m128 p = _mm_mul_ps(c0, _mm_set1_ps(v[0]));
+        p = _mm_add_ps(p, _mm_mul_ps(c1, _mm_set1_ps(v[1])));
+        p = _mm_add_ps(p, _mm_mul_ps(c2, _mm_set1_ps(v[2])));
+        p = _mm_add_ps(p, c3);
+        _store3(_AT(dst, i, stride), p);
+    }
+}
+
+void
+kernels::transform_vectors_sse(float *dst, const float *src, size_t count, size_t stride, const float *M)
+{
+    __m128
+        c0 = _mm_loadu_ps(M),
+        c1 = _mm_loadu_ps(M + 4),
+        c2 = _mm_loadu_ps(M + 8);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float *v = _CONST_AT(src, i, stride);
+        __m128 p = _mm_mul_ps(c0, _mm_set1_ps(v[0]));
+        p = _mm_add_ps(p, _mm_mul_ps(c1, _mm_set1_ps(v[1])));
+        p = _mm_add_ps(p, _mm_mul_ps(c2, _mm_set1_ps(v[2])));
+        _store3(_AT(dst, i, stride), p);
+    }
+}
+
+void
+kernels::mat4_multiply_array_sse(float *dst, const float *A, size_t count, const float *M)
+{
+    __m128
+        b0 = _mm_loadu_ps(M),
+        b1 = _mm_loadu_ps(M + 4),
+        b2 = _mm_loadu_ps(M + 8),
+        b3 = _mm_loadu_ps(M + 12);
+
+    // Same as mat4_multiply_sse, with M loaded once for all of them
+    for (size_t i = 0; i < count * 16; i += 4)
+    {
+        __m128 row = _mm_mul_ps(_mm_set1_ps(A[i]), b0);
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(A[i + 1]), b1));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(A[i + 2]), b2));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(A[i + 3]), b3));
+        _mm_storeu_ps(dst + i, row);
+    }
+}
+#endif
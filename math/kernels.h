@@ -0,0 +1,91 @@
+/*
+    Math kernels.
+    The hot Mat4 and Quat operations on raw float arrays, each with a
+    portable scalar version and, where the compiler targets it, an SSE one.
+    Mat4 and Quat go through the plain names, which pick the SSE version
+    at compile time; define MATH_NO_SIMD to force the scalar ones.
+    The batched kernels apply one matrix to whole arrays, such as the
+    positions interleaved in a vertex buffer.
+
+        ------------------------------------------------------------------------
+        float M[16], I[16];
+        math::kernels::mat4_inverse(I, M);
+        math::kernels::mat4_inverse_scalar(I, M); // same result, bit for bit
+
+        // Every position of a vertex array, in place
+        math::kernels::transform_points(&v[0].pos.x, &v[0].pos.x,
+            v.size(), sizeof(v[0]), M);
+        ------------------------------------------------------------------------
+
+    The SSE versions evaluate every element with the same operations in the
+    same order as the scalar ones, so they agree exactly as long as the
+    scalar code isn't compiled for the x87 FPU.
+*/
+
+#ifndef _MATH_KERNELS_H
+#define _MATH_KERNELS_H
+
+#include <cstddef>
+
+#if defined(__SSE__) && !defined(MATH_NO_SIMD)
+#   define MATH_SSE
+#endif
+
+namespace math
+{
+    namespace kernels
+    {
+        void
+        mat4_multiply(float *dst, const float *A, const float *B);
+        // dst = A * B, dst may be either operand
+
+        void
+        mat4_transpose(float *dst, const float *M);
+
+        void
+        mat4_inverse(float *dst, const float *M);
+        // dst may be M
+
+        void
+        quat_mat4(float *dst, const float *q);
+        // Rotation matrix of a unit quaternion stored as x, y, z, w
+
+        void
+        transform_points(float *dst, const float *src, size_t count, size_t stride, const float *M);
+        // dst[i] = src[i] * M for count points of 3 floats, stride bytes
+        // apart in both arrays, same as Vec3 *= Mat4. dst may be src.
+
+        void
+        transform_vectors(float *dst, const float *src, size_t count, size_t stride, const float *M);
+        // Same, ignoring translation. Normals need the inverse transpose
+        // of the matrix unless it is only rotation and uniform scale.
+
+        void
+        mat4_multiply_array(float *dst, const float *A, size_t count, const float *M);
+        // dst[i] = A[i] * M for count tightly packed matrices, dst may be A
+
+        const char *
+        instruction_set(void);
+        // "SSE" or "scalar"
+
+        void mat4_multiply_scalar (float *dst, const float *A, const float *B);
+        void mat4_transpose_scalar(float *dst, const float *M);
+        void mat4_inverse_scalar  (float *dst, const float *M);
+        void quat_mat4_scalar     (float *dst, const float *q);
+        void transform_points_scalar   (float *dst, const float *src, size_t count, size_t stride, const float *M);
+        void transform_vectors_scalar  (float *dst, const float *src, size_t count, size_t stride, const float *M);
+        void mat4_multiply_array_scalar(float *dst, const float *A, size_t count, const float *M);
+
+#       ifdef MATH_SSE
+        void mat4_multiply_sse    (float *dst, const float *A, const float *B);
+        void mat4_transpose_sse   (float *dst, const float *M);
+        void mat4_inverse_sse     (float *dst, const float *M);
+        void quat_mat4_sse        (float *dst, const float *q);
+        void transform_points_sse      (float *dst, const float *src, size_t count, size_t stride, const float *M);
+        void transform_vectors_sse     (float *dst, const float *src, size_t count, size_t stride, const float *M);
+        void mat4_multiply_array_sse   (float *dst, const float *A, size_t count, const float *M);
+#       endif
+    }
+}
+
+#endif
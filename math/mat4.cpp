@@ -5,6 +5,7 @@
 #endif
 
 #include "mat4.h"
+#include "kernels.h"
 
 #include <cmath>
 #include <cstring> // memcpy
@@ -172,27 +173,7 @@ Mat4::operator*(const Mat4 &M)
 const
 {
     Mat4 dst;
-    const float *A = this->data;
-    
-    dst[ 0] = A[ 0] * M[ 0] + A[ 1] * M[ 4] + A[ 2] * M[ 8] + A[ 3] * M[12];
-    dst[ 1] = A[ 0] * M[ 1] + A[ 1] * M[ 5] + A[ 2] * M[ 9] + A[ 3] * M[13];
-    dst[ 2] = A[ 0] * M[ 2] + A[ 1] * M[ 6] + A[ 2] * M[10] + A[ 3] * M[14];
-    dst[ 3] = A[ 0] * M[ 3] + A[ 1] * M[ 7] + A[ 2] * M[11] + A[ 3] * M[15];
-
-    dst[ 4] = A[ 4] * M[ 0] + A[ 5] * M[ 4] + A[ 6] * M[ 8] + A[ 7] * M[12];
-    dst[ 5] = A[ 4] * M[ 1] + A[ 5] * M[ 5] + A[ 6] * M[ 9] + A[ 7] * M[13];
-    dst[ 6] = A[ 4] * M[ 2] + A[ 5] * M[ 6] + A[ 6] * M[10] + A[ 7] * M[14];
-    dst[ 7] = A[ 4] * M[ 3] + A[ 5] * M[ 7] + A[ 6] * M[11] + A[ 7] * M[15];
-
-    dst[ 8] = A[ 8] * M[ 0] + A[ 9] * M[ 4] + A[10] * M[ 8] + A[11] * M[12];
-    dst[ 9] = A[ 8] * M[ 1] + A[ 9] * M[ 5] + A[10] * M[ 9] + A[11] * M[13];
-    dst[10] = A[ 8] * M[ 2] + A[ 9] * M[ 6] + A[10] * M[10] + A[11] * M[14];
-    dst[11] = A[ 8] * M[ 3] + A[ 9] * M[ 7] + A[10] * M[11] + A[11] * M[15];
-
-    dst[12] = A[12] * M[ 0] + A[13] * M[ 4] + A[14] * M[ 8] + A[15] * M[12];
-    dst[13] = A[12] * M[ 1] + A[13] * M[ 5] + A[14] * M[ 9] + A[15] * M[13];
-    dst[14] = A[12] * M[ 2] + A[13] * M[ 6] + A[14] * M[10] + A[15] * M[14];
-    dst[15] = A[12] * M[ 3] + A[13] * M[ 7] + A[14] * M[11] + A[15] * M[15];
+    kernels::mat4_multiply(dst.data, this->data, M.data);
     
     return dst;
 }
@@ -200,32 +181,7 @@ const
 Mat4 &
 Mat4::operator*=(const Mat4 &M)
 {
-    float dst[15];
-    float *A = this->data;
-    
-    dst[ 0] = A[ 0] * M[ 0] + A[ 1] * M[ 4] + A[ 2] * M[ 8] + A[ 3] * M[12];
-    dst[ 1] = A[ 0] * M[ 1] + A[ 1] * M[ 5] + A[ 2] * M[ 9] + A[ 3] * M[13];
-    dst[ 2] = A[ 0] * M[ 2] + A[ 1] * M[ 6] + A[ 2] * M[10] + A[ 3] * M[14];
-    dst[ 3] = A[ 0] * M[ 3] + A[ 1] * M[ 7] + A[ 2] * M[11] + A[ 3] * M[15];
-
-    dst[ 4] = A[ 4] * M[ 0] + A[ 5] * M[ 4] + A[ 6] * M[ 8] + A[ 7] * M[12];
-    dst[ 5] = A[ 4] * M[ 1] + A[ 5] * M[ 5] + A[ 6] * M[ 9] + A[ 7] * M[13];
-    dst[ 6] = A[ 4] * M[ 2] + A[ 5] * M[ 6] + A[ 6] * M[10] + A[ 7] * M[14];
-    dst[ 7] = A[ 4] * M[ 3] + A[ 5] * M[ 7] + A[ 6] * M[11] + A[ 7] * M[15];
-
-    dst[ 8] = A[ 8] * M[ 0] + A[ 9] * M[ 4] + A[10] * M[ 8] + A[11] * M[12];
-    dst[ 9] = A[ 8] * M[ 1] + A[ 9] * M[ 5] + A[10] * M[ 9] + A[11] * M[13];
-    dst[10] = A[ 8] * M[ 2] + A[ 9] * M[ 6] + A[10] * M[10] + A[11] * M[14];
-    dst[11] = A[ 8] * M[ 3] + A[ 9] * M[ 7] + A[10] * M[11] + A[11] * M[15];
-
-    dst[12] = A[12] * M[ 0] + A[13] * M[ 4] + A[14] * M[ 8] + A[15] * M[12];
-    dst[13] = A[12] * M[ 1] + A[13] * M[ 5] + A[14] * M[ 9] + A[15] * M[13];
-    dst[14] = A[12] * M[ 2] + A[13] * M[ 6] + A[14] * M[10] + A[15] * M[14];
-
-    this->data[15]
-            = A[12] * M[ 3] + A[13] * M[ 7] + A[14] * M[11] + A[15] * M[15];
-    
-    memcpy(A, dst, sizeof(float) * 15);
+    kernels::mat4_multiply(this->data, this->data, M.data);
     
     return *this;
 }
@@ -249,99 +205,7 @@ Mat4::inverse(void)
 const
 {
     Mat4 I;
-    const float *M = this->data;
-    
-    I[0] =
-          M[ 5] * M[10] * M[15] - M[ 5] * M[11] * M[14]
-        - M[ 9] * M[ 6] * M[15] + M[ 9] * M[ 7] * M[14]
-        + M[13] * M[ 6] * M[11] - M[13] * M[ 7] * M[10];
-        
-    I[1] =
-        - M[ 1] * M[10] * M[15] + M[ 1] * M[11] * M[14]
-        + M[ 9] * M[ 2] * M[15] - M[ 9] * M[ 3] * M[14]
-        - M[13] * M[ 2] * M[11] + M[13] * M[ 3] * M[10];
-        
-    I[2] =
-          M[ 1] * M[ 6] * M[15] - M[ 1] * M[ 7] * M[14]
-        - M[ 5] * M[ 2] * M[15] + M[ 5] * M[ 3] * M[14]
-        + M[13] * M[ 2] * M[ 7] - M[13] * M[ 3] * M[ 6];
-        
-    I[3] =
-        - M[ 1] * M[ 6] * M[11] + M[ 1] * M[ 7] * M[10]
-        + M[ 5] * M[ 2] * M[11] - M[ 5] * M[ 3] * M[10]
-        - M[ 9] * M[ 2] * M[ 7] + M[ 9] * M[ 3] * M[ 6];
-        
-    I[4] =
-        - M[ 4] * M[10] * M[15] + M[ 4] * M[11] * M[14]
-        + M[ 8] * M[ 6] * M[15] - M[ 8] * M[ 7] * M[14]
-        - M[12] * M[ 6] * M[11] + M[12] * M[ 7] * M[10];
-        
-    I[5] =
-          M[ 0] * M[10] * M[15] - M[ 0] * M[11] * M[14]
-        - M[ 8] * M[ 2] * M[15] + M[ 8] * M[ 3] * M[14]
-        + M[12] * M[ 2] * M[11] - M[12] * M[ 3] * M[10];
-        
-    I[6] =
-        - M[ 0] * M[ 6] * M[15] + M[ 0] * M[ 7] * M[14]
-        + M[ 4] * M[ 2] * M[15] - M[ 4] * M[ 3] * M[14]
-        - M[12] * M[ 2] * M[ 7] + M[12] * M[ 3] * M[ 6];
-        
-    I[7] =
-          M[ 0] * M[ 6] * M[11] - M[ 0] * M[ 7] * M[10]
-        - M[ 4] * M[ 2] * M[11] + M[ 4] * M[ 3] * M[10]
-        + M[ 8] * M[ 2] * M[ 7] - M[ 8] * M[ 3] * M[ 6];
-        
-    I[8] =
-          M[ 4] * M[ 9] * M[15] - M[ 4] * M[11] * M[13]
-        - M[ 8] * M[ 5] * M[15] + M[ 8] * M[ 7] * M[13]
-        + M[12] * M[ 5] * M[11] - M[12] * M[ 7] * M[ 9];
-        
-    I[9] =
-        - M[ 0] * M[ 9] * M[15] + M[ 0] * M[11] * M[13]
-        + M[ 8] * M[ 1] * M[15] - M[ 8] * M[ 3] * M[13]
-        - M[12] * M[ 1] * M[11] + M[12] * M[ 3] * M[ 9];
-        
-    I[10] =
-          M[ 0] * M[ 5] * M[15] - M[ 0] * M[ 7] * M[13]
-        - M[ 4] * M[ 1] * M[15] + M[ 4] * M[ 3] * M[13]
-        + M[12] * M[ 1] * M[ 7] - M[12] * M[ 3] * M[ 5];
-        
-    I[11] =
-        - M[ 0] * M[ 5] * M[11] + M[ 0] * M[ 7] * M[ 9]
-        + M[ 4] * M[ 1] * M[11] - M[ 4] * M[ 3] * M[ 9]
-        - M[ 8] * M[ 1] * M[ 7] + M[ 8] * M[ 3] * M[ 5];
-        
-    I[12] =
-        - M[ 4] * M[ 9] * M[14] + M[ 4] * M[10] * M[13]
-        + M[ 8] * M[ 5] * M[14] - M[ 8] * M[ 6] * M[13]
-        - M[12] * M[ 5] * M[10] + M[12] * M[ 6] * M[ 9];
-        
-    I[13] =
-          M[ 0] * M[ 9] * M[14] - M[ 0] * M[10] * M[13]
-        - M[ 8] * M[ 1] * M[14] + M[ 8] * M[ 2] * M[13]
-        + M[12] * M[ 1] * M[10] - M[12] * M[ 2] * M[ 9];
-        
-    I[14] =
-        - M[ 0] * M[ 5] * M[14] + M[ 0] * M[ 6] * M[13]
-        + M[ 4] * M[ 1] * M[14] - M[ 4] * M[ 2] * M[13]
-        - M[12] * M[ 1] * M[ 6] + M[12] * M[ 2] * M[ 5];
-        
-    I[15] =
-          M[ 0] * M[ 5] * M[10] - M[ 0] * M[ 6] * M[ 9]
-        - M[ 4] * M[ 1] * M[10] + M[ 4] * M[ 2] * M[ 9]
-        + M[ 8] * M[ 1] * M[ 6] - M[ 8] * M[ 2] * M[ 5];
-
-    float determinant = 1.0f / (
-          M[0] * I[0]
-        + M[1] * I[4]
-        + M[2] * I[8]
-        + M[3] * I[12]
-    );
-
-    for (int i = 0; i < 16; ++i)
-    {
-        I[i] *= determinant;
-    }
+    kernels::mat4_inverse(I.data, this->data);
 
     return I;
 }
@@ -351,14 +215,61 @@ Mat4::transpose(void)
 const
 {
     Mat4 T;
+    kernels::mat4_transpose(T.data, this->data);
+    
+    return T;
+}
+
+Mat4
+Mat4::inverse_transpose(void)
+const
+{
     const float *M = this->data;
     
-    T[ 0] = M[ 0]; T[ 1] = M[ 4]; T[ 2] = M[ 8]; T[ 3] = M[12];
-    T[ 4] = M[ 1]; T[ 5] = M[ 5]; T[ 6] = M[ 9]; T[ 7] = M[13];
-    T[ 8] = M[ 2]; T[ 9] = M[ 6]; T[10] = M[10]; T[11] = M[14];
-    T[12] = M[ 3]; T[13] = M[ 7]; T[14] = M[11]; T[15] = M[15];
+    // Only affine matrices have the short forms
+    if (M[3] != 0.0f || M[7] != 0.0f || M[11] != 0.0f || M[15] != 1.0f)
+    {
+        return this->transpose().inverse();
+    }
     
-    return T;
+    Vec3
+        c0(M[0], M[1], M[2]),
+        c1(M[4], M[5], M[6]),
+        c2(M[8], M[9], M[10]),
+        t (M[12], M[13], M[14]);
+    
+    // The 3 x 3 part: a rotation is its own inverse transpose, otherwise
+    // the columns of the inverse transpose are cross products of the
+    // other two over the determinant
+    const float EPSILON = 1e-5f;
+    bool rotation =
+           std::abs(c0.dot(c0) - 1.0f) < EPSILON
+        && std::abs(c1.dot(c1) - 1.0f) < EPSILON
+        && std::abs(c2.dot(c2) - 1.0f) < EPSILON
+        && std::abs(c0.dot(c1)) < EPSILON
+        && std::abs(c0.dot(c2)) < EPSILON
+        && std::abs(c1.dot(c2)) < EPSILON;
+    
+    if (!rotation)
+    {
+        Vec3
+            n0 = c1.cross(c2),
+            n1 = c2.cross(c0),
+            n2 = c0.cross(c1);
+        float determinant = 1.0f / c0.dot(n0);
+        
+        c0 = n0 * determinant;
+        c1 = n1 * determinant;
+        c2 = n2 * determinant;
+    }
+    
+    // The translation turns into the bottom row, (-R^-1 t) transposed
+    return Mat4(
+        c0.x, c0.y, c0.z, -c0.dot(t),
+        c1.x, c1.y, c1.z, -c1.dot(t),
+        c2.x, c2.y, c2.z, -c2.dot(t),
+        0.0f, 0.0f, 0.0f, 1.0f
+    );
 }
 
 Mat4 &
@@ -50,6 +50,7 @@ namespace math
 
             Mat4 transpose() const;
             Mat4 inverse()   const;
+            Mat4 inverse_transpose() const; // Same as transpose().inverse(), cheaper for affine matrices
             
             // Transformations
             Mat4 &translate(const Vec3 &v);
@@ -70,7 +70,7 @@ const
     for (Poly2::Vertices::const_iterator v = this->v.begin();
         v != this->v.end(); ++v)
     {
-        sum += *v / f;
+        sum += *v * f;
     }
     
     return sum;
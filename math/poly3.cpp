@@ -118,7 +118,7 @@ const
     for (Poly3::Vertices::const_iterator v = this->v.begin();
         v != this->v.end(); ++v)
     {
-        sum += *v / f;
+        sum += *v * f;
     }
     
     return sum;
@@ -1,5 +1,6 @@
 #include "quat.h"
 #include "util.h"
+#include "kernels.h"
 
 #include <cmath>
 
@@ -188,27 +189,10 @@ Mat4
 Quat::mat4(void)
 const
 {
-    return Mat4(
-        1.0f - 2.0f * this->y * this->y - 2.0f * this->z * this->z,
-        2.0f * this->x * this->y - 2.0f * this->w * this->z,
-        2.0f * this->x * this->z + 2.0f * this->w * this->y,
-        0.0f,
-
-        2.0f * this->x * this->y + 2.0f * this->w * this->z,
-        1.0f - 2.0f * this->x * this->x - 2.0f * this->z * this->z,
-        2.0f * this->y * this->z - 2.0f * this->w * this->x,
-        0.0f,
-
-        2.0f * this->x * this->z - 2.0f * this->w * this->y,
-        2.0f * this->y * this->z + 2.0f * this->w * this->x,
-        1.0f - 2.0f * this->x * this->x - 2.0f * this->y * this->y,
-        0.0f,
+    Mat4 M;
+    kernels::quat_mat4(M.data, &this->x);
 
-        0.0f,
-        0.0f,
-        0.0f,
-        1.0f
-    );
+    return M;
 }
 
 Quat
@@ -0,0 +1,96 @@
+#include "random.h"
+
+#include <SDL2/SDL.h>
+
+using namespace math;
+
+// Per-thread generators, created on first use
+static SDL_TLSID    _tls     = 0;
+static SDL_SpinLock _lock    = 0;
+static int          _threads = 0;
+
+static inline unsigned int
+_mix(unsigned int h)
+// Integer hash with full avalanche (Wellons' lowbias32)
+{
+    h ^= h >> 16;
+    h *= 0x7feb352d;
+    h ^= h >> 15;
+    h *= 0x846ca68b;
+    h ^= h >> 16;
+
+    return h;
+}
+
+static void
+_free_random(void *data)
+{
+    delete (Random *)data;
+}
+
+Random::Random(unsigned int seed)
+{
+    this->seed(_mix(seed));
+}
+
+Random::Random(unsigned int seed, int key)
+{
+    this->seed(_mix(_mix(seed) ^ key));
+}
+
+Random::Random(unsigned int seed, int key_x, int key_z)
+{
+    this->seed(_mix(_mix(_mix(seed) ^ key_x) + key_z));
+}
+
+void
+Random::seed(unsigned int h)
+{
+    // _mix() is a bijection that only maps 0 to 0, and no four of these
+    // steps can all land on 0, so the state is never all zero
+    for (int i = 0; i < 4; ++i)
+    {
+        h += 0x9e3779b9;
+        this->state[i] = _mix(h);
+    }
+}
+
+Random
+Random::split(int key)
+const
+{
+    unsigned int h = this->state[0];
+    for (int i = 1; i < 4; ++i)
+    {
+        h = _mix(h) ^ this->state[i];
+    }
+
+    return Random(h, key);
+}
+
+Random &
+Random::local(void)
+{
+    if (_tls == 0)
+    {
+        SDL_AtomicLock(&_lock);
+        if (_tls == 0)
+        {
+            _tls = SDL_TLSCreate();
+        }
+        SDL_AtomicUnlock(&_lock);
+    }
+
+    Random *random = (Random *)SDL_TLSGet(_tls);
+    if (random == NULL)
+    {
+        // Same sequence on every run unless reseeded
+        SDL_AtomicLock(&_lock);
+        random = new Random(0, _threads++);
+        SDL_AtomicUnlock(&_lock);
+
+        SDL_TLSSet(_tls, random, _free_random);
+    }
+
+    return *random;
+}
@@ -0,0 +1,102 @@
+/*
+    Pseudo-random number generator.
+    xoshiro128** by Blackman and Vigna: four words of state, a few shifts
+    and rotations per number and a period of 2^128 - 1. Each generator is
+    a plain object, so what it returns depends only on its seed and on the
+    calls made on it, not on whatever else draws numbers meanwhile.
+
+        ------------------------------------------------------------------------
+        math::Random random(world_seed, chunk_x, chunk_z);
+        float height = math::rnd(random, 10.0f, 20.0f);
+        if (math::probability(random, .3f)) ...
+        ------------------------------------------------------------------------
+
+    Generators seeded with the same number but different keys, such as
+    chunk coordinates or an entity id, give unrelated streams, which lets
+    jobs generate content in parallel and in any order. The math::rnd()
+    family without a generator draws from Random::local().
+*/
+
+#ifndef _MATH_RANDOM_H
+#define _MATH_RANDOM_H
+
+namespace math
+{
+    class Random
+    {
+        public:
+            explicit Random(unsigned int seed = 0);
+            Random(unsigned int seed, int key);
+            Random(unsigned int seed, int key_x, int key_z);
+
+            unsigned int
+            next(void);
+            // 32 random bits
+
+            float
+            real(void) { return (float)(this->next() >> 8) / 0xffffff; }
+            // Random real value between 0.0f and 1.0f
+
+            Random
+            split(int key) const;
+            // Independent stream derived from the current state,
+            // which is left as it is
+
+            static Random &
+            local(void);
+            // This thread's generator, assign to it to reseed
+
+        private:
+            unsigned int state[4];
+
+            void
+            seed(unsigned int h);
+    };
+
+    float inline
+    rnd(Random &random, float min, float max) { return min + (max - min) * random.real(); }
+    // Random real value between min and max
+
+    float inline
+    rnd(Random &random, float max) { return rnd(random, 0.0f, max); }
+    // Random real value between 0.0f and max
+
+    float inline
+    rnd(Random &random) { return random.real(); }
+    // Random real value between 0.0f and 1.0f
+
+    bool inline
+    probability(Random &random, float p) { return (rnd(random) <= p); }
+    // Returns true at given probability
+
+    float inline
+    vary(Random &random, float max_deviation) { return rnd(random, -max_deviation, max_deviation); }
+    // Real value randomly deviated from 0.0 (+/- max)
+
+    float inline
+    vary(Random &random, float baseline, float max_deviation) { return baseline + vary(random, max_deviation); }
+    // Real value randomly deviated from baseline (+/- max)
+}
+
+inline unsigned int
+math::Random::next(void)
+{
+    // Assumes 32-bit ints, as everything the engine targets has
+    unsigned int
+        *s     = this->state,
+        result = s[1] * 5,
+        t      = s[1] << 9;
+
+    result = ((result << 7) | (result >> 25)) * 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3]  = (s[3] << 11) | (s[3] >> 21);
+
+    return result;
+}
+
+#endif
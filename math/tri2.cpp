@@ -39,12 +39,10 @@ float
 Tri2::area(void)
 const
 {
-    float
-        x = (this->b.x * this->c.y - this->c.x * this->b.y),
-        y = (this->c.x * this->a.y - this->a.x * this->c.y),
-        z = (this->a.x * this->b.y - this->b.x * this->a.y);
+    Vec2 u = this->b - this->a;
+    Vec2 v = this->c - this->a;
 
-    return .5f * sqrt(x * x + y * y + z * z);
+    return .5f * std::abs(u.x * v.y - u.y * v.x);
 }
 
 float
@@ -54,12 +54,7 @@ float
 Tri3::area(void)
 const
 {
-    float
-        x = (this->b.x * this->c.y - this->c.x * this->b.y),
-        y = (this->c.x * this->a.y - this->a.x * this->c.y),
-        z = (this->a.x * this->b.y - this->b.x * this->a.y);
-
-    return .5f * sqrt(x * x + y * y + z * z);
+    return .5f * this->normal().length();
 }
 
 float
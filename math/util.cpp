@@ -1,7 +1,6 @@
 #include "util.h"
 
 #include <cmath>   // cos
-#include <cstdlib> // rand
 
 static float
     noisebuf[64],
@@ -18,13 +17,13 @@ math::noise(long n)
 float
 math::rnd(void)
 {
-    return (float)rand() / RAND_MAX;
+    return math::Random::local().real();
 }
 
 float
 math::rnd(float min, float max)
 {
-    return min + (max - min) * (float)rand() / RAND_MAX;
+    return math::rnd(math::Random::local(), min, max);
 }
 
 float
@@ -59,7 +58,7 @@ math::interpolate::cubic(float p0, float p1, float p2, float p3, float dist)
     return p * dist_sq * dist
         + q * dist_sq
         + r * dist
-        + p0;
+        + p1;
 }
 
 float
@@ -73,7 +72,7 @@ math::interpolate::catmull_rom(float p0, float p1, float p2, float p3, float dis
     return p * dist_sq * dist
         + q * dist_sq
         + r * dist
-        + p0;
+        + p1;
 }
 
 float
@@ -9,6 +9,7 @@
 #define _MATH_UTIL_H
 
 #include "conversions.h"
+#include "random.h"
 
 namespace math
 {
@@ -31,6 +32,7 @@ namespace math
     float
     rnd(void);
     // Random real value between 0.0f and 1.0f
+    // These draw from this thread's generator, see math::Random
     
     bool inline
     probability(float p) { return (rnd() <= p); }
@@ -22,7 +22,7 @@ Vec4::Vec4(const Vec2 &v, float z, float w)
     this->w = w;
 }
 
-Vec4::Vec4(const Vec3 &v, float z)
+Vec4::Vec4(const Vec3 &v, float w)
 {
     this->x = v.x;
     this->y = v.y;